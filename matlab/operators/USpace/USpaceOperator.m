@@ -24,6 +24,8 @@ properties
     rosCli_SimControl         % ROS2 Service client to control the simulation
     rosCli_DeployUAV          % ROS2 Service client to deploy models into the air space
     rosCli_RemoveUAV          % ROS2 Service client to remove models from the air space
+    rosCli_SetSimAlarm        % ROS2 Service client to register sim-time alarms
+    rosSub_Alarm              % ROS2 subscriptor to get sim-time alarm notifications
 
     % Gazebo interface
     models_path               
@@ -61,6 +63,14 @@ function obj = USpaceOperator(name,models_path)
         'History','keepall');
     % pause(0.1) 
 
+    obj.rosCli_SetSimAlarm = ros2svcclient(obj.rosNode, ...
+        '/NavSim/SetSimAlarm','navsim_msgs/SetSimAlarm', ...
+        'History','keepall');
+
+    obj.rosSub_Alarm = ros2subscriber(obj.rosNode, ...
+        '/NavSim/Alarm','navsim_msgs/SimAlarm', ...
+        'History','keepall');
+
 end
 
 
@@ -76,12 +86,64 @@ function [sec,mil] = GetTime(obj)
 end
 
 
+function msg = Stamp(obj,msg)
+
+    % Wall and simulation times of sending, for the command latency
+    % monitor of NavSim (/NavSim/CommandLatency). The simulation time is the
+    % last one received on /NavSim/Time
+    t = posixtime(datetime('now','TimeZone','UTC'));
+    msg.stamp_wall.sec     = int32(floor(t));
+    msg.stamp_wall.nanosec = uint32(rem(t,1)*1E9);
+
+    time = obj.rosSub_Time.LatestMessage;
+    if ~isempty(time)
+        msg.stamp_sim.sec     = time.sec;
+        msg.stamp_sim.nanosec = time.nanosec;
+    end
+end
+
+
 function WaitTime(obj,time)
-    [s,~] = obj.GetTime;
-    while s < time
-        [s,~] = obj.GetTime;
-        % pause (1);
 
+    % Already past (its alarm would fire before receive() started waiting)
+    if obj.SimTime() >= time
+        return
+    end
+
+    % Register a sim-time alarm and wait for its notification
+    req = ros2message(obj.rosCli_SetSimAlarm);
+    req.client_id = char(obj.name);
+    req.deadline.sec = int32(floor(time));
+    req.deadline.nanosec = uint32((time - floor(time)) * 1E9);
+
+    alarm_id = [];
+    try
+        res = call(obj.rosCli_SetSimAlarm,req,'Timeout',1);
+        if res.status
+            alarm_id = res.alarm_id;
+        end
+    catch
+    end
+
+    % Without alarm, or if its notification is missed, the sim time is
+    % checked every second
+    while obj.SimTime() < time
+        [msg,status,~] = receive(obj.rosSub_Alarm,1);
+        if status && ~isempty(alarm_id) && msg.alarm_id == alarm_id
+            return
+        end
+    end
+end
+
+
+function time = SimTime(obj)
+
+    % Last simulation time received on /NavSim/Time (0 if none yet)
+    msg = obj.rosSub_Time.LatestMessage;
+    if isempty(msg)
+        time = 0;
+    else
+        time = double(msg.sec) + double(msg.nanosec) * 1E-9;
     end
 end
 
@@ -290,7 +352,9 @@ function RemoteCommand(obj,UAVid,on,velX,velY,velZ,rotZ,duration)
     msg.vel.linear.z  = velZ;
     msg.vel.angular.z = rotZ;
     msg.duration.sec  = int32(duration);
-    send(UAV.rosPub_RemoteCommand,msg);
+    msg = obj.Stamp(msg);
+    % Publisher of this UAV (it used to be UAV.rosPub_RemoteCommand, an undefined variable)
+    send(uav.rosPub_RemoteCommand,msg);
         
 end
 
@@ -339,6 +403,7 @@ function SendFlightPlan(obj,UAVid,fp)
         msg.route(i).vel.z = fp.waypoints(i).vz;
 
     end
+    msg = obj.Stamp(msg);
     send(uav.rosPub_FlightPlan,msg);
         
 end
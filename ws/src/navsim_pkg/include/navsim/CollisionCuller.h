@@ -0,0 +1,147 @@
+#ifndef NAVSIM_COLLISIONCULLER_H
+#define NAVSIM_COLLISIONCULLER_H
+
+// Proximity culling of UAV-UAV contacts through the collide bitmasks.
+//
+// ODE only tests two geoms when the category bits of one match the collide
+// bits of the other (in either direction). Every UAV gets the category
+// DroneBit and collides with WorldBit, a bit that the other models keep by
+// default (Gazebo sets all of them), so UAVs collide with the world but not
+// with each other. UAVs that may touch before the next update are joined in
+// clusters (spatial hash of the positions plus union-find), and each cluster
+// gets one group bit, set both as category and as collide bit, so its UAVs
+// do collide with each other.
+//
+// The radius of each pair is extended by the distance its two UAVs can close
+// in one period. When there are more clusters than group bits, some clusters
+// share a bit: they are tested against each other, which costs time but never
+// loses a contact.
+
+#include "navsim/SpatialHash.h"
+
+#include <Eigen/Core>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+
+namespace navsim
+{
+
+class CollisionCuller
+{
+
+public:
+
+static constexpr uint32_t WorldBit   = 0x00000001;   // GZ_FIXED_COLLIDE, set in every other model
+static constexpr uint32_t DroneBit   = 0x08000000;   // highest bit of GZ_ALL_COLLIDE
+static constexpr int      FirstGroup = 2;            // bit 1 is GZ_SENSOR_COLLIDE
+static constexpr int      NumGroups  = 25;           // bits 2 to 26
+
+
+private:
+
+SpatialHash hash;
+std::vector<int32_t>  parent;   // union-find forest (size of the tree at the roots)
+std::vector<int32_t>  size;
+std::vector<uint32_t> group;    // group bit of each UAV (0: alone)
+std::vector<double>   speed;
+int numClusters = 0;
+
+
+int Find(int i)
+{
+    while (parent[i] != i)
+    {
+        parent[i] = parent[parent[i]];   // path halving
+        i = parent[i];
+    }
+    return i;
+}
+
+void Union(int i, int j)
+{
+    i = Find(i);
+    j = Find(j);
+    if (i == j) return;
+    if (size[i] < size[j]) std::swap(i, j);
+    parent[j] = i;
+    size[i]  += size[j];
+}
+
+
+public:
+
+// Clusters of the UAVs that may come closer than 'radius' before the next
+// update, 'period' seconds later
+void Update(const std::vector<Eigen::Vector3d> &positions,
+            const std::vector<Eigen::Vector3d> &velocities, double radius, double period)
+{
+    int n = positions.size();
+
+    speed.resize(n);
+    double maxSpeed = 0;
+    for (int i = 0; i < n; i++)
+    {
+        speed[i] = velocities[i].norm();
+        maxSpeed = std::max(maxSpeed, speed[i]);
+    }
+    double reach = radius + 2 * maxSpeed * period;
+
+    parent.resize(n);
+    size.assign(n, 1);
+    for (int i = 0; i < n; i++)
+        parent[i] = i;
+
+    hash.Build(positions, reach);
+    hash.ForEachPair(reach, [&](int i, int j, double dist)
+    {
+        if (dist < radius + (speed[i] + speed[j]) * period)
+            Union(i, j);
+    });
+
+    // Group bits in the order of the first UAV of each cluster, so they
+    // only change when the clusters do
+    group.assign(n, 0);
+    std::vector<uint32_t> rootGroup(n, 0);
+    numClusters = 0;
+    for (int i = 0; i < n; i++)
+    {
+        int root = Find(i);
+        if (size[root] < 2) continue;
+        if (!rootGroup[root])
+            rootGroup[root] = 1u << (FirstGroup + numClusters++ % NumGroups);
+        group[i] = rootGroup[root];
+    }
+}
+
+
+
+uint32_t CategoryBits(size_t i) const
+{
+    return DroneBit | group[i];
+}
+
+uint32_t CollideBits(size_t i) const
+{
+    return WorldBit | group[i];
+}
+
+// Clusters of two or more UAVs in the last update
+int Clusters() const
+{
+    return numClusters;
+}
+
+// UAVs that can collide with another UAV
+size_t Clustered() const
+{
+    return std::count_if(group.begin(), group.end(), [](uint32_t g) { return g != 0; });
+}
+
+};
+
+} // namespace navsim
+
+#endif
@@ -0,0 +1,243 @@
+#ifndef NAVSIM_COMMAND_LATENCY_H
+#define NAVSIM_COMMAND_LATENCY_H
+
+// Latency of the remote commands and flight plans, from the operator to the
+// low level control of the drone.
+//
+// The operator may stamp a message with the wall and simulation times it sent
+// it (stamp_wall, stamp_sim of RemoteCommand and FlightPlan, zero when not
+// stamped; the DDS source timestamp stands for an unstamped wall time). The
+// drone plugin adds the times its subscription received the message (DDS),
+// spin_some handed it to the callback (dequeued), and its first control step
+// used it (applied). Per message, the stages are:
+//
+//   transport   sent     -> received   [wall s]
+//   queue       received -> dequeued   [wall s]  waiting for the RosCheckPeriod poll
+//   apply       dequeued -> applied    [wall s]
+//   total       sent     -> applied    [wall s]
+//   total_sim   sent     -> applied    [sim s]   stamped messages only
+//
+// A message replaced before a control step used it only counts in the first
+// two. The World plugin takes the samples of every drone and publishes their
+// distributions, per UAV and for the fleet, on /NavSim/CommandLatency.
+// Instance() is inline, so every plugin library resolves to the same object.
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "builtin_interfaces/msg/time.hpp"
+#include "rclcpp/message_info.hpp"
+
+
+namespace navsim
+{
+
+enum class LatencyStage
+{
+    Transport,
+    Queue,
+    Apply,
+    Total,
+    TotalSim,
+    Count
+};
+
+inline const char *LatencyStageName(LatencyStage stage)
+{
+    static const char *names[] = { "transport", "queue", "apply", "total", "total_sim" };
+    return names[int(stage)];
+}
+
+
+
+// Wall time [s since the epoch], on the clock of the DDS timestamps
+inline double WallTime()
+{
+    return std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+
+
+// Times of a message on its way to the control [s] (0: unknown)
+struct CommandStamps
+{
+    double sentWall     = 0;
+    double sentSim      = 0;
+    double receivedWall = 0;
+    double dequeuedWall = 0;
+    double dequeuedSim  = 0;
+};
+
+// Stamps of a message dequeued now, at simulation time 'simTime'
+inline CommandStamps MakeStamps(const builtin_interfaces::msg::Time &stampWall,
+                                const builtin_interfaces::msg::Time &stampSim,
+                                const rclcpp::MessageInfo &info, double simTime)
+{
+    const rmw_message_info_t &rmw = info.get_rmw_message_info();
+
+    CommandStamps stamps;
+    stamps.sentWall     = stampWall.sec + stampWall.nanosec * 1E-9;
+    stamps.sentSim      = stampSim.sec  + stampSim.nanosec  * 1E-9;
+    if (stamps.sentWall == 0)
+        stamps.sentWall = rmw.source_timestamp * 1E-9;
+    stamps.receivedWall = rmw.received_timestamp * 1E-9;    // 0 if the RMW does not support it
+    stamps.dequeuedWall = WallTime();
+    stamps.dequeuedSim  = simTime;
+    return stamps;
+}
+
+
+
+// Samples of one drone (written by its plugin, taken by the World plugin)
+class UavLatency
+{
+
+public:
+
+static constexpr size_t MaxSamples = 4096;    // per stage until taken
+
+const std::string uav;
+
+explicit UavLatency(const std::string &uav) : uav(uav) {}
+
+
+private:
+
+std::mutex mutex;
+std::vector<double> samples[int(LatencyStage::Count)];
+
+CommandStamps pending;            // dequeued, not yet applied
+bool waiting = false;
+
+void Add(LatencyStage stage, double latency)
+{
+    std::vector<double> &s = samples[int(stage)];
+    if (s.size() < MaxSamples) s.push_back(latency);
+}
+
+
+public:
+
+void Dequeued(const CommandStamps &stamps)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (stamps.sentWall > 0 && stamps.receivedWall > 0)
+        Add(LatencyStage::Transport, stamps.receivedWall - stamps.sentWall);
+    if (stamps.receivedWall > 0)
+        Add(LatencyStage::Queue, stamps.dequeuedWall - stamps.receivedWall);
+
+    pending = stamps;
+    waiting = true;
+}
+
+
+
+// Called by every control step: only the first after a Dequeued() counts
+void Applied(double simTime)
+{
+    if (!waiting) return;
+    waiting = false;
+
+    double wall = WallTime();
+    std::lock_guard<std::mutex> lock(mutex);
+    Add(LatencyStage::Apply, wall - pending.dequeuedWall);
+    if (pending.sentWall > 0)
+        Add(LatencyStage::Total, wall - pending.sentWall);
+    if (pending.sentSim > 0 && simTime >= pending.sentSim)    // else stamped before a reset
+        Add(LatencyStage::TotalSim, simTime - pending.sentSim);
+}
+
+
+
+// Moves the samples since the previous call to 'out'
+void Take(std::vector<double> (&out)[int(LatencyStage::Count)])
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (int s = 0; s < int(LatencyStage::Count); s++)
+    {
+        out[s].clear();
+        out[s].swap(samples[s]);
+    }
+}
+
+};
+
+
+
+class LatencyMonitor
+{
+
+private:
+
+std::mutex mutex;
+std::unordered_map<std::string, std::weak_ptr<UavLatency>> uavs;
+
+LatencyMonitor() = default;
+
+
+public:
+
+LatencyMonitor(const LatencyMonitor &) = delete;
+LatencyMonitor &operator=(const LatencyMonitor &) = delete;
+
+static LatencyMonitor &Instance()
+{
+    static LatencyMonitor monitor;
+    return monitor;
+}
+
+
+
+// Samples of a drone, registered while its plugin keeps the pointer
+std::shared_ptr<UavLatency> Uav(const std::string &uav)
+{
+    auto latency = std::make_shared<UavLatency>(uav);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    uavs[uav] = latency;
+    return latency;
+}
+
+
+
+// Drones still flying (the others are forgotten)
+std::vector<std::shared_ptr<UavLatency>> Uavs()
+{
+    std::vector<std::shared_ptr<UavLatency>> alive;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto it = uavs.begin(); it != uavs.end(); )
+    {
+        if (auto latency = it->second.lock())
+        {
+            alive.push_back(latency);
+            ++it;
+        }
+        else
+            it = uavs.erase(it);
+    }
+    return alive;
+}
+
+};
+
+
+
+// Percentile of the samples, reordering them (0 when empty)
+inline double SamplePercentile(std::vector<double> &samples, double fraction)
+{
+    if (samples.empty()) return 0;
+
+    size_t rank = std::min(samples.size() - 1, size_t(std::max(0.0, fraction * samples.size() - 1e-9)));
+    std::nth_element(samples.begin(), samples.begin() + rank, samples.end());
+    return samples[rank];
+}
+
+} // namespace navsim
+
+#endif
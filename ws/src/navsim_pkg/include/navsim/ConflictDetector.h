@@ -0,0 +1,256 @@
+#ifndef NAVSIM_CONFLICTDETECTOR_H
+#define NAVSIM_CONFLICTDETECTOR_H
+
+// Strategic conflict detection between flight plans.
+//
+// Stored plans are bucketed into a time-sliced uniform grid: every segment is
+// inserted in the cells its swept volume (segment inflated by the plan radius)
+// touches in each time slice. A new plan only has to be compared with the
+// segments sharing a cell with it, and each candidate pair of segments is
+// solved exactly (closest approach of two linear motions).
+
+#include "navsim/FlightPlanGeometry.h"
+
+#include <algorithm>
+#include <limits>
+#include <unordered_map>
+
+
+namespace navsim
+{
+
+struct Conflict
+{
+    uint16_t    id1, id2;
+    std::string uav1, uav2;
+    double      distance;   // separation at the time of closest approach [m]
+    double      time;       // time of closest approach                   [s]
+};
+
+
+
+class ConflictDetector
+{
+
+private:
+
+struct Entry
+{
+    uint32_t slot;   // index of the plan in 'plans'
+    uint32_t seg;    // index of the segment in the plan
+};
+
+struct StoredPlan
+{
+    Plan4D plan;
+    std::vector<uint64_t> cells;   // cells where the plan was inserted
+};
+
+Eigen::Vector3d cellSize;
+double timeSlice;
+
+std::unordered_map<uint64_t, std::vector<Entry>> grid;
+std::vector<StoredPlan> plans;
+std::vector<uint32_t>   freeSlots;
+std::unordered_map<PlanKey, uint32_t, PlanKeyHash> slotByPlan;
+
+// Per query scratch buffers
+std::vector<uint64_t> candidates;
+std::vector<double>   bestDist;
+std::vector<double>   bestTime;
+std::vector<uint32_t> touched;
+
+
+public:
+
+ConflictDetector(double cellXY = 50, double cellZ = 50, double slice = 10)
+    : cellSize(cellXY, cellXY, cellZ), timeSlice(slice)
+{
+}
+
+
+
+void Clear()
+{
+    grid.clear();
+    plans.clear();
+    freeSlots.clear();
+    slotByPlan.clear();
+}
+
+
+
+size_t Size() const
+{
+    return slotByPlan.size();
+}
+
+
+
+// Conflicts of 'plan' against the stored set (a stored plan of the same UAV and id is ignored)
+std::vector<Conflict> Check(const Plan4D &plan)
+{
+    std::vector<Conflict> conflicts;
+
+    if (bestDist.size() < plans.size())
+    {
+        bestDist.resize(plans.size(), std::numeric_limits<double>::infinity());
+        bestTime.resize(plans.size(), 0);
+    }
+
+    for (const PlanSegment &seg : plan.segments)
+    {
+        // Candidate segments sharing any cell with this one
+        candidates.clear();
+        ForEachSweptCell(seg, plan.radius, cellSize, timeSlice,
+            [&](long ix, long iy, long iz, long it)
+            {
+                auto cell = grid.find(PackCell4D(ix, iy, iz, it));
+                if (cell == grid.end()) return;
+                for (const Entry &e : cell->second)
+                    candidates.push_back((uint64_t(e.slot) << 32) | e.seg);
+            });
+
+        std::sort(candidates.begin(), candidates.end());
+        candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+        for (uint64_t c : candidates)
+        {
+            uint32_t slot = c >> 32;
+            const Plan4D &other = plans[slot].plan;
+            if (other.id == plan.id && other.uav == plan.uav) continue;
+
+            double dist, time;
+            if (!ClosestApproach(seg, other.segments[c & 0xFFFFFFFF], dist, time))
+                continue;
+
+            if (std::isinf(bestDist[slot]))
+                touched.push_back(slot);
+            if (dist < bestDist[slot])
+            {
+                bestDist[slot] = dist;
+                bestTime[slot] = time;
+            }
+        }
+    }
+
+    for (uint32_t slot : touched)
+    {
+        const Plan4D &other = plans[slot].plan;
+        if (bestDist[slot] < plan.radius + other.radius)
+        {
+            Conflict conflict;
+            conflict.id1      = plan.id;
+            conflict.uav1     = plan.uav;
+            conflict.id2      = other.id;
+            conflict.uav2     = other.uav;
+            conflict.distance = bestDist[slot];
+            conflict.time     = bestTime[slot];
+            conflicts.push_back(conflict);
+        }
+        bestDist[slot] = std::numeric_limits<double>::infinity();
+    }
+    touched.clear();
+
+    return conflicts;
+}
+
+
+
+// Insert (or replace, if its UAV and id are already stored) a plan in the stored set
+void Insert(const Plan4D &plan)
+{
+    PlanKey planKey = plan.Key();
+    Remove(planKey);
+
+    uint32_t slot;
+    if (freeSlots.empty())
+    {
+        slot = plans.size();
+        plans.emplace_back();
+    }
+    else
+    {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    }
+
+    StoredPlan &stored = plans[slot];
+    stored.plan = plan;
+    stored.cells.clear();
+
+    for (uint32_t s = 0; s < plan.segments.size(); s++)
+    {
+        ForEachSweptCell(plan.segments[s], plan.radius, cellSize, timeSlice,
+            [&](long ix, long iy, long iz, long it)
+            {
+                uint64_t key = PackCell4D(ix, iy, iz, it);
+                grid[key].push_back({slot, s});
+                stored.cells.push_back(key);
+            });
+    }
+
+    slotByPlan[planKey] = slot;
+}
+
+
+
+bool Remove(const PlanKey &key)
+{
+    auto found = slotByPlan.find(key);
+    if (found == slotByPlan.end()) return false;
+
+    uint32_t slot = found->second;
+    StoredPlan &stored = plans[slot];
+
+    std::sort(stored.cells.begin(), stored.cells.end());
+    stored.cells.erase(std::unique(stored.cells.begin(), stored.cells.end()), stored.cells.end());
+    for (uint64_t key : stored.cells)
+    {
+        auto cell = grid.find(key);
+        if (cell == grid.end()) continue;
+
+        std::vector<Entry> &entries = cell->second;
+        entries.erase(std::remove_if(entries.begin(), entries.end(),
+                        [slot](const Entry &e) { return e.slot == slot; }),
+                      entries.end());
+        if (entries.empty())
+            grid.erase(cell);
+    }
+
+    stored.cells.clear();
+    stored.plan.segments.clear();
+    freeSlots.push_back(slot);
+    slotByPlan.erase(found);
+    return true;
+}
+
+
+
+// Minimum distance between two linear motions over their common time interval.
+// Returns false if the segments do not overlap in time.
+static bool ClosestApproach(const PlanSegment &a, const PlanSegment &b,
+                            double &dist, double &time)
+{
+    double t1 = std::max(a.t1, b.t1);
+    double t2 = std::min(a.t2, b.t2);
+    if (t2 < t1) return false;
+
+    Eigen::Vector3d d0 = a.PositionAt(t1) - b.PositionAt(t1);
+    Eigen::Vector3d dv = a.Velocity() - b.Velocity();
+
+    double tau = 0;
+    double dv2 = dv.squaredNorm();
+    if (dv2 > 0)
+        tau = std::min(std::max(-d0.dot(dv) / dv2, 0.0), t2 - t1);
+
+    dist = (d0 + tau * dv).norm();
+    time = t1 + tau;
+    return true;
+}
+
+};
+
+} // namespace navsim
+
+#endif
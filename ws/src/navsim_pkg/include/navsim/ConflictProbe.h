@@ -0,0 +1,204 @@
+#ifndef NAVSIM_CONFLICTPROBE_H
+#define NAVSIM_CONFLICTPROBE_H
+
+// Short-term conflict probe over the predicted motion of the fleet.
+//
+// Every UAV is predicted over the horizon at regular steps. UAVs flying a
+// plan follow the plan, starting from their current position: the offset
+// to the planned position fades out over the blend time. Other UAVs keep
+// their current velocity. In each step every UAV moves in a straight line.
+// Candidate pairs come from a sweep-and-prune along x over the boxes of
+// those moves. The order of the sweep is kept from one step to the next,
+// so re-sorting it with an insertion sort is almost linear. Each candidate
+// pair is then solved exactly as two linear motions.
+
+#include "navsim/FlightPlanGeometry.h"
+
+#include <Eigen/Core>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_set>
+#include <vector>
+
+
+namespace navsim
+{
+
+struct PredictedConflict
+{
+    uint32_t i, j;              // UAV indexes (i < j)
+    double   timeToLoS;         // from the prediction time (0: already lost)
+    double   minDistance;       // closest approach within the step of the loss
+    Eigen::Vector3d pos1, pos2; // predicted positions at the loss of separation
+};
+
+
+
+class ConflictProbe
+{
+
+private:
+
+int numSteps = 0;
+std::vector<Eigen::Vector3d> track;   // UAV u, sample k: track[u * (numSteps+1) + k]
+std::vector<uint32_t> order;          // sweep order, kept between steps
+std::vector<double>   minX, maxX;
+std::unordered_set<uint64_t> found;
+
+
+static Eigen::Vector3d PlanPosition(const Plan4D &plan, double t, size_t &seg)
+{
+    const auto &segments = plan.segments;
+    if (t <= segments.front().t1) return segments.front().p1;   // waiting at the first waypoint
+    if (t >= segments.back().t2)  return segments.back().p2;    // holding at the last one
+
+    while (seg + 1 < segments.size() && segments[seg].t2 < t)
+        seg++;
+    return segments[seg].PositionAt(std::max(t, segments[seg].t1));
+}
+
+
+public:
+
+double horizon   = 60;   // [s]
+double step      = 1;    // [s]
+double blendTime = 5;    // [s]
+
+
+
+// 'plans[u]' may be null (UAV not flying a plan)
+std::vector<PredictedConflict> Run(double now, double threshold,
+                                   const std::vector<Eigen::Vector3d> &positions,
+                                   const std::vector<Eigen::Vector3d> &velocities,
+                                   const std::vector<const Plan4D*>   &plans)
+{
+    std::vector<PredictedConflict> conflicts;
+    uint32_t n = positions.size();
+    numSteps = std::max(1, int(std::ceil(horizon / step)));
+    int numSamples = numSteps + 1;
+
+    // Predicted tracks
+    track.resize(size_t(n) * numSamples);
+    for (uint32_t u = 0; u < n; u++)
+    {
+        Eigen::Vector3d *samples = &track[size_t(u) * numSamples];
+        const Plan4D *plan = plans[u];
+        if (plan == nullptr || plan->segments.empty())
+        {
+            for (int k = 0; k < numSamples; k++)
+                samples[k] = positions[u] + (k * step) * velocities[u];
+            continue;
+        }
+
+        size_t seg = 0;
+        Eigen::Vector3d offset = positions[u] - PlanPosition(*plan, now, seg);
+        for (int k = 0; k < numSamples; k++)
+        {
+            double tau = k * step;
+            double fade = std::max(0.0, 1.0 - tau / blendTime);
+            samples[k] = PlanPosition(*plan, now + tau, seg) + fade * offset;
+        }
+    }
+
+    // Sweep and prune, step by step
+    if (order.size() != n)
+    {
+        order.resize(n);
+        for (uint32_t u = 0; u < n; u++)
+            order[u] = u;
+    }
+    minX.resize(n);
+    maxX.resize(n);
+    found.clear();
+
+    double half = threshold / 2;
+    for (int k = 0; k < numSteps; k++)
+    {
+        for (uint32_t u = 0; u < n; u++)
+        {
+            const Eigen::Vector3d &a = track[size_t(u) * numSamples + k];
+            const Eigen::Vector3d &b = track[size_t(u) * numSamples + k + 1];
+            minX[u] = std::min(a.x(), b.x()) - half;
+            maxX[u] = std::max(a.x(), b.x()) + half;
+        }
+
+        // Insertion sort: the order barely changes between steps
+        for (uint32_t s = 1; s < n; s++)
+        {
+            uint32_t u = order[s];
+            uint32_t r = s;
+            while (r > 0 && minX[order[r-1]] > minX[u])
+            {
+                order[r] = order[r-1];
+                r--;
+            }
+            order[r] = u;
+        }
+
+        for (uint32_t s = 0; s < n; s++)
+        {
+            uint32_t u = order[s];
+            const Eigen::Vector3d &a1 = track[size_t(u) * numSamples + k];
+            const Eigen::Vector3d &a2 = track[size_t(u) * numSamples + k + 1];
+
+            for (uint32_t r = s + 1; r < n && minX[order[r]] <= maxX[u]; r++)
+            {
+                uint32_t v = order[r];
+                const Eigen::Vector3d &b1 = track[size_t(v) * numSamples + k];
+                const Eigen::Vector3d &b2 = track[size_t(v) * numSamples + k + 1];
+
+                // Boxes overlap in y and z?
+                Eigen::Vector3d loA = a1.cwiseMin(a2), hiA = a1.cwiseMax(a2);
+                Eigen::Vector3d loB = b1.cwiseMin(b2), hiB = b1.cwiseMax(b2);
+                if (loA.y() - hiB.y() > threshold || loB.y() - hiA.y() > threshold) continue;
+                if (loA.z() - hiB.z() > threshold || loB.z() - hiA.z() > threshold) continue;
+
+                uint32_t i = std::min(u, v), j = std::max(u, v);
+                uint64_t key = (uint64_t(i) << 32) | j;
+                if (found.count(key)) continue;
+
+                // Relative motion d(s) = d0 + dv*s, s in [0, step]
+                Eigen::Vector3d d0 = b1 - a1;
+                Eigen::Vector3d dv = ((b2 - b1) - (a2 - a1)) / step;
+
+                double a = dv.squaredNorm();
+                double b = 2 * d0.dot(dv);
+                double c = d0.squaredNorm() - threshold * threshold;
+                double sLoS;
+                if (c <= 0)
+                    sLoS = 0;
+                else
+                {
+                    double disc = b * b - 4 * a * c;
+                    if (a == 0 || disc < 0) continue;
+                    sLoS = (-b - std::sqrt(disc)) / (2 * a);
+                    if (sLoS < 0 || sLoS > step) continue;
+                }
+
+                double sMin = (a > 0) ? std::min(std::max(-d0.dot(dv) / a, 0.0), step) : 0;
+
+                PredictedConflict conflict;
+                conflict.i           = i;
+                conflict.j           = j;
+                conflict.timeToLoS   = k * step + sLoS;
+                conflict.minDistance = (d0 + sMin * dv).norm();
+                Eigen::Vector3d pu   = a1 + (a2 - a1) * (sLoS / step);
+                Eigen::Vector3d pv   = b1 + (b2 - b1) * (sLoS / step);
+                conflict.pos1        = (u == i) ? pu : pv;
+                conflict.pos2        = (u == i) ? pv : pu;
+                conflicts.push_back(conflict);
+                found.insert(key);
+            }
+        }
+    }
+
+    return conflicts;
+}
+
+};
+
+} // namespace navsim
+
+#endif
@@ -0,0 +1,230 @@
+#ifndef NAVSIM_FEASIBILITYCHECKER_H
+#define NAVSIM_FEASIBILITYCHECKER_H
+
+// Screening of flight plans against the limits of the airframe.
+//
+// UAM_minidrone_FP1 flies a route at constant velocity between waypoints. It
+// blends every velocity and heading change over its look-ahead time
+// (targetStep), and it clamps the yaw rate (maxVarAngVel). A plan that needs
+// more than the airframe can give does not fail at once. It only shows up as
+// a growing tracking error. Here the requirements of every segment of a batch
+// of plans are computed in one vectorized pass over all their waypoints.
+
+#include <Eigen/Core>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "navsim_msgs/msg/flight_plan.hpp"
+
+#include "navsim/core/PlanFollower.h"
+#include "navsim/core/Quadrotor.h"
+
+
+namespace navsim
+{
+
+struct AirframeLimits
+{
+    double maxSpeed;         // horizontal speed                  [m/s]
+    double maxClimbRate;     //                                    [m/s]
+    double maxDescentRate;   //                                    [m/s]
+    double maxAccel;         // horizontal acceleration            [m/s²]
+    double maxYawRate;       //                                    [rad/s]
+    double blendTime;        // navigation look-ahead              [s]
+};
+
+
+
+// Limits of an airframe flown by a PlanFollower. The linear controller is
+// designed around hovering, so the horizontal performance is given for a
+// maximum tilt instead of for the full thrust of the rotors.
+inline AirframeLimits AirframeLimitsOf(const QuadrotorParams &params, const PlanFollower &follower,
+                                       double maxTilt = 0.5)
+{
+    double weight    = params.mass * params.g;
+    double maxThrust = 4 * params.kFT * params.w_max * params.w_max;
+    double minThrust = 4 * params.kFT * params.w_min * params.w_min;
+
+    AirframeLimits limits;
+    limits.maxSpeed       = std::sqrt(weight * std::tan(maxTilt) / params.kFD.x());   // drag = tilted thrust
+    limits.maxClimbRate   = std::sqrt(std::max(maxThrust - weight, 0.0) / params.kFD.z());
+    limits.maxDescentRate = std::sqrt(std::max(weight - minThrust, 0.0) / params.kFD.z());
+    limits.maxAccel       = params.g * std::tan(maxTilt);
+    limits.maxYawRate     = follower.maxVarAngVel;
+    limits.blendTime      = follower.targetStep;
+    return limits;
+}
+
+// Limits of the UAM minidrone, as flown by UAM_minidrone_FP1
+inline AirframeLimits MinidroneLimits(double maxTilt = 0.5)
+{
+    return AirframeLimitsOf(QuadrotorParams::Minidrone(), PlanFollower(), maxTilt);
+}
+
+
+
+struct SegmentViolation
+{
+    enum Type { TIME = 0, SPEED = 1, CLIMB_RATE = 2, DESCENT_RATE = 3, ACCELERATION = 4, YAW_RATE = 5 };
+
+    uint32_t plan;       // index of the plan in the batch
+    uint32_t waypoint;   // waypoint ending the segment (or where the change happens)
+    Type     type;
+    double   required;
+    double   limit;
+};
+
+
+
+class FeasibilityChecker
+{
+
+private:
+
+AirframeLimits limits;
+
+// Waypoints of all the plans of the batch, one plan after the other
+Eigen::ArrayXd T, X, Y, Z;
+std::vector<uint32_t> planOf;      // plan of each waypoint
+std::vector<uint32_t> firstOf;     // first waypoint of the plan of each waypoint
+
+
+public:
+
+FeasibilityChecker(const AirframeLimits &l = MinidroneLimits())
+    : limits(l)
+{
+}
+
+
+
+const AirframeLimits &Limits() const
+{
+    return limits;
+}
+
+
+
+std::vector<SegmentViolation> Check(const std::vector<navsim_msgs::msg::FlightPlan> &plans)
+{
+    std::vector<SegmentViolation> violations;
+
+    size_t N = 0;
+    for (const navsim_msgs::msg::FlightPlan &fp : plans)
+        N += fp.route.size();
+    if (N < 2) return violations;
+
+    T.resize(N);
+    X.resize(N);
+    Y.resize(N);
+    Z.resize(N);
+    planOf.resize(N);
+    firstOf.resize(N);
+    size_t k = 0;
+    for (uint32_t p = 0; p < plans.size(); p++)
+    {
+        uint32_t first = k;
+        for (const navsim_msgs::msg::Waypoint &wp : plans[p].route)
+        {
+            T[k] = wp.time.sec + wp.time.nanosec * 1E-9;
+            X[k] = wp.pos.x;
+            Y[k] = wp.pos.y;
+            Z[k] = wp.pos.z;
+            planOf[k]  = p;
+            firstOf[k] = first;
+            k++;
+        }
+    }
+
+    // Segment k goes from waypoint k to waypoint k+1 (only if both are in the same plan)
+    const Eigen::Index M = N - 1;
+    Eigen::ArrayXd same(M);
+    for (Eigen::Index i = 0; i < M; i++)
+        same[i] = (planOf[i] == planOf[i+1]);
+
+    Eigen::ArrayXd dt = T.tail(M) - T.head(M);
+    Eigen::ArrayXd dx = X.tail(M) - X.head(M);
+    Eigen::ArrayXd dy = Y.tail(M) - Y.head(M);
+    Eigen::ArrayXd dz = Z.tail(M) - Z.head(M);
+    Eigen::ArrayXd h  = (dx.square() + dy.square()).sqrt();
+
+    Eigen::ArrayXd inv = (same > 0 && dt > 0).select(dt.inverse(), 0.0);
+    Eigen::ArrayXd vx  = dx * inv;
+    Eigen::ArrayXd vy  = dy * inv;
+    Eigen::ArrayXd vz  = dz * inv;
+    Eigen::ArrayXd vh  = h  * inv;
+
+    // Horizontal velocity change at every waypoint (the UAV waits at the first one and stops at the last one)
+    Eigen::ArrayXd ax(N), ay(N);
+    ax << vx.head(1), vx.tail(M-1) - vx.head(M-1), -vx.tail(1);
+    ay << vy.head(1), vy.tail(M-1) - vy.head(M-1), -vy.tail(1);
+    Eigen::ArrayXd accel = (ax.square() + ay.square()).sqrt() / limits.blendTime;
+
+    // Heading change at the start of every segment. The heading of segments
+    // shorter than 1 m (horizontally) is not defined: the UAV keeps its yaw.
+    Eigen::ArrayXd hx = (h >= 1).select(dx / h, 0.0);
+    Eigen::ArrayXd hy = (h >= 1).select(dy / h, 0.0);
+    Eigen::ArrayXd px = Eigen::ArrayXd::Zero(M), py = Eigen::ArrayXd::Zero(M);
+    double lastX = 0, lastY = 0;
+    for (Eigen::Index i = 0; i < M; i++)
+    {
+        if (i == 0 || !same[i-1]) lastX = lastY = 0;
+        if (!same[i]) continue;
+        px[i] = lastX;
+        py[i] = lastY;
+        if (h[i] >= 1)
+        {
+            lastX = hx[i];
+            lastY = hy[i];
+        }
+    }
+    Eigen::ArrayXd turn    = (hx * px + hy * py).max(-1.0).min(1.0).acos();
+    Eigen::ArrayXd hasTurn = (h >= 1 && (px != 0 || py != 0)).cast<double>();
+    Eigen::ArrayXd yawRate = hasTurn * turn / dt.max(1e-9).min(limits.blendTime);
+
+    auto add = [&](size_t wp, SegmentViolation::Type type, double required, double limit)
+    {
+        violations.push_back({planOf[wp], uint32_t(wp - firstOf[wp]), type, required, limit});
+    };
+
+    for (Eigen::Index i = 0; i < M; i++)
+    {
+        if (!same[i]) continue;
+
+        if (dt[i] <= 0)
+        {
+            add(i+1, SegmentViolation::TIME, dt[i], 0);
+            continue;
+        }
+        if (vh[i] > limits.maxSpeed)
+            add(i+1, SegmentViolation::SPEED, vh[i], limits.maxSpeed);
+        if (vz[i] > limits.maxClimbRate)
+            add(i+1, SegmentViolation::CLIMB_RATE, vz[i], limits.maxClimbRate);
+        if (-vz[i] > limits.maxDescentRate)
+            add(i+1, SegmentViolation::DESCENT_RATE, -vz[i], limits.maxDescentRate);
+        if (yawRate[i] > limits.maxYawRate)
+            add(i, SegmentViolation::YAW_RATE, yawRate[i], limits.maxYawRate);
+    }
+    for (size_t i = 0; i < N; i++)
+        if (accel[i] > limits.maxAccel)
+            add(i, SegmentViolation::ACCELERATION, accel[i], limits.maxAccel);
+
+    // Plan by plan, and waypoint by waypoint in each plan
+    std::stable_sort(violations.begin(), violations.end(),
+        [](const SegmentViolation &a, const SegmentViolation &b)
+        {
+            return a.plan < b.plan || (a.plan == b.plan && a.waypoint < b.waypoint);
+        });
+
+    return violations;
+}
+
+};
+
+} // namespace navsim
+
+#endif
@@ -0,0 +1,135 @@
+#ifndef NAVSIM_FLEETREGISTRY_H
+#define NAVSIM_FLEETREGISTRY_H
+
+// In-process registry of the UAVs flown by the NAVSIM drone plugins.
+//
+// Gazebo loads the World plugin and every drone plugin in the same server
+// process, so the fleet layer can read the drones' intent without going
+// through ROS topics. Each drone publishes its compiled flight plan here when
+// it receives it, and clears it when the plan is completed or aborted. The
+// World samples the wind field at the UAVs and leaves each one its wind here,
+// and flags the UAVs far from everything, which may fly a kinematic model.
+// Instance() is inline, so every plugin library resolves to the same object.
+
+#include "navsim/FlightPlanGeometry.h"
+
+#include <Eigen/Core>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+namespace navsim
+{
+
+class FleetRegistry
+{
+
+public:
+
+struct Entry
+{
+    std::shared_ptr<const Plan4D> plan;   // active flight plan (null: none)
+    Eigen::Vector3d wind = Eigen::Vector3d::Zero();   // at the UAV, world axes [m/s]
+    bool kinematic = false;               // far from other UAVs, obstacles and geofences
+};
+
+
+private:
+
+mutable std::mutex mutex;
+std::unordered_map<std::string, Entry> entries;
+
+FleetRegistry() = default;
+
+
+public:
+
+FleetRegistry(const FleetRegistry &) = delete;
+FleetRegistry &operator=(const FleetRegistry &) = delete;
+
+static FleetRegistry &Instance()
+{
+    static FleetRegistry registry;
+    return registry;
+}
+
+
+
+void SetPlan(const std::string &uav, std::shared_ptr<const Plan4D> plan)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    entries[uav].plan = std::move(plan);
+}
+
+
+
+void ClearPlan(const std::string &uav)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = entries.find(uav);
+    if (found != entries.end())
+        found->second.plan = nullptr;
+}
+
+
+
+void Remove(const std::string &uav)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.erase(uav);
+}
+
+
+
+std::shared_ptr<const Plan4D> Plan(const std::string &uav) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = entries.find(uav);
+    return (found == entries.end()) ? nullptr : found->second.plan;
+}
+
+
+
+void SetWinds(const std::vector<std::string> &uavs, const std::vector<Eigen::Vector3d> &winds)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (size_t i = 0; i < uavs.size(); i++)
+        entries[uavs[i]].wind = winds[i];
+}
+
+
+
+Eigen::Vector3d Wind(const std::string &uav) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = entries.find(uav);
+    return (found == entries.end()) ? Eigen::Vector3d::Zero() : found->second.wind;
+}
+
+
+
+void SetKinematic(const std::vector<std::string> &uavs, const std::vector<bool> &flags)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (size_t i = 0; i < uavs.size(); i++)
+        entries[uavs[i]].kinematic = flags[i];
+}
+
+
+
+bool Kinematic(const std::string &uav) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = entries.find(uav);
+    return (found != entries.end()) && found->second.kinematic;
+}
+
+};
+
+} // namespace navsim
+
+#endif
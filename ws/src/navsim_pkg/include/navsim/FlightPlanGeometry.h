@@ -0,0 +1,173 @@
+#ifndef NAVSIM_FLIGHTPLANGEOMETRY_H
+#define NAVSIM_FLIGHTPLANGEOMETRY_H
+
+// 4D (space + time) view of a NAVSIM flight plan.
+// The route is flown as straight segments between consecutive waypoints,
+// with linear interpolation in time (as UAM_minidrone_FP1::PositionAtTime).
+
+#include <Eigen/Core>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "builtin_interfaces/msg/time.hpp"
+#include "navsim_msgs/msg/flight_plan.hpp"
+
+#include "navsim/MemoryAccount.h"
+
+
+namespace navsim
+{
+
+inline double TimeToSec(const builtin_interfaces::msg::Time &t)
+{
+    return t.sec + t.nanosec * 1E-9;
+}
+
+inline builtin_interfaces::msg::Time SecToTime(double s)
+{
+    builtin_interfaces::msg::Time t;
+    t.sec     = static_cast<int32_t>(std::floor(s));
+    t.nanosec = static_cast<uint32_t>((s - std::floor(s)) * 1E9);
+    return t;
+}
+
+
+
+struct PlanSegment
+{
+    double t1, t2;          // start and end time  [s]
+    Eigen::Vector3d p1, p2; // start and end point [m]
+
+    Eigen::Vector3d Velocity() const
+    {
+        return (p2 - p1) / (t2 - t1);
+    }
+
+    Eigen::Vector3d PositionAt(double t) const
+    {
+        return p1 + (t - t1) * Velocity();
+    }
+};
+
+
+
+// Plan ids are chosen by each operator, so a plan is identified by its UAV and id
+struct PlanKey
+{
+    std::string uav;
+    uint16_t    id = 0;
+
+    bool operator==(const PlanKey &other) const { return id == other.id && uav == other.uav; }
+    bool operator!=(const PlanKey &other) const { return !(*this == other); }
+};
+
+struct PlanKeyHash
+{
+    size_t operator()(const PlanKey &key) const
+    {
+        return std::hash<std::string>()(key.uav) * 65599 + key.id;
+    }
+};
+
+
+
+struct Plan4D
+{
+    uint16_t    id = 0;
+    std::string uav;
+    double      radius = 0;
+    std::vector<PlanSegment, CountingAllocator<PlanSegment, MemoryCategory::Navigation>> segments;   // (navsim/MemoryAccount.h)
+
+    PlanKey Key() const { return {uav, id}; }
+
+    double InitTime()   const { return segments.empty() ? 0 : segments.front().t1; }
+    double FinishTime() const { return segments.empty() ? 0 : segments.back().t2;  }
+};
+
+
+
+// Key of a cell in a uniform 4D grid: 16 bits for x and y, 12 bits for z
+// and 20 bits for the time slice. Indices wrap around, so a key may be
+// shared by far away cells; users must confirm candidates with exact tests.
+inline uint64_t PackCell4D(long ix, long iy, long iz, long it)
+{
+    return  (static_cast<uint64_t>(ix) & 0xFFFF)
+         | ((static_cast<uint64_t>(iy) & 0xFFFF) << 16)
+         | ((static_cast<uint64_t>(iz) & 0x0FFF) << 32)
+         | ((static_cast<uint64_t>(it) & 0xFFFFF) << 44);
+}
+
+
+
+// Visits the cells of a uniform 4D grid touched by a segment swept by a sphere.
+// The segment is bounded separately in each time slice, so long segments only
+// touch the cells they cross instead of their whole bounding box.
+template <typename Visitor>
+void ForEachSweptCell(const PlanSegment &seg, double radius,
+                      const Eigen::Vector3d &cellSize, double timeSlice,
+                      Visitor &&visit)
+{
+    long it1 = static_cast<long>(std::floor(seg.t1 / timeSlice));
+    long it2 = static_cast<long>(std::floor(seg.t2 / timeSlice));
+
+    for (long it = it1; it <= it2; it++)
+    {
+        double ta = std::max(seg.t1,  it    * timeSlice);
+        double tb = std::min(seg.t2, (it+1) * timeSlice);
+        if (tb < ta) continue;
+
+        Eigen::Vector3d pa = seg.PositionAt(ta);
+        Eigen::Vector3d pb = seg.PositionAt(tb);
+        Eigen::Vector3d lo = (pa.cwiseMin(pb).array() - radius) / cellSize.array();
+        Eigen::Vector3d hi = (pa.cwiseMax(pb).array() + radius) / cellSize.array();
+
+        long x1 = std::floor(lo.x()), x2 = std::floor(hi.x());
+        long y1 = std::floor(lo.y()), y2 = std::floor(hi.y());
+        long z1 = std::floor(lo.z()), z2 = std::floor(hi.z());
+
+        for (long ix = x1; ix <= x2; ix++)
+            for (long iy = y1; iy <= y2; iy++)
+                for (long iz = z1; iz <= z2; iz++)
+                    visit(ix, iy, iz, it);
+    }
+}
+
+
+
+// Waypoints sharing the same time (or going back in time) are skipped
+inline Plan4D MakePlan4D(const navsim_msgs::msg::FlightPlan &fp)
+{
+    Plan4D plan;
+    plan.id     = fp.plan_id;
+    plan.uav    = fp.uav_id;
+    plan.radius = fp.radius;
+
+    int numWPs = fp.route.size();
+    plan.segments.reserve(numWPs > 0 ? numWPs - 1 : 0);
+
+    for (int i = 1; i < numWPs; i++)
+    {
+        const navsim_msgs::msg::Waypoint &WP1 = fp.route[i-1];
+        const navsim_msgs::msg::Waypoint &WP2 = fp.route[i];
+
+        PlanSegment seg;
+        seg.t1 = TimeToSec(WP1.time);
+        seg.t2 = TimeToSec(WP2.time);
+        if (seg.t2 <= seg.t1) continue;
+
+        seg.p1 = Eigen::Vector3d(WP1.pos.x, WP1.pos.y, WP1.pos.z);
+        seg.p2 = Eigen::Vector3d(WP2.pos.x, WP2.pos.y, WP2.pos.z);
+        plan.segments.push_back(seg);
+    }
+
+    return plan;
+}
+
+} // namespace navsim
+
+#endif
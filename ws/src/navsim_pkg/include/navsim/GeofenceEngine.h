@@ -0,0 +1,271 @@
+#ifndef NAVSIM_GEOFENCEENGINE_H
+#define NAVSIM_GEOFENCEENGINE_H
+
+// Geofences (no-fly zones) with an altitude band and an active time window.
+//
+// Fences are indexed in a 2D uniform grid by their horizontal bounding box,
+// so each UAV is only tested against the fences of the cell it is in. The
+// engine remembers which fences every UAV is inside, and reports intrusions
+// and exits as the difference between two consecutive evaluations.
+
+#include <Eigen/Core>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+namespace navsim
+{
+
+struct Geofence
+{
+    enum Shape { PRISM = 0, CYLINDER = 1 };
+
+    uint32_t id = 0;
+    Shape    shape = PRISM;
+    std::vector<Eigen::Vector2d> polygon;   // prism footprint
+    Eigen::Vector2d center = Eigen::Vector2d::Zero();
+    double   radius = 0;                    // cylinder radius
+    double   floor = 0, ceiling = 0;        // altitude band     [m]
+    double   start = 0, end = 0;            // active time window [s] (end <= 0: no end)
+
+
+    bool ActiveAt(double t) const
+    {
+        return start <= t && (end <= 0 || t <= end);
+    }
+
+    void Bounds(Eigen::Vector2d &lo, Eigen::Vector2d &hi) const
+    {
+        if (shape == CYLINDER)
+        {
+            lo = center.array() - radius;
+            hi = center.array() + radius;
+            return;
+        }
+        lo = hi = polygon.empty() ? Eigen::Vector2d::Zero() : polygon[0];
+        for (const Eigen::Vector2d &v : polygon)
+        {
+            lo = lo.cwiseMin(v);
+            hi = hi.cwiseMax(v);
+        }
+    }
+
+    bool Contains(const Eigen::Vector3d &p) const
+    {
+        if (p.z() < floor || ceiling < p.z()) return false;
+
+        if (shape == CYLINDER)
+            return (p.head<2>() - center).squaredNorm() <= radius * radius;
+
+        // Even-odd rule
+        bool inside = false;
+        size_t n = polygon.size();
+        for (size_t i = 0, j = n - 1; i < n; j = i++)
+        {
+            const Eigen::Vector2d &a = polygon[i];
+            const Eigen::Vector2d &b = polygon[j];
+            if ((a.y() > p.y()) != (b.y() > p.y()) &&
+                p.x() < (b.x() - a.x()) * (p.y() - a.y()) / (b.y() - a.y()) + a.x())
+                inside = !inside;
+        }
+        return inside;
+    }
+};
+
+
+
+struct GeofenceEvent
+{
+    std::string uav;
+    uint32_t    fence;
+    bool        intrusion;   // true: entering the fence, false: leaving it
+};
+
+
+
+class GeofenceEngine
+{
+
+private:
+
+double cellSize;
+uint32_t nextId = 1;
+
+std::unordered_map<uint32_t, Geofence> fences;
+std::unordered_map<uint64_t, std::vector<uint32_t>> grid;
+struct UAVState
+{
+    std::vector<uint32_t> fences;   // sorted ids of the fences the UAV is inside
+    uint64_t evaluation;            // last evaluation the UAV was listed in
+};
+std::unordered_map<std::string, UAVState> inside;   // only UAVs inside some fence
+std::vector<uint32_t> current;
+uint64_t evaluation = 0;
+
+
+uint64_t Key(long ix, long iy) const
+{
+    return (uint64_t(uint32_t(ix)) << 32) | uint32_t(iy);
+}
+
+template <typename Visitor>
+void ForEachCell(const Geofence &fence, Visitor &&visit) const
+{
+    Eigen::Vector2d lo, hi;
+    fence.Bounds(lo, hi);
+    for (long ix = std::floor(lo.x() / cellSize); ix <= std::floor(hi.x() / cellSize); ix++)
+        for (long iy = std::floor(lo.y() / cellSize); iy <= std::floor(hi.y() / cellSize); iy++)
+            visit(Key(ix, iy));
+}
+
+
+public:
+
+GeofenceEngine(double cell = 50)
+    : cellSize(cell)
+{
+}
+
+
+
+// Returns the id assigned to the fence
+uint32_t Add(Geofence fence)
+{
+    fence.id = nextId++;
+    ForEachCell(fence, [&](uint64_t key) { grid[key].push_back(fence.id); });
+    fences[fence.id] = std::move(fence);
+    return nextId - 1;
+}
+
+
+
+bool Remove(uint32_t id)
+{
+    auto found = fences.find(id);
+    if (found == fences.end()) return false;
+
+    ForEachCell(found->second, [&](uint64_t key)
+    {
+        std::vector<uint32_t> &ids = grid[key];
+        ids.erase(std::remove(ids.begin(), ids.end(), id), ids.end());
+        if (ids.empty()) grid.erase(key);
+    });
+    fences.erase(found);
+    return true;
+}
+
+
+
+std::vector<Geofence> List() const
+{
+    std::vector<Geofence> list;
+    list.reserve(fences.size());
+    for (const auto &f : fences)
+        list.push_back(f.second);
+    std::sort(list.begin(), list.end(),
+        [](const Geofence &a, const Geofence &b) { return a.id < b.id; });
+    return list;
+}
+
+
+
+// True if a fence active at time 't' is closer than 'margin' to 'p' (its
+// bounding box and altitude band, inflated by the margin)
+bool Near(double t, const Eigen::Vector3d &p, double margin) const
+{
+    for (long ix = std::floor((p.x() - margin) / cellSize); ix <= std::floor((p.x() + margin) / cellSize); ix++)
+    for (long iy = std::floor((p.y() - margin) / cellSize); iy <= std::floor((p.y() + margin) / cellSize); iy++)
+    {
+        auto cell = grid.find(Key(ix, iy));
+        if (cell == grid.end()) continue;
+
+        for (uint32_t id : cell->second)
+        {
+            const Geofence &fence = fences.at(id);
+            if (!fence.ActiveAt(t)) continue;
+            if (p.z() < fence.floor - margin || fence.ceiling + margin < p.z()) continue;
+
+            Eigen::Vector2d lo, hi;
+            fence.Bounds(lo, hi);
+            if ((p.head<2>().array() >= lo.array() - margin).all() &&
+                (p.head<2>().array() <= hi.array() + margin).all())
+                return true;
+        }
+    }
+    return false;
+}
+
+
+
+// Tests every UAV against the fences active at time 't'. UAVs not listed
+// anymore (removed from the world) are forgotten without events.
+std::vector<GeofenceEvent> Evaluate(double t,
+                                    const std::vector<std::string> &uavs,
+                                    const std::vector<Eigen::Vector3d> &positions)
+{
+    std::vector<GeofenceEvent> events;
+    evaluation++;
+
+    for (size_t i = 0; i < uavs.size(); i++)
+    {
+        const Eigen::Vector3d &p = positions[i];
+
+        current.clear();
+        auto cell = grid.find(Key(std::floor(p.x() / cellSize), std::floor(p.y() / cellSize)));
+        if (cell != grid.end())
+        {
+            for (uint32_t id : cell->second)
+            {
+                const Geofence &fence = fences.at(id);
+                if (fence.ActiveAt(t) && fence.Contains(p))
+                    current.push_back(id);
+            }
+            std::sort(current.begin(), current.end());
+        }
+
+        static const std::vector<uint32_t> none;
+        auto prev = inside.find(uavs[i]);
+        if (prev == inside.end() && current.empty()) continue;
+        const std::vector<uint32_t> &before = (prev == inside.end()) ? none : prev->second.fences;
+
+        // Sorted difference: fences entered and fences left
+        size_t a = 0, b = 0;
+        while (a < current.size() || b < before.size())
+        {
+            if (b == before.size() || (a < current.size() && current[a] < before[b]))
+                events.push_back({uavs[i], current[a++], true});
+            else if (a == current.size() || before[b] < current[a])
+                events.push_back({uavs[i], before[b++], false});
+            else
+                a++, b++;
+        }
+
+        if (current.empty())
+            inside.erase(prev);
+        else if (prev != inside.end())
+            prev->second = {current, evaluation};
+        else
+            inside[uavs[i]] = {current, evaluation};
+    }
+
+    for (auto it = inside.begin(); it != inside.end(); )
+    {
+        if (it->second.evaluation != evaluation)
+            it = inside.erase(it);
+        else
+            ++it;
+    }
+
+    return events;
+}
+
+};
+
+} // namespace navsim
+
+#endif
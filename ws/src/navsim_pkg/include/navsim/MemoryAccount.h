@@ -0,0 +1,320 @@
+#ifndef NAVSIM_MEMORYACCOUNT_H
+#define NAVSIM_MEMORYACCOUNT_H
+
+// Memory footprint of the drones, per UAV and category.
+//
+//   plugin      the drone plugin object (its Eigen members, controller, ...)
+//   navigation  NAVSIM structures allocated with CountingAllocator (the
+//               segments of the Plan4D flight plans)
+//   ros         heap grown while the plugin created its node, publishers and
+//               subscriptions (sampled)
+//   gazebo      heap grown from the insertion of the model to the start of
+//               its plugin: links, collisions, meshes (sampled)
+//
+// CountingAllocator charges the account of the calling thread (MemoryScope,
+// opened by the drone plugins over their Load and world update), or the
+// shared account (uav "", the World plugin and others) outside any scope.
+// Each block records its account, so it is credited back wherever it is freed.
+// The sampled categories are differences of the heap in use (mallinfo2) and,
+// as the world thread loads the models one after another, are only exact
+// while no other thread allocates meanwhile.
+//
+// The World plugin reports them on the NavSim/MemoryReport service.
+// Instance() is inline, so every plugin library resolves to the same object.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <malloc.h>
+#include <unistd.h>
+
+
+namespace navsim
+{
+
+enum class MemoryCategory
+{
+    Plugin,
+    Navigation,
+    Ros,
+    Gazebo,
+    Count
+};
+
+inline const char *MemoryCategoryName(MemoryCategory category)
+{
+    static const char *names[] = { "plugin", "navigation", "ros", "gazebo" };
+    return names[int(category)];
+}
+
+
+
+// Memory of the process [bytes]
+struct ProcessMemory
+{
+    int64_t rss  = 0;      // resident
+    int64_t heap = 0;      // in use by malloc (including its mmap'd blocks)
+
+    static ProcessMemory Sample()
+    {
+        ProcessMemory memory;
+
+        long pages = 0, resident = 0;
+        if (FILE *statm = fopen("/proc/self/statm", "r"))
+        {
+            if (fscanf(statm, "%ld %ld", &pages, &resident) != 2) resident = 0;
+            fclose(statm);
+        }
+        memory.rss = int64_t(resident) * sysconf(_SC_PAGESIZE);
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+        struct mallinfo2 info = mallinfo2();
+        memory.heap = int64_t(info.uordblks + info.hblkhd);
+#else
+        memory.heap = memory.rss;
+#endif
+        return memory;
+    }
+};
+
+
+
+// Bytes of one UAV (or of the shared structures) by category
+class MemoryAccount
+{
+
+public:
+
+const std::string uav;
+
+explicit MemoryAccount(const std::string &uav) : uav(uav) {}
+
+
+private:
+
+std::atomic<int64_t> bytes[int(MemoryCategory::Count)] = {};
+
+
+public:
+
+std::atomic<bool> alive{false};       // the plugin of the UAV is loaded
+
+void Add(MemoryCategory category, int64_t n)
+{
+    bytes[int(category)].fetch_add(n, std::memory_order_relaxed);
+}
+
+void Set(MemoryCategory category, int64_t n)
+{
+    bytes[int(category)].store(n, std::memory_order_relaxed);
+}
+
+int64_t Bytes(MemoryCategory category) const
+{
+    return bytes[int(category)].load(std::memory_order_relaxed);
+}
+
+};
+
+
+
+class MemoryRegistry
+{
+
+private:
+
+mutable std::mutex mutex;
+std::unordered_map<std::string, std::unique_ptr<MemoryAccount>> accounts;   // never freed (see CountingAllocator)
+MemoryAccount shared{""};
+
+// Heap at the insertion of a model, or at the end of the previous spawn
+int64_t baseline = 0;
+bool    expecting = false;
+bool    fresh     = false;           // Expect() since the last Settle()
+
+MemoryRegistry() = default;
+
+static MemoryAccount *&Current()
+{
+    static thread_local MemoryAccount *account = nullptr;
+    return account;
+}
+
+
+public:
+
+MemoryRegistry(const MemoryRegistry &) = delete;
+MemoryRegistry &operator=(const MemoryRegistry &) = delete;
+
+static MemoryRegistry &Instance()
+{
+    static MemoryRegistry registry;
+    return registry;
+}
+
+
+
+// Account charged by the allocations of this thread
+static MemoryAccount *Charged()
+{
+    MemoryAccount *account = Current();
+    return account ? account : &Instance().shared;
+}
+
+static void SetCharged(MemoryAccount *account)
+{
+    Current() = account;
+}
+
+
+
+// A model is about to be inserted (its gazebo bytes count from here)
+void Expect()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    fresh = true;
+    if (expecting) return;              // a batch: each spawn counts from the previous one
+    baseline  = ProcessMemory::Sample().heap;
+    expecting = true;
+}
+
+
+
+// The plugin of a UAV, of 'size' bytes, starts loading: its account (kept if
+// the UAV was spawned before), with the gazebo bytes of the model since Expect()
+MemoryAccount *Spawn(const std::string &uav, size_t size)
+{
+    int64_t heap = ProcessMemory::Sample().heap;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::unique_ptr<MemoryAccount> &account = accounts[uav];
+    if (!account) account = std::make_unique<MemoryAccount>(uav);
+    account->alive = true;
+    account->Set(MemoryCategory::Plugin, int64_t(size));
+    account->Set(MemoryCategory::Gazebo, expecting ? heap - baseline - int64_t(size) : 0);
+    return account.get();
+}
+
+
+
+// The plugin of the UAV is loaded
+void Spawned()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (expecting) baseline = ProcessMemory::Sample().heap;
+}
+
+
+
+// Called every world update: Gazebo loads the models inserted in an update
+// in the next one, then there are no more spawns to measure until Expect()
+void Settle()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (fresh)
+        fresh = false;
+    else
+        expecting = false;
+}
+
+
+
+// The plugin of the UAV is unloading
+void Release(MemoryAccount *account)
+{
+    if (!account) return;               // never loaded
+    account->alive = false;
+    account->Set(MemoryCategory::Plugin, 0);
+    account->Set(MemoryCategory::Ros, 0);
+    account->Set(MemoryCategory::Gazebo, 0);
+}
+
+
+
+// Accounts of the UAVs loaded, and the shared one
+std::vector<const MemoryAccount *> Accounts() const
+{
+    std::vector<const MemoryAccount *> alive;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto &account : accounts)
+        if (account.second->alive) alive.push_back(account.second.get());
+    return alive;
+}
+
+const MemoryAccount &Shared() const
+{
+    return shared;
+}
+
+};
+
+
+
+// Charges the allocations of this thread to 'account' while in scope
+class MemoryScope
+{
+MemoryAccount *previous;
+
+public:
+
+explicit MemoryScope(MemoryAccount *account) : previous(MemoryRegistry::Charged())
+{
+    MemoryRegistry::SetCharged(account);
+}
+
+~MemoryScope()
+{
+    MemoryRegistry::SetCharged(previous);
+}
+};
+
+
+
+// std allocator counting the bytes of its blocks in the charged account. The
+// account is recorded in front of each block.
+template <class T, MemoryCategory C>
+struct CountingAllocator
+{
+    using value_type = T;
+
+    template <class U> struct rebind { using other = CountingAllocator<U, C>; };
+
+    static constexpr size_t Header = alignof(std::max_align_t);
+    static_assert(alignof(T) <= Header, "over-aligned type");
+
+    CountingAllocator() = default;
+    template <class U> CountingAllocator(const CountingAllocator<U, C> &) {}
+
+    T *allocate(size_t n)
+    {
+        size_t size = n * sizeof(T);
+        char *block = static_cast<char *>(::operator new(size + Header));
+        MemoryAccount *account = MemoryRegistry::Charged();
+        *reinterpret_cast<MemoryAccount **>(block) = account;
+        account->Add(C, int64_t(size));
+        return reinterpret_cast<T *>(block + Header);
+    }
+
+    void deallocate(T *p, size_t n)
+    {
+        char *block = reinterpret_cast<char *>(p) - Header;
+        (*reinterpret_cast<MemoryAccount **>(block))->Add(C, -int64_t(n * sizeof(T)));
+        ::operator delete(block);
+    }
+
+    template <class U> bool operator==(const CountingAllocator<U, C> &) const { return true; }
+    template <class U> bool operator!=(const CountingAllocator<U, C> &) const { return false; }
+};
+
+} // namespace navsim
+
+#endif
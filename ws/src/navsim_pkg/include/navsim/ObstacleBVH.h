@@ -0,0 +1,212 @@
+#ifndef NAVSIM_OBSTACLEBVH_H
+#define NAVSIM_OBSTACLEBVH_H
+
+// Bounding volume hierarchy over the static obstacles of the world.
+//
+// Obstacles are axis aligned boxes (the world bounding box of each static
+// collision). The tree is stored as a flat array in depth-first order: an
+// inner node is followed by its left child, and keeps the index of the right
+// one. Swept-sphere queries inflate the boxes by the sphere radius, which is
+// conservative at the box edges and corners.
+
+#include <Eigen/Core>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+
+namespace navsim
+{
+
+struct Obstacle
+{
+    Eigen::Vector3d lo, hi;
+    std::string     name;
+};
+
+
+
+class ObstacleBVH
+{
+
+private:
+
+struct Node
+{
+    Eigen::Vector3d lo, hi;
+    int32_t right;   // inner node: index of the right child
+    int32_t first;   // leaf: first obstacle in 'order'
+    int32_t count;   // leaf: number of obstacles (0 for inner nodes)
+};
+
+static const int LeafSize = 4;
+
+std::vector<Obstacle> obstacles;
+std::vector<int32_t>  order;
+std::vector<Node>     nodes;
+
+
+int BuildNode(int first, int count)
+{
+    int index = nodes.size();
+    nodes.emplace_back();
+
+    Eigen::Vector3d lo = Eigen::Vector3d::Constant( std::numeric_limits<double>::infinity());
+    Eigen::Vector3d hi = Eigen::Vector3d::Constant(-std::numeric_limits<double>::infinity());
+    Eigen::Vector3d clo = lo, chi = hi;
+    for (int i = first; i < first + count; i++)
+    {
+        const Obstacle &o = obstacles[order[i]];
+        lo  = lo.cwiseMin(o.lo);
+        hi  = hi.cwiseMax(o.hi);
+        clo = clo.cwiseMin(0.5 * (o.lo + o.hi));
+        chi = chi.cwiseMax(0.5 * (o.lo + o.hi));
+    }
+    nodes[index].lo = lo;
+    nodes[index].hi = hi;
+
+    if (count <= LeafSize)
+    {
+        nodes[index].right = -1;
+        nodes[index].first = first;
+        nodes[index].count = count;
+        return index;
+    }
+
+    // Median split along the widest axis of the obstacle centers
+    int axis;
+    (chi - clo).maxCoeff(&axis);
+    int half = count / 2;
+    std::nth_element(order.begin() + first, order.begin() + first + half, order.begin() + first + count,
+        [&](int32_t a, int32_t b)
+        {
+            return obstacles[a].lo[axis] + obstacles[a].hi[axis] <
+                   obstacles[b].lo[axis] + obstacles[b].hi[axis];
+        });
+
+    BuildNode(first, half);
+    int right = BuildNode(first + half, count - half);
+
+    nodes[index].right = right;
+    nodes[index].first = -1;
+    nodes[index].count = 0;
+    return index;
+}
+
+
+// Parametric interval [s1, s2] of the segment p + s*d inside the box
+static bool SegmentBox(const Eigen::Vector3d &p, const Eigen::Vector3d &d,
+                       const Eigen::Vector3d &lo, const Eigen::Vector3d &hi,
+                       double &s1, double &s2)
+{
+    s1 = 0;
+    s2 = 1;
+    for (int a = 0; a < 3; a++)
+    {
+        if (d[a] == 0)
+        {
+            if (p[a] < lo[a] || hi[a] < p[a]) return false;
+            continue;
+        }
+        double inv = 1.0 / d[a];
+        double ta = (lo[a] - p[a]) * inv;
+        double tb = (hi[a] - p[a]) * inv;
+        if (ta > tb) std::swap(ta, tb);
+        s1 = std::max(s1, ta);
+        s2 = std::min(s2, tb);
+        if (s2 < s1) return false;
+    }
+    return true;
+}
+
+
+public:
+
+void Build(std::vector<Obstacle> obs)
+{
+    obstacles = std::move(obs);
+    order.resize(obstacles.size());
+    for (size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+
+    nodes.clear();
+    nodes.reserve(2 * obstacles.size() / LeafSize + 1);
+    if (!obstacles.empty())
+        BuildNode(0, obstacles.size());
+}
+
+
+
+size_t Size() const
+{
+    return obstacles.size();
+}
+
+
+
+const Obstacle &operator[](int i) const
+{
+    return obstacles[i];
+}
+
+
+
+// First contact of the segment p1->p2, swept by a sphere of the given radius,
+// with any obstacle. Only the part of the segment in [sLo, sHi] (as a fraction
+// of its length) is considered. Returns the obstacle index, or -1 if clear.
+int FirstHit(const Eigen::Vector3d &p1, const Eigen::Vector3d &p2, double radius,
+             double sLo, double sHi, double &sHit) const
+{
+    int hit = -1;
+    sHit = std::numeric_limits<double>::infinity();
+    if (nodes.empty() || sHi < sLo) return hit;
+
+    Eigen::Vector3d d = p2 - p1;
+    Eigen::Vector3d r = Eigen::Vector3d::Constant(radius);
+
+    int32_t stack[64];
+    int top = 0;
+    stack[top++] = 0;
+
+    while (top > 0)
+    {
+        const Node &node = nodes[stack[--top]];
+
+        double s1, s2;
+        if (!SegmentBox(p1, d, node.lo - r, node.hi + r, s1, s2)) continue;
+        s1 = std::max(s1, sLo);
+        s2 = std::min(s2, sHi);
+        if (s2 < s1 || sHit <= s1) continue;
+
+        if (node.count == 0)
+        {
+            stack[top++] = node.right;
+            stack[top++] = &node - nodes.data() + 1;
+            continue;
+        }
+
+        for (int i = node.first; i < node.first + node.count; i++)
+        {
+            const Obstacle &o = obstacles[order[i]];
+            if (!SegmentBox(p1, d, o.lo - r, o.hi + r, s1, s2)) continue;
+            s1 = std::max(s1, sLo);
+            s2 = std::min(s2, sHi);
+            if (s1 <= s2 && s1 < sHit)
+            {
+                sHit = s1;
+                hit  = order[i];
+            }
+        }
+    }
+
+    return hit;
+}
+
+};
+
+} // namespace navsim
+
+#endif
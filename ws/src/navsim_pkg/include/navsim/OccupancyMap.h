@@ -0,0 +1,235 @@
+#ifndef NAVSIM_OCCUPANCYMAP_H
+#define NAVSIM_OCCUPANCYMAP_H
+
+// Airspace occupancy and density map over a sparse 3D grid.
+//
+// The map only changes when a UAV moves to another cell: the count of the
+// cells it leaves and enters is updated, and the dwell time (UAV-seconds) of
+// a cell is accrued lazily, when its count changes or when it is read. Each
+// cell keeps the dwell time of the last 'numBuckets' periods in a ring, which
+// gives its time series and its total over the sliding window. Cells empty
+// for a whole window are dropped when a snapshot is taken.
+
+#include <Eigen/Core>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+namespace navsim
+{
+
+class OccupancyMap
+{
+
+private:
+
+struct Cell
+{
+    uint16_t count = 0;
+    double   lastAccrual = 0;   // dwell accrued up to this time
+    long     lastBucket  = 0;   // newest bucket in the ring
+    std::vector<float> dwell;   // ring of buckets
+};
+
+double cellSize;
+double bucketPeriod;
+int    numBuckets;
+
+std::unordered_map<uint64_t, Cell> cells;
+
+// UAVs of the last update and their cells
+std::vector<std::string> uavNames;
+std::vector<uint64_t>    uavKeys;
+std::vector<uint64_t>    newKeys;
+std::vector<float>       series;
+
+
+// 21 bits per axis, with the sign
+static uint64_t Key(long ix, long iy, long iz)
+{
+    return  (uint64_t(ix) & 0x1FFFFF)
+         | ((uint64_t(iy) & 0x1FFFFF) << 21)
+         | ((uint64_t(iz) & 0x1FFFFF) << 42);
+}
+
+static int32_t Unpack(uint64_t key, int shift)
+{
+    int32_t v = (key >> shift) & 0x1FFFFF;
+    return (v & 0x100000) ? v - 0x200000 : v;
+}
+
+long Bucket(double t) const
+{
+    return static_cast<long>(std::floor(t / bucketPeriod));
+}
+
+// Moves the ring forward to bucket 'b', clearing the buckets skipped
+void Advance(Cell &cell, long b) const
+{
+    if (b <= cell.lastBucket) return;
+    if (b - cell.lastBucket >= numBuckets)
+        std::fill(cell.dwell.begin(), cell.dwell.end(), 0.0f);
+    else
+        for (long k = cell.lastBucket + 1; k <= b; k++)
+            cell.dwell[k % numBuckets] = 0;
+    cell.lastBucket = b;
+}
+
+void Accrue(Cell &cell, double t) const
+{
+    if (cell.count > 0)
+    {
+        // Only the buckets still in the window matter
+        double from = std::max(cell.lastAccrual, (Bucket(t) - numBuckets + 1) * bucketPeriod);
+        for (long b = Bucket(from); from < t; b++)
+        {
+            Advance(cell, b);
+            double to = std::min(t, (b + 1) * bucketPeriod);
+            cell.dwell[b % numBuckets] += cell.count * (to - from);
+            from = to;
+        }
+    }
+    Advance(cell, Bucket(t));
+    cell.lastAccrual = t;
+}
+
+void Enter(uint64_t key, double t)
+{
+    Cell &cell = cells[key];
+    if (cell.dwell.empty())
+    {
+        cell.dwell.assign(numBuckets, 0.0f);
+        cell.lastAccrual = t;
+        cell.lastBucket  = Bucket(t);
+    }
+    Accrue(cell, t);
+    cell.count++;
+}
+
+void Leave(uint64_t key, double t)
+{
+    Cell &cell = cells[key];
+    Accrue(cell, t);
+    cell.count--;
+}
+
+
+public:
+
+OccupancyMap(double cell = 5, double bucket = 10, int buckets = 6)
+    : cellSize(cell), bucketPeriod(bucket), numBuckets(std::max(1, buckets))
+{
+}
+
+
+
+double CellSize()     const { return cellSize; }
+double BucketPeriod() const { return bucketPeriod; }
+int    NumBuckets()   const { return numBuckets; }
+size_t Cells()        const { return cells.size(); }
+
+
+
+void Clear()
+{
+    cells.clear();
+    uavNames.clear();
+    uavKeys.clear();
+}
+
+
+
+// Moves the UAVs to their current cells. UAVs not listed anymore leave the map.
+void Update(double t, const std::vector<std::string> &names, const std::vector<Eigen::Vector3d> &positions)
+{
+    newKeys.resize(names.size());
+    for (size_t i = 0; i < names.size(); i++)
+    {
+        const Eigen::Vector3d &p = positions[i];
+        newKeys[i] = Key(std::floor(p.x() / cellSize), std::floor(p.y() / cellSize), std::floor(p.z() / cellSize));
+    }
+
+    // Usually the same UAVs in the same order as in the last update
+    if (names == uavNames)
+    {
+        for (size_t i = 0; i < names.size(); i++)
+        {
+            if (newKeys[i] == uavKeys[i]) continue;
+            Leave(uavKeys[i], t);
+            Enter(newKeys[i], t);
+        }
+    }
+    else
+    {
+        std::unordered_map<std::string, uint64_t> previous;
+        for (size_t i = 0; i < uavNames.size(); i++)
+            previous[uavNames[i]] = uavKeys[i];
+
+        for (size_t i = 0; i < names.size(); i++)
+        {
+            auto found = previous.find(names[i]);
+            if (found == previous.end())
+                Enter(newKeys[i], t);
+            else
+            {
+                if (found->second != newKeys[i])
+                {
+                    Leave(found->second, t);
+                    Enter(newKeys[i], t);
+                }
+                previous.erase(found);
+            }
+        }
+        for (const auto &gone : previous)
+            Leave(gone.second, t);
+
+        uavNames = names;
+    }
+
+    uavKeys.swap(newKeys);
+}
+
+
+
+// Calls visit(ix, iy, iz, count, dwell, series) for every cell occupied now
+// or within the window. 'dwell' is the total over the window (UAV-seconds),
+// and 'series' points to 'numBuckets' values per bucket, oldest first.
+template <typename Visitor>
+void Snapshot(double t, Visitor &&visit)
+{
+    series.resize(numBuckets);
+
+    for (auto it = cells.begin(); it != cells.end(); )
+    {
+        Cell &cell = it->second;
+        Accrue(cell, t);
+
+        double dwell = 0;
+        for (int k = 0; k < numBuckets; k++)
+        {
+            series[k] = cell.dwell[(cell.lastBucket + 1 + k) % numBuckets];
+            dwell += series[k];
+        }
+
+        if (cell.count == 0 && dwell == 0)
+        {
+            it = cells.erase(it);
+            continue;
+        }
+
+        visit(Unpack(it->first, 0), Unpack(it->first, 21), Unpack(it->first, 42),
+              cell.count, dwell, series.data());
+        ++it;
+    }
+}
+
+};
+
+} // namespace navsim
+
+#endif
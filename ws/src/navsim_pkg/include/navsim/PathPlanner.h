@@ -0,0 +1,332 @@
+#ifndef NAVSIM_PATHPLANNER_H
+#define NAVSIM_PATHPLANNER_H
+
+// Obstacle-free 3D path planning over a voxelized model of the world.
+//
+// The static obstacles are rasterized, inflated by the clearance, into a
+// uniform occupancy grid (cells outside the grid are blocked). Paths are
+// searched with Lazy Theta*, an any-angle variant of A* that links every cell
+// to the farthest ancestor in line of sight and only verifies that line when
+// the cell is expanded, so paths are short polylines without grid zigzags.
+// Batches of queries are spread over a set of worker threads, each one with
+// its own search buffers; the grid is shared read-only.
+
+#include "navsim/ObstacleBVH.h"
+
+#include <Eigen/Core>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+
+namespace navsim
+{
+
+class VoxelGrid
+{
+
+private:
+
+Eigen::Vector3d origin = Eigen::Vector3d::Zero();
+double cell = 1;
+int nx = 0, ny = 0, nz = 0;
+std::vector<uint8_t> blocked;
+
+
+public:
+
+// Rasterizes the obstacles inflated by 'clearance' in the box [lo, hi].
+// Returns false if the grid would be too large.
+bool Build(const ObstacleBVH &obstacles, const Eigen::Vector3d &lo, const Eigen::Vector3d &hi,
+           double cellSize, double clearance, size_t maxCells = size_t(1) << 28)
+{
+    cell   = cellSize;
+    origin = lo;
+    nx = std::max(1.0, std::ceil((hi.x() - lo.x()) / cell));
+    ny = std::max(1.0, std::ceil((hi.y() - lo.y()) / cell));
+    nz = std::max(1.0, std::ceil((hi.z() - lo.z()) / cell));
+    if (size_t(nx) * ny * nz > maxCells)
+    {
+        nx = ny = nz = 0;
+        blocked.clear();
+        return false;
+    }
+    blocked.assign(size_t(nx) * ny * nz, 0);
+
+    for (size_t i = 0; i < obstacles.Size(); i++)
+    {
+        Eigen::Vector3i c1 = CellOf(obstacles[i].lo.array() - clearance).cwiseMax(0);
+        Eigen::Vector3i c2 = CellOf(obstacles[i].hi.array() + clearance).cwiseMin(Eigen::Vector3i(nx-1, ny-1, nz-1));
+        for (int iz = c1.z(); iz <= c2.z(); iz++)
+            for (int iy = c1.y(); iy <= c2.y(); iy++)
+                for (int ix = c1.x(); ix <= c2.x(); ix++)
+                    blocked[Index(ix, iy, iz)] = 1;
+    }
+    return true;
+}
+
+
+
+int32_t Index(int ix, int iy, int iz) const
+{
+    return ix + nx * (iy + ny * iz);
+}
+
+Eigen::Vector3i Cell(int32_t index) const
+{
+    return Eigen::Vector3i(index % nx, (index / nx) % ny, index / (nx * ny));
+}
+
+Eigen::Vector3i CellOf(const Eigen::Vector3d &p) const
+{
+    return ((p - origin) / cell).array().floor().cast<int>();
+}
+
+Eigen::Vector3d Center(const Eigen::Vector3i &c) const
+{
+    return origin + (c.cast<double>().array() + 0.5).matrix() * cell;
+}
+
+bool Blocked(int ix, int iy, int iz) const
+{
+    if (ix < 0 || iy < 0 || iz < 0 || ix >= nx || iy >= ny || iz >= nz) return true;
+    return blocked[Index(ix, iy, iz)];
+}
+
+bool Blocked(const Eigen::Vector3i &c) const
+{
+    return Blocked(c.x(), c.y(), c.z());
+}
+
+
+
+// True if the segment p1->p2 only crosses free cells (3D DDA traversal)
+bool LineOfSight(const Eigen::Vector3d &p1, const Eigen::Vector3d &p2) const
+{
+    Eigen::Vector3d a = (p1 - origin) / cell;
+    Eigen::Vector3d d = (p2 - origin) / cell - a;
+    Eigen::Vector3i c   = a.array().floor().cast<int>();
+    Eigen::Vector3i end = CellOf(p2);
+    if (Blocked(c)) return false;
+
+    Eigen::Vector3i step;
+    Eigen::Vector3d tMax, tDelta;
+    for (int k = 0; k < 3; k++)
+    {
+        if (d[k] > 0)
+        {
+            step[k]   = 1;
+            tMax[k]   = (c[k] + 1 - a[k]) / d[k];
+            tDelta[k] = 1 / d[k];
+        }
+        else if (d[k] < 0)
+        {
+            step[k]   = -1;
+            tMax[k]   = (a[k] - c[k]) / -d[k];
+            tDelta[k] = -1 / d[k];
+        }
+        else
+        {
+            step[k]   = 0;
+            tMax[k]   = tDelta[k] = std::numeric_limits<double>::infinity();
+        }
+    }
+
+    int steps = (end - c).cwiseAbs().sum();
+    for (int i = 0; i < steps; i++)
+    {
+        int k;
+        if (tMax.minCoeff(&k) > 1) break;
+        c[k]    += step[k];
+        tMax[k] += tDelta[k];
+        if (Blocked(c)) return false;
+    }
+    return true;
+}
+
+};
+
+
+
+class PathPlanner
+{
+
+private:
+
+struct Node
+{
+    float   g;        // cost from the start [cells]
+    int32_t parent;
+    bool    closed;
+};
+
+typedef std::pair<float, int32_t> OpenEntry;
+
+std::unordered_map<int32_t, Node> nodes;
+std::priority_queue<OpenEntry, std::vector<OpenEntry>, std::greater<OpenEntry>> open;
+
+
+static float Distance(const Eigen::Vector3i &a, const Eigen::Vector3i &b)
+{
+    return (a - b).cast<float>().norm();
+}
+
+
+public:
+
+size_t maxExpansions = 2000000;   // give up (unreachable goal) after this many
+float  weight = 1.5;                // heuristic inflation: far fewer expansions, slightly longer paths
+size_t expansions = 0;              // of the last search
+
+
+// Path from 'start' to 'goal' as a polyline, or empty if there is none
+std::vector<Eigen::Vector3d> Plan(const VoxelGrid &grid, const Eigen::Vector3d &start, const Eigen::Vector3d &goal)
+{
+    std::vector<Eigen::Vector3d> path;
+
+    Eigen::Vector3i startCell = grid.CellOf(start);
+    Eigen::Vector3i goalCell  = grid.CellOf(goal);
+    if (grid.Blocked(startCell) || grid.Blocked(goalCell)) return path;
+
+    // Most routes over a city are direct
+    if (grid.LineOfSight(start, goal))
+        return {start, goal};
+
+    int32_t s0 = grid.Index(startCell.x(), startCell.y(), startCell.z());
+    int32_t sG = grid.Index(goalCell.x(),  goalCell.y(),  goalCell.z());
+
+    nodes.clear();
+    open = decltype(open)();
+    nodes[s0] = {0, s0, false};
+    open.push({weight * Distance(startCell, goalCell), s0});
+
+    expansions = 0;
+    bool found = false;
+    while (!open.empty())
+    {
+        OpenEntry top = open.top();
+        open.pop();
+
+        int32_t s = top.second;
+        Node &node = nodes[s];
+        Eigen::Vector3i cs = grid.Cell(s);
+        if (node.closed || top.first > node.g + weight * Distance(cs, goalCell) + 1e-3f) continue;   // stale entry
+
+        // Lazy Theta*: the parent was assumed to be in line of sight, verify it now
+        if (node.parent != s && !grid.LineOfSight(grid.Center(grid.Cell(node.parent)), grid.Center(cs)))
+        {
+            node.g = std::numeric_limits<float>::infinity();
+            for (int dz = -1; dz <= 1; dz++)
+            for (int dy = -1; dy <= 1; dy++)
+            for (int dx = -1; dx <= 1; dx++)
+            {
+                Eigen::Vector3i cn = cs + Eigen::Vector3i(dx, dy, dz);
+                if ((dx == 0 && dy == 0 && dz == 0) || grid.Blocked(cn)) continue;
+                auto n = nodes.find(grid.Index(cn.x(), cn.y(), cn.z()));
+                if (n == nodes.end() || !n->second.closed) continue;
+                float g = n->second.g + Distance(cn, cs);
+                if (g < node.g)
+                {
+                    node.g      = g;
+                    node.parent = n->first;
+                }
+            }
+        }
+
+        if (s == sG)
+        {
+            found = true;
+            break;
+        }
+        node.closed = true;
+        if (++expansions > maxExpansions) break;
+
+        int32_t p = node.parent;
+        Eigen::Vector3i cp = grid.Cell(p);
+        float gp = nodes[p].g;
+
+        for (int dz = -1; dz <= 1; dz++)
+        for (int dy = -1; dy <= 1; dy++)
+        for (int dx = -1; dx <= 1; dx++)
+        {
+            Eigen::Vector3i cn = cs + Eigen::Vector3i(dx, dy, dz);
+            if ((dx == 0 && dy == 0 && dz == 0) || grid.Blocked(cn)) continue;
+
+            int32_t n = grid.Index(cn.x(), cn.y(), cn.z());
+            float g = gp + Distance(cp, cn);
+            auto inserted = nodes.emplace(n, Node{g, p, false});
+            Node &next = inserted.first->second;
+            if (!inserted.second)
+            {
+                if (next.closed || next.g <= g) continue;
+                next.g      = g;
+                next.parent = p;
+            }
+            open.push({g + weight * Distance(cn, goalCell), n});
+        }
+    }
+    if (!found) return path;
+
+    // Cell centers from the goal back to the start
+    for (int32_t s = sG; ; s = nodes[s].parent)
+    {
+        path.push_back(grid.Center(grid.Cell(s)));
+        if (nodes[s].parent == s) break;
+    }
+    std::reverse(path.begin(), path.end());
+
+    // Exact end points (the segments from them to the centers of their cells are clear)
+    if (path.size() > 2 && grid.LineOfSight(start, path[1]))
+        path.front() = start;
+    else
+        path.insert(path.begin(), start);
+    if (path.size() > 2 && grid.LineOfSight(path[path.size() - 2], goal))
+        path.back() = goal;
+    else
+        path.push_back(goal);
+
+    return path;
+}
+
+};
+
+
+
+// Plans every (start, goal) query on 'numThreads' workers; failed queries get an empty path
+inline std::vector<std::vector<Eigen::Vector3d>> PlanBatch(const VoxelGrid &grid,
+                                                           const std::vector<Eigen::Vector3d> &starts,
+                                                           const std::vector<Eigen::Vector3d> &goals,
+                                                           int numThreads)
+{
+    std::vector<std::vector<Eigen::Vector3d>> paths(starts.size());
+    std::atomic<size_t> next(0);
+
+    auto worker = [&]()
+    {
+        PathPlanner planner;
+        for (size_t i = next++; i < starts.size(); i = next++)
+            paths[i] = planner.Plan(grid, starts[i], goals[i]);
+    };
+
+    numThreads = std::max(1, std::min<int>(numThreads, starts.size()));
+    std::vector<std::thread> threads;
+    for (int i = 1; i < numThreads; i++)
+        threads.emplace_back(worker);
+    worker();
+    for (std::thread &t : threads)
+        t.join();
+
+    return paths;
+}
+
+} // namespace navsim
+
+#endif
@@ -0,0 +1,338 @@
+#ifndef NAVSIM_PROFILER_H
+#define NAVSIM_PROFILER_H
+
+// Always-on timing of the phases of the world update of the NAVSIM plugins.
+//
+// A phase function opens NAVSIM_PROFILE(phase) and its duration (in ticks of
+// the timestamp counter on x86, of steady_clock elsewhere) goes to a log-linear
+// histogram of the calling thread: 8 linear buckets per power of two, so any
+// percentile is within 12.5 %. Each thread only writes
+// its own histograms (relaxed atomics, no locks); the World plugin sums them
+// and publishes the percentiles of every period on /NavSim/Stats. A drone also
+// opens NAVSIM_PROFILE_UAV over its whole update, for the per-UAV outliers.
+//
+// While the tracer (navsim/Tracer.h) is enabled, the phases are also recorded
+// as events of the trace, tagged with the UAV of the NAVSIM_PROFILE_UAV scope.
+//
+// Configured with -DNAVSIM_ENABLE_PROFILING=OFF the macros expand to nothing.
+// Instance() is inline, so every plugin library resolves to the same object.
+
+#include "navsim/Tracer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+namespace navsim
+{
+
+enum class Phase
+{
+    Navigation,          // drone plugins
+    ServoControl,
+    PlatformDynamics,
+    KinematicDynamics,
+    Telemetry,
+    CheckROS,
+    UavUpdate,           // whole update of a drone
+    TimeBroadcast,       // World plugin
+    WorldCheckROS,
+    Count
+};
+
+inline const char *PhaseName(Phase phase)
+{
+    static const char *names[] = { "Navigation", "ServoControl", "PlatformDynamics", "KinematicDynamics",
+                                   "Telemetry", "CheckROS", "UavUpdate", "TimeBroadcast", "WorldCheckROS" };
+    return names[int(phase)];
+}
+
+
+
+// Durations [ticks] of a phase in a single thread (one writer, any readers)
+class TimeHistogram
+{
+
+public:
+
+static constexpr int SubBits = 3;
+static constexpr int Sub     = 1 << SubBits;
+static constexpr int Buckets = (64 - SubBits + 1) * Sub;
+
+// Exact below 2 * Sub ticks, then Sub buckets per power of two
+static int Bucket(uint64_t ticks)
+{
+    if (ticks < Sub) return int(ticks);
+    int e = 63 - __builtin_clzll(ticks);
+    return (e - SubBits + 1) * Sub + int((ticks >> (e - SubBits)) & (Sub - 1));
+}
+
+// Middle of the bucket [ticks]
+static double Value(int bucket)
+{
+    if (bucket < 2 * Sub) return bucket;
+    int e = bucket / Sub + SubBits - 1;
+    uint64_t width = uint64_t(1) << (e - SubBits);
+    return double((Sub + bucket % Sub) * width) + 0.5 * width;
+}
+
+
+private:
+
+std::atomic<uint64_t> counts[Buckets] = {};
+std::atomic<uint64_t> max{0};      // since the last TakeMax()
+
+
+public:
+
+void Add(uint64_t ticks)
+{
+    std::atomic<uint64_t> &count = counts[Bucket(ticks)];
+    count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    if (ticks > max.load(std::memory_order_relaxed))
+        max.store(ticks, std::memory_order_relaxed);
+}
+
+
+
+// Adds the counts (since the start) to 'total', of Buckets elements
+void Accumulate(std::vector<uint64_t> &total) const
+{
+    for (int b = 0; b < Buckets; b++)
+        total[b] += counts[b].load(std::memory_order_relaxed);
+}
+
+
+
+uint64_t TakeMax()
+{
+    return max.exchange(0, std::memory_order_relaxed);
+}
+
+};
+
+
+
+// Whole updates of one drone (written by its plugin only)
+struct UavTimes
+{
+    std::string uav;
+    int traceUav = -1;                 // interned in the tracer
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> sum{0};      // [ticks]
+    std::atomic<uint64_t> max{0};      // [ticks] since the last read
+
+    void Add(uint64_t ticks)
+    {
+        count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        sum.store(sum.load(std::memory_order_relaxed) + ticks, std::memory_order_relaxed);
+        if (ticks > max.load(std::memory_order_relaxed))
+            max.store(ticks, std::memory_order_relaxed);
+    }
+};
+
+
+
+class Profiler
+{
+
+public:
+
+struct ThreadTimes
+{
+    TimeHistogram phases[int(Phase::Count)];
+};
+
+
+private:
+
+mutable std::mutex mutex;                                 // registration and reading only
+std::vector<std::unique_ptr<ThreadTimes>> threads;        // kept after the thread ends
+std::unordered_map<std::string, std::weak_ptr<UavTimes>> uavs;
+
+Profiler()
+{
+    navsim::SecondsPerTick();     // starts the calibration
+}
+
+
+public:
+
+Profiler(const Profiler &) = delete;
+Profiler &operator=(const Profiler &) = delete;
+
+static Profiler &Instance()
+{
+    static Profiler profiler;
+    return profiler;
+}
+
+
+
+TimeHistogram &Histogram(Phase phase)
+{
+    static thread_local ThreadTimes *local = nullptr;
+    if (!local)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        threads.push_back(std::make_unique<ThreadTimes>());
+        local = threads.back().get();
+    }
+    return local->phases[int(phase)];
+}
+
+
+
+double SecondsPerTick() const
+{
+    return navsim::SecondsPerTick();
+}
+
+
+
+// Times of a drone, registered while its plugin keeps the pointer
+std::shared_ptr<UavTimes> Uav(const std::string &uav)
+{
+    auto times = std::make_shared<UavTimes>();
+    times->uav = uav;
+    times->traceUav = Tracer::Instance().Intern(uav);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    uavs[uav] = times;
+    return times;
+}
+
+
+
+// Counts of the phase since the start, summed over the threads, and the
+// maximum since the previous call
+void Collect(Phase phase, std::vector<uint64_t> &counts, uint64_t &max)
+{
+    counts.assign(TimeHistogram::Buckets, 0);
+    max = 0;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto &thread : threads)
+    {
+        thread->phases[int(phase)].Accumulate(counts);
+        max = std::max(max, thread->phases[int(phase)].TakeMax());
+    }
+}
+
+
+
+// Drones still flying (the others are forgotten)
+std::vector<std::shared_ptr<UavTimes>> Uavs()
+{
+    std::vector<std::shared_ptr<UavTimes>> alive;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto it = uavs.begin(); it != uavs.end(); )
+    {
+        if (auto times = it->second.lock())
+        {
+            alive.push_back(times);
+            ++it;
+        }
+        else
+            it = uavs.erase(it);
+    }
+    return alive;
+}
+
+};
+
+
+
+// Percentile [ticks] of the counts of a histogram (0 when empty)
+inline double Percentile(const std::vector<uint64_t> &counts, double fraction)
+{
+    uint64_t total = 0;
+    for (uint64_t c : counts) total += c;
+    if (total == 0) return 0;
+
+    uint64_t rank = std::max<uint64_t>(1, uint64_t(std::ceil(fraction * total)));
+    uint64_t seen = 0;
+    for (size_t b = 0; b < counts.size(); b++)
+    {
+        seen += counts[b];
+        if (seen >= rank) return TimeHistogram::Value(int(b));
+    }
+    return TimeHistogram::Value(int(counts.size()) - 1);
+}
+
+
+
+class ProfileScope
+{
+TimeHistogram &histogram;
+Phase phase;
+uint64_t start;
+
+public:
+
+explicit ProfileScope(Phase phase)
+    : histogram(Profiler::Instance().Histogram(phase)), phase(phase), start(Ticks()) {}
+
+~ProfileScope()
+{
+    uint64_t end = Ticks();
+    histogram.Add(end - start);
+    if (Tracer::Instance().Enabled())
+        Tracer::Instance().Record(PhaseName(phase), "phase", start, end);
+}
+};
+
+
+
+// The UavUpdate phase, also added to the times of the drone
+class UavProfileScope
+{
+TimeHistogram &histogram;
+UavTimes *times;
+uint64_t start;
+
+public:
+
+explicit UavProfileScope(UavTimes *times)
+    : histogram(Profiler::Instance().Histogram(Phase::UavUpdate)), times(times),
+      start(Ticks())
+{
+    Tracer::SetUav(times ? times->traceUav : -1);
+}
+
+~UavProfileScope()
+{
+    uint64_t end = Ticks();
+    histogram.Add(end - start);
+    if (times) times->Add(end - start);
+    if (Tracer::Instance().Enabled())
+        Tracer::Instance().Record(PhaseName(Phase::UavUpdate), "phase", start, end);
+    Tracer::SetUav(-1);
+}
+};
+
+} // namespace navsim
+
+
+
+#ifndef NAVSIM_ENABLE_PROFILING
+#define NAVSIM_ENABLE_PROFILING 1
+#endif
+
+#if NAVSIM_ENABLE_PROFILING
+#define NAVSIM_PROFILE(phase)      navsim::ProfileScope    navsimProfileScope(phase)
+#define NAVSIM_PROFILE_UAV(times)  navsim::UavProfileScope navsimUavProfileScope(times)
+#else
+#define NAVSIM_PROFILE(phase)
+#define NAVSIM_PROFILE_UAV(times)
+#endif
+
+#endif
@@ -0,0 +1,200 @@
+#ifndef NAVSIM_RESERVATIONTABLE_H
+#define NAVSIM_RESERVATIONTABLE_H
+
+// 4D airspace reservation table for strategic flight plan admission.
+//
+// Space and time are voxelized in cells (e.g. 10 m x 10 m x 5 m x 1 s). An
+// accepted plan owns every cell touched by its route swept by the plan
+// radius, so admitting a candidate is one hash probe per cell it touches,
+// independent of the number of accepted plans. Cells are evicted when their
+// time slice is in the past, and released when their plan ends. Plans are
+// identified by their UAV and id (PlanKey), as ids are chosen per operator.
+
+#include "navsim/FlightPlanGeometry.h"
+
+#include <map>
+#include <unordered_map>
+
+
+namespace navsim
+{
+
+struct Reservation
+{
+    bool            accepted;
+    uint16_t        conflictPlan;   // owner of the first conflicting cell
+    std::string     conflictUav;
+    Eigen::Vector3d conflictCell;   // center of the first conflicting cell
+    double          conflictTime;   // start of its time slice
+};
+
+
+
+class ReservationTable
+{
+
+private:
+
+Eigen::Vector3d cellSize;
+double timeSlice;
+
+struct PlanCells
+{
+    PlanKey plan;
+    double finish;                // plan finish time
+    std::vector<uint64_t> keys;   // may include cells already evicted
+};
+
+// Cells are owned by a reservation number, to keep the UAV ids out of the cells
+std::unordered_map<uint64_t, uint32_t> owner;
+std::unordered_map<uint32_t, PlanCells> cellsByPlan;
+std::unordered_map<PlanKey, uint32_t, PlanKeyHash> reservationOf;
+uint32_t nextReservation = 0;
+std::map<long, std::vector<uint64_t>> cellsBySlice;
+long firstSlice = 0;   // slices before this one have been evicted
+
+
+public:
+
+ReservationTable(double cellXY = 10, double cellZ = 5, double slice = 1)
+    : cellSize(cellXY, cellXY, cellZ), timeSlice(slice)
+{
+}
+
+
+
+size_t Cells() const
+{
+    return owner.size();
+}
+
+
+
+// Probes the cells of the plan; a plan does not conflict with itself
+Reservation Check(const Plan4D &plan) const
+{
+    Reservation result;
+    result.accepted = true;
+
+    auto own = reservationOf.find(plan.Key());
+    uint32_t self = (own != reservationOf.end()) ? own->second : nextReservation;   // none
+
+    for (const PlanSegment &seg : plan.segments)
+    {
+        ForEachSweptCell(seg, plan.radius, cellSize, timeSlice,
+            [&](long ix, long iy, long iz, long it)
+            {
+                if (!result.accepted || it < firstSlice) return;
+
+                auto cell = owner.find(PackCell4D(ix, iy, iz, it));
+                if (cell == owner.end() || cell->second == self) return;
+
+                const PlanKey &other = cellsByPlan.at(cell->second).plan;
+                result.accepted     = false;
+                result.conflictPlan = other.id;
+                result.conflictUav  = other.uav;
+                result.conflictCell = (Eigen::Vector3d(ix, iy, iz).array() + 0.5) * cellSize.array();
+                result.conflictTime = it * timeSlice;
+            });
+        if (!result.accepted) break;
+    }
+
+    return result;
+}
+
+
+
+// Reserves the plan cells if none is owned by another plan
+Reservation Reserve(const Plan4D &plan)
+{
+    Reservation result = Check(plan);
+    if (!result.accepted) return result;
+
+    PlanKey key = plan.Key();
+    Release(key);
+
+    uint32_t reservation = nextReservation++;
+    reservationOf[key] = reservation;
+    PlanCells &cells = cellsByPlan[reservation];
+    cells.plan   = key;
+    cells.finish = plan.FinishTime();
+    for (const PlanSegment &seg : plan.segments)
+    {
+        ForEachSweptCell(seg, plan.radius, cellSize, timeSlice,
+            [&](long ix, long iy, long iz, long it)
+            {
+                if (it < firstSlice) return;
+
+                uint64_t cell = PackCell4D(ix, iy, iz, it);
+                if (!owner.emplace(cell, reservation).second) return;   // already ours
+                cells.keys.push_back(cell);
+                cellsBySlice[it].push_back(cell);
+            });
+    }
+
+    return result;
+}
+
+
+
+void Release(const PlanKey &plan)
+{
+    auto reservation = reservationOf.find(plan);
+    if (reservation == reservationOf.end()) return;
+
+    auto found = cellsByPlan.find(reservation->second);
+    for (uint64_t key : found->second.keys)
+    {
+        auto cell = owner.find(key);
+        if (cell != owner.end() && cell->second == reservation->second)
+            owner.erase(cell);
+    }
+    cellsByPlan.erase(found);
+    reservationOf.erase(reservation);
+}
+
+
+
+// Frees the cells of the time slices that ended before 't'
+void Evict(double t)
+{
+    long slice = static_cast<long>(std::floor(t / timeSlice));
+    if (slice <= firstSlice) return;
+    firstSlice = slice;
+
+    while (!cellsBySlice.empty() && cellsBySlice.begin()->first < slice)
+    {
+        for (uint64_t key : cellsBySlice.begin()->second)
+            owner.erase(key);
+        cellsBySlice.erase(cellsBySlice.begin());
+    }
+
+    // Plans already finished have no cells left
+    for (auto plan = cellsByPlan.begin(); plan != cellsByPlan.end(); )
+    {
+        if (plan->second.finish < slice * timeSlice)
+        {
+            reservationOf.erase(plan->second.plan);
+            plan = cellsByPlan.erase(plan);
+        }
+        else
+            ++plan;
+    }
+}
+
+
+
+void Clear()
+{
+    owner.clear();
+    cellsByPlan.clear();
+    reservationOf.clear();
+    cellsBySlice.clear();
+    firstSlice = 0;
+}
+
+};
+
+} // namespace navsim
+
+#endif
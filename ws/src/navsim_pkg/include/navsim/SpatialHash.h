@@ -0,0 +1,157 @@
+#ifndef NAVSIM_SPATIALHASH_H
+#define NAVSIM_SPATIALHASH_H
+
+// Uniform spatial hash over a set of points, rebuilt from scratch every time
+// the points move. With the cell size equal to the query radius, every pair of
+// points closer than the radius lies in the same or in adjacent cells, so all
+// close pairs are found in O(n) instead of testing every pair.
+//
+// Storage is kept between rebuilds: a table of bucket heads (twice the number
+// of points, power of two) and a linked list through the points.
+
+#include <Eigen/Core>
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+
+namespace navsim
+{
+
+class SpatialHash
+{
+
+private:
+
+double cellSize = 1;
+uint64_t mask = 0;
+
+std::vector<Eigen::Vector3d> points;
+std::vector<int64_t> cellX, cellY, cellZ;
+std::vector<int32_t> head;   // first point of each bucket (-1: empty)
+std::vector<int32_t> next;   // next point in the same bucket
+
+
+static uint64_t Hash(int64_t ix, int64_t iy, int64_t iz)
+{
+    return (uint64_t(ix) * 73856093ULL) ^ (uint64_t(iy) * 19349663ULL) ^ (uint64_t(iz) * 83492791ULL);
+}
+
+
+public:
+
+void Build(const std::vector<Eigen::Vector3d> &pts, double size)
+{
+    cellSize = size;
+    points   = pts;
+
+    int n = points.size();
+    uint64_t buckets = 16;
+    while (buckets < 2 * uint64_t(n)) buckets <<= 1;
+    mask = buckets - 1;
+
+    head.assign(buckets, -1);
+    next.resize(n);
+    cellX.resize(n);
+    cellY.resize(n);
+    cellZ.resize(n);
+
+    for (int i = 0; i < n; i++)
+    {
+        cellX[i] = std::floor(points[i].x() / cellSize);
+        cellY[i] = std::floor(points[i].y() / cellSize);
+        cellZ[i] = std::floor(points[i].z() / cellSize);
+
+        uint64_t b = Hash(cellX[i], cellY[i], cellZ[i]) & mask;
+        next[i] = head[b];
+        head[b] = i;
+    }
+}
+
+
+
+size_t Size() const
+{
+    return points.size();
+}
+
+
+
+// Calls visit(i, j, distance) once for every pair i < j closer than 'radius'.
+// 'radius' must not be larger than the cell size used to build the hash.
+template <typename Visitor>
+void ForEachPair(double radius, Visitor &&visit) const
+{
+    double r2 = radius * radius;
+    int n = points.size();
+
+    for (int i = 0; i < n; i++)
+    {
+        // The same bucket may be reached from two neighbour cells (hash
+        // collision), so buckets already scanned for this point are skipped
+        uint64_t scanned[27];
+        int numScanned = 0;
+
+        for (int dx = -1; dx <= 1; dx++)
+        for (int dy = -1; dy <= 1; dy++)
+        for (int dz = -1; dz <= 1; dz++)
+        {
+            uint64_t b = Hash(cellX[i] + dx, cellY[i] + dy, cellZ[i] + dz) & mask;
+
+            bool repeated = false;
+            for (int k = 0; k < numScanned; k++)
+                repeated |= (scanned[k] == b);
+            if (repeated) continue;
+            scanned[numScanned++] = b;
+
+            for (int j = head[b]; j != -1; j = next[j])
+            {
+                if (j <= i) continue;
+
+                double d2 = (points[j] - points[i]).squaredNorm();
+                if (d2 < r2)
+                    visit(i, j, std::sqrt(d2));
+            }
+        }
+    }
+}
+
+
+
+// Calls visit(i) for every point closer than 'radius' to 'pos'
+template <typename Visitor>
+void ForEachNear(const Eigen::Vector3d &pos, double radius, Visitor &&visit) const
+{
+    if (head.empty()) return;
+
+    double r2 = radius * radius;
+    int64_t reach = std::ceil(radius / cellSize);
+    int64_t cx = std::floor(pos.x() / cellSize);
+    int64_t cy = std::floor(pos.y() / cellSize);
+    int64_t cz = std::floor(pos.z() / cellSize);
+
+    std::vector<uint64_t> scanned;
+    for (int64_t dx = -reach; dx <= reach; dx++)
+    for (int64_t dy = -reach; dy <= reach; dy++)
+    for (int64_t dz = -reach; dz <= reach; dz++)
+    {
+        uint64_t b = Hash(cx + dx, cy + dy, cz + dz) & mask;
+
+        bool repeated = false;
+        for (uint64_t s : scanned)
+            repeated |= (s == b);
+        if (repeated) continue;
+        scanned.push_back(b);
+
+        for (int j = head[b]; j != -1; j = next[j])
+            if ((points[j] - pos).squaredNorm() < r2)
+                visit(j);
+    }
+}
+
+};
+
+} // namespace navsim
+
+#endif
@@ -0,0 +1,302 @@
+#ifndef NAVSIM_TRACER_H
+#define NAVSIM_TRACER_H
+
+// Opt-in trace of the simulation loop, written in the Chrome trace-event JSON
+// format (chrome://tracing, ui.perfetto.dev).
+//
+// While enabled, every NAVSIM_PROFILE phase (navsim/Profiler.h) and every
+// NAVSIM_TRACE scope (world updates, spin_some, ROS callbacks) records a
+// complete event: its start, duration, thread, the simulation time and the
+// UAV whose update it belongs to. Each thread records into its own ring
+// buffer, without locks, keeping the last 'capacity' events. Save() writes
+// them all, on demand (the World plugin's NavSim/SaveTrace service) and when
+// the World plugin unloads. The tracer is never destroyed, as threads may
+// record until the process exits. The UAV names are interned once, when
+// their plugins register (Intern), and the events keep their index.
+//
+// Disabled, a scope costs a relaxed load. Configured with
+// -DNAVSIM_ENABLE_PROFILING=OFF, NAVSIM_TRACE expands to nothing.
+// Instance() is inline, so every plugin library resolves to the same object.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+
+namespace navsim
+{
+
+// Timestamp counter on x86 (a few ns to read, against tens for steady_clock),
+// steady_clock ns elsewhere
+inline uint64_t Ticks()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+
+
+// Calibration of the ticks against steady_clock, since the first call
+inline double SecondsPerTick()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    static const uint64_t startTicks = Ticks();
+    static const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    uint64_t ticks = Ticks() - startTicks;
+    return (ticks > 0) ? seconds / ticks : 0.0;
+#else
+    return 1e-9;
+#endif
+}
+
+
+
+struct TraceEvent
+{
+    const char *name;       // string literal or __func__
+    const char *category;
+    uint64_t start, end;    // [ticks]
+    double   sim;           // simulation time [s]
+    int      uav;           // UAV updated (Tracer::Intern, -1 if none)
+};
+
+
+
+class Tracer
+{
+
+private:
+
+struct Buffer
+{
+    int tid;
+    std::vector<TraceEvent> events;   // ring
+    std::atomic<uint64_t>   count{0}; // events recorded (the last 'events.size()' are kept)
+};
+
+std::atomic<bool>   enabled{false};
+std::atomic<double> simTime{0};
+size_t      capacity = 1 << 16;       // events per thread
+std::string path;                     // written when the World plugin unloads, if not empty
+uint64_t    origin = 0;               // [ticks] time 0 of the trace
+
+mutable std::mutex mutex;             // registration and saving only
+std::vector<std::unique_ptr<Buffer>> buffers;
+std::vector<std::string> uavs;        // interned UAV names
+std::unordered_map<std::string, int> uavIndex;
+
+Tracer() = default;
+
+static int &CurrentUav()
+{
+    static thread_local int uav = -1;
+    return uav;
+}
+
+// Writes 's' as a JSON string
+static void WriteString(FILE *out, const char *s)
+{
+    fputc('"', out);
+    for (; *s; s++)
+    {
+        unsigned char c = *s;
+        if (c == '"' || c == '\\')
+            fprintf(out, "\\%c", c);
+        else if (c < 0x20)
+            fprintf(out, "\\u%04x", c);
+        else
+            fputc(c, out);
+    }
+    fputc('"', out);
+}
+
+Buffer &Local()
+{
+    static thread_local Buffer *local = nullptr;
+    if (!local)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        buffers.push_back(std::make_unique<Buffer>());
+        local = buffers.back().get();
+        local->tid = int(buffers.size());
+        local->events.resize(capacity);
+    }
+    return *local;
+}
+
+
+public:
+
+Tracer(const Tracer &) = delete;
+Tracer &operator=(const Tracer &) = delete;
+
+static Tracer &Instance()
+{
+    static Tracer *tracer = new Tracer();   // never destroyed (see above)
+    return *tracer;
+}
+
+
+
+// Starts recording, keeping the last 'events' per thread, to be saved to
+// 'file' (if not empty) when the World plugin unloads
+void Enable(const std::string &file, size_t events = 1 << 16)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    path     = file;
+    capacity = std::max<size_t>(events, 1);
+    origin   = Ticks();
+    SecondsPerTick();
+    enabled  = true;
+}
+
+bool Enabled() const
+{
+    return enabled.load(std::memory_order_relaxed);
+}
+
+const std::string &Path() const
+{
+    return path;
+}
+
+
+
+void SetSimTime(double t)
+{
+    simTime.store(t, std::memory_order_relaxed);
+}
+
+// Index of a UAV name for SetUav, the same for every plugin of that UAV
+int Intern(const std::string &uav)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = uavIndex.emplace(uav, int(uavs.size()));
+    if (found.second)
+        uavs.push_back(uav);
+    return found.first->second;
+}
+
+// UAV (interned) of the events of this thread until the next call (-1: none)
+static void SetUav(int uav)
+{
+    CurrentUav() = uav;
+}
+
+
+
+void Record(const char *name, const char *category, uint64_t start, uint64_t end)
+{
+    Buffer &buffer = Local();
+    uint64_t n = buffer.count.load(std::memory_order_relaxed);
+    TraceEvent &event = buffer.events[n % buffer.events.size()];
+    event.name     = name;
+    event.category = category;
+    event.start    = start;
+    event.end      = end;
+    event.sim      = simTime.load(std::memory_order_relaxed);
+    event.uav      = CurrentUav();
+    buffer.count.store(n + 1, std::memory_order_release);
+}
+
+
+
+// Writes the events kept as a Chrome trace. Returns the number of events
+// written (-1 if the file cannot be written). Events recorded meanwhile by
+// other threads may be torn.
+long Save(const std::string &file) const
+{
+    FILE *out = fopen(file.c_str(), "w");
+    if (!out) return -1;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    double us = SecondsPerTick() * 1e6;
+    long written = 0;
+
+    fprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    for (const std::unique_ptr<Buffer> &buffer : buffers)
+    {
+        fprintf(out, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"thread %d\"}}",
+                buffer != buffers.front() ? ",\n" : "", buffer->tid, buffer->tid);
+
+        uint64_t count = buffer->count.load(std::memory_order_acquire);
+        uint64_t size  = buffer->events.size();
+        for (uint64_t n = (count > size) ? count - size : 0; n < count; n++)
+        {
+            const TraceEvent &e = buffer->events[n % size];
+            if (e.start < origin) continue;   // recorded before Enable()
+            fprintf(out, ",\n{\"name\":");
+            WriteString(out, e.name);
+            fprintf(out, ",\"cat\":");
+            WriteString(out, e.category);
+            fprintf(out, ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d,\"args\":{\"sim\":%.4f",
+                    (e.start - origin) * us, (e.end - e.start) * us, buffer->tid, e.sim);
+            if (e.uav >= 0 && e.uav < int(uavs.size()))
+            {
+                fprintf(out, ",\"uav\":");
+                WriteString(out, uavs[e.uav].c_str());
+            }
+            fprintf(out, "}}");
+            written++;
+        }
+    }
+    fprintf(out, "\n]}\n");
+    fclose(out);
+    return written;
+}
+
+};
+
+
+
+// Trace-only scope (the phases of NAVSIM_PROFILE are traced too)
+class TraceScope
+{
+const char *name;
+uint64_t start = 0;
+
+public:
+
+explicit TraceScope(const char *name) : name(name)
+{
+    if (Tracer::Instance().Enabled()) start = Ticks();
+}
+
+~TraceScope()
+{
+    if (start) Tracer::Instance().Record(name, "trace", start, Ticks());
+}
+};
+
+} // namespace navsim
+
+
+
+#ifndef NAVSIM_ENABLE_PROFILING
+#define NAVSIM_ENABLE_PROFILING 1
+#endif
+
+#if NAVSIM_ENABLE_PROFILING
+#define NAVSIM_TRACE(name)  navsim::TraceScope navsimTraceScope(name)
+#else
+#define NAVSIM_TRACE(name)
+#endif
+
+#endif
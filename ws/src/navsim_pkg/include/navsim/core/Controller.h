@@ -0,0 +1,82 @@
+#ifndef NAVSIM_CORE_CONTROLLER_H
+#define NAVSIM_CORE_CONTROLLER_H
+
+// Low level velocity controller of the UAM minidrone.
+//
+// Linear state feedback with integral action, designed around hovering:
+//   x = [roll, pitch, bWx, bWy, bWz, bVx, bVy, bVz]   (model state)
+//   y = [bVx, bVy, bVz, bWz]                          (model output)
+//   E = sum((y - r) * dt), clamped to +-E_max         (accumulated error, frozen
+//       while it would push a saturated rotor further)
+//   u = Hs - Kx (x - x0) - Ky E,                      (rotor speeds NE, NW, SE, SW)
+//       clamped to [w_min, w_max]
+//
+// With a gain schedule, Hs, x0, Kx and Ky are interpolated at the forward and
+// vertical speeds of the reference on every update (see GainSchedule.h).
+
+#include "navsim/core/GainSchedule.h"
+#include "navsim/core/Quadrotor.h"
+
+#include <Eigen/Core>
+
+#include <memory>
+
+
+namespace navsim
+{
+
+// Commanded velocity in body axes
+struct VelocityCommand
+{
+    bool on = false;                                    // rotors on
+    Eigen::Vector3d vel = Eigen::Vector3d::Zero();      // linear velocity  [m/s]
+    double yawRate = 0;                                 // angular velocity about z [rad/s]
+};
+
+
+
+class QuadrotorController
+{
+
+private:
+
+QuadrotorParams params;
+
+std::shared_ptr<const GainSchedule> schedule;
+GainPoint gains;                // Hs, x0, Kx and Ky at the reference
+Eigen::Matrix<double, 4, 1> E;  // model accumulated error
+Eigen::Matrix<double, 4, 1> u;  // input (rotors speeds)
+
+
+public:
+
+double E_max = 15;              // maximum model accumulated error
+
+
+QuadrotorController(const QuadrotorParams &params = QuadrotorParams::Minidrone());
+
+// Rotor speeds for the command, 'dt' seconds after the last update.
+// With the command off the rotors are stopped and the integral is reset.
+const Eigen::Vector4d &Update(const QuadrotorState &state, const VelocityCommand &cmd, double dt);
+
+// Clears the accumulated error and stops the rotors
+void Reset();
+
+// Takes over a drone flown until now by another model (Kinematic.h): the
+// reference is the current velocity of 'state' and the accumulated error the
+// one that gives the 'trim' rotor speeds there, so the first update goes on
+// from them instead of from stopped rotors
+void Seed(const QuadrotorState &state, const Eigen::Vector4d &trim);
+
+// Gains for the operating points (null: the hover gains)
+void SetSchedule(std::shared_ptr<const GainSchedule> schedule);
+const GainSchedule &Schedule() const { return *schedule; }
+
+const Eigen::Vector4d &RotorSpeeds() const { return u; }
+const Eigen::Vector4d &AccumulatedError() const { return E; }
+
+};
+
+} // namespace navsim
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef NAVSIM_CORE_GAINSCHEDULE_H
+#define NAVSIM_CORE_GAINSCHEDULE_H
+
+// Gains of the low level controller at several operating points.
+//
+// Each point is a linearization of the minidrone at a forward speed (body x)
+// and a vertical speed (body z), designed offline (see
+// models/UAM/minidrone/dynamics/export_gain_table.m): the trim rotor speeds
+// Hs, the trim state x0 and the gains Kx, Ky of the law
+//   u = Hs - Kx (x - x0) - Ky E
+// The points cover a regular grid of both speeds, and the controller blends
+// the four around its reference (bilinear, clamped at the borders). The
+// default schedule is the single hover point of system_definition.mlx.
+
+#include "navsim/core/Quadrotor.h"
+
+#include <Eigen/Core>
+#include <Eigen/StdVector>
+
+#include <string>
+#include <vector>
+
+
+namespace navsim
+{
+
+struct GainPoint
+{
+    Eigen::Matrix<double, 4, 1> Hs = Eigen::Matrix<double, 4, 1>::Zero();   // rotor speeds NE, NW, SE, SW
+    Eigen::Matrix<double, 8, 1> x0 = Eigen::Matrix<double, 8, 1>::Zero();   // model state
+    Eigen::Matrix<double, 4, 8> Kx = Eigen::Matrix<double, 4, 8>::Zero();   // state control matrix
+    Eigen::Matrix<double, 4, 4> Ky = Eigen::Matrix<double, 4, 4>::Zero();   // error control matrix
+};
+
+
+
+class GainSchedule
+{
+
+public:
+
+std::vector<double> speeds;        // forward speed breakpoints, increasing  [m/s]
+std::vector<double> climbs;        // vertical speed breakpoints, increasing [m/s]
+std::vector<GainPoint, Eigen::aligned_allocator<GainPoint>> points;   // speed varying fastest
+
+
+// Linearization at hovering
+static GainSchedule Hover(const QuadrotorParams &params = QuadrotorParams::Minidrone());
+
+// Text file: "<number of speeds> <number of climbs>", the speeds, the climbs,
+// then per point Hs (4), x0 (8), Kx (4x8 by rows) and Ky (4x4 by rows), with
+// the speed varying fastest ('#' comments)
+bool Load(const std::string &path, std::string &error);
+
+// More than one operating point
+bool Scheduled() const { return points.size() > 1; }
+
+// Gains at a forward speed 'u' and a vertical speed 'w'
+void Lookup(double u, double w, GainPoint &gains) const;
+
+// Gains for a controller updated every 'dt' seconds, which holds the rotor
+// speeds between updates (zero-order hold) and accumulates E += (y - r) dt.
+// Every point is linearized at its trim, and gets the gains whose sampled
+// closed loop best matches (least squares) the continuous one after 'dt'.
+GainSchedule Discretize(const QuadrotorParams &params, double dt) const;
+
+};
+
+} // namespace navsim
+
+#endif
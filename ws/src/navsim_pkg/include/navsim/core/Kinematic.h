@@ -0,0 +1,40 @@
+#ifndef NAVSIM_CORE_KINEMATIC_H
+#define NAVSIM_CORE_KINEMATIC_H
+
+// Kinematic model of the minidrone with its low level controller: the
+// velocity (in the heading frame) and the yaw rate follow the command with
+// first-order lags, and the attitude is the one that gives the acceleration
+// with the thrust along the body z axis. It costs a small fraction of the
+// rotor dynamics, and steps the same QuadrotorState, so a drone can switch
+// between both models at any step.
+//
+// The time constants are fitted to the full model: the closed loop step
+// response of QuadrotorController + Step from hovering, where the constant of
+// a first-order lag is the area between the step and the response.
+
+#include "navsim/core/Controller.h"
+#include "navsim/core/Quadrotor.h"
+
+
+namespace navsim
+{
+
+struct KinematicParams
+{
+    double g      = 9.8;
+    double tauXY  = 0.5;    // horizontal velocity lag  [s]
+    double tauZ   = 0.2;    // vertical velocity lag    [s]
+    double tauYaw = 0.2;    // yaw rate lag             [s]
+};
+
+// Lags of the closed loop full model, simulated with steps of 'dt' seconds
+KinematicParams FitKinematicParams(const QuadrotorParams &params = QuadrotorParams::Minidrone(),
+                                   double dt = 0.002);
+
+// Advances the state 'dt' seconds towards the command (body axes, as from
+// PlanFollower). The command must be on: there is no free fall.
+void KinematicStep(const KinematicParams &params, QuadrotorState &state, const VelocityCommand &cmd, double dt);
+
+} // namespace navsim
+
+#endif
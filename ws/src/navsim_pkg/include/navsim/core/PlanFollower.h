@@ -0,0 +1,96 @@
+#ifndef NAVSIM_CORE_PLANFOLLOWER_H
+#define NAVSIM_CORE_PLANFOLLOWER_H
+
+// Flight plan navigation of UAM_minidrone_FP1, without ROS.
+//
+// The UAV waits at the first waypoint until its time, then flies the route
+// at constant velocity between waypoints. Every step it commands the body
+// velocity that takes it to the position of the plan 'targetStep' seconds
+// later, limiting the change of velocity to 'maxVarLinVel', and heads to the
+// direction of the segment flown 'targetStep' seconds later.
+
+#include "navsim/core/Controller.h"
+#include "navsim/core/Quadrotor.h"
+
+#include <Eigen/Core>
+
+#include <cstdint>
+#include <vector>
+
+
+namespace navsim
+{
+
+struct TimedWaypoint
+{
+    double t;               // [s]
+    Eigen::Vector3d pos;    // [m]
+};
+
+struct Route
+{
+    uint16_t id = 0;
+    double   radius = 0;    // maximum distance to the first waypoint to start
+    std::vector<TimedWaypoint> waypoints;
+};
+
+
+
+enum class NavEvent
+{
+    NONE,        // nothing changed
+    WAITING,     // waiting at the starting waypoint
+    STARTED,     // flying to the first waypoint
+    WAYPOINT,    // heading to the next waypoint
+    COMPLETED,   // the route was completed          (the plan is dropped)
+    OBSOLETE,    // the plan was received too late    (the plan is dropped)
+    WRONG_START  // the UAV is not at the first waypoint (the plan is dropped)
+};
+
+
+
+class PlanFollower
+{
+
+private:
+
+Route route;
+bool  active = false;
+
+// Waypoint currently flying to:
+// -1: no waypoint
+//  0: starting point
+//  1: first waypoint
+// numWPs-1: last waypoint
+int currentWP = -1;
+
+
+public:
+
+double maxVarLinVel = 5;   // maximum variation in linear  velocity   [  m/s]
+double maxVarAngVel = 2;   // maximum variation in angular velocity   [rad/s]
+double targetStep   = 2;   // Compute targetPos targetStep seconds later  [s]
+double commandTTL   = 1;   // validity of the command computed            [s]
+
+
+void SetRoute(const Route &r);
+void Clear();
+
+bool  Active() const { return active; }
+int   CurrentWaypoint() const { return currentWP; }
+const Route &GetRoute() const { return route; }
+
+// Navigation at time 't'. Sets the command (and its expiration time) while
+// the plan is active, and turns it off when the route is completed.
+NavEvent Update(double t, const QuadrotorState &state, VelocityCommand &cmd, double &cmdExpTime);
+
+// First waypoint whose time is after 't' (numWPs if none)
+int    WaypointAtTime(double t) const;
+Eigen::Vector3d PositionAtTime(double t) const;
+double YawAtTime(double t, double currentYaw) const;
+
+};
+
+} // namespace navsim
+
+#endif
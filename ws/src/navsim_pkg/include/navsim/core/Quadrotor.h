@@ -0,0 +1,118 @@
+#ifndef NAVSIM_CORE_QUADROTOR_H
+#define NAVSIM_CORE_QUADROTOR_H
+
+// Quadrotor rigid body model of the NAVSIM drones, without Gazebo or ROS.
+//
+// The rotors only produce thrust (kFT * w²) and a reaction moment about
+// the body z axis (kMDR * w²). The air produces a quadratic drag force and
+// drag moment per body axis, from the velocity relative to the air (the
+// wind is given in world axes). The state is advanced by one of the built-in
+// integrators, with the rotor speeds held constant during the step.
+//
+// The quadratic drag is stiff for small, draggy airframes: with an explicit
+// step it overshoots (and diverges) above a speed that shrinks with the step.
+// ImplicitDrag makes it linearly implicit, which the semi-implicit Euler step
+// and the Gazebo plugins (whose forces ODE integrates explicitly) use.
+
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+#include <cmath>
+
+
+namespace navsim
+{
+
+struct QuadrotorParams
+{
+    double g    = 9.8;
+    double mass = 0.595;
+    Eigen::Vector3d inertia = Eigen::Vector3d(0.002027958, 0.002027958, 0.003966666);   // principal axes
+
+    double kFT  = 1.7179e-05;                                  // thrust force     FT  = kFT  * w²
+    double kMDR = 3.6714e-08;                                  // rotor moment     MDR = kMDR * w²
+    Eigen::Vector3d kFD = Eigen::Vector3d(1.1902e-04, 1.1902e-04, 36.4437e-4);   // drag force per axis
+    Eigen::Vector3d kMD = Eigen::Vector3d(1.1078e-04, 1.1078e-04, 7.8914e-05);   // drag moment per axis
+
+    double w_max = 628.3185;   // rad/s = 15000rpm
+    double w_min = 0;
+
+    // Rotors NE, NW, SE, SW, 15cm from the center of mass at 45º from the axes
+    Eigen::Vector3d rotorPos[4] = {
+        Eigen::Vector3d( 0.075, -0.075, 0),
+        Eigen::Vector3d( 0.075,  0.075, 0),
+        Eigen::Vector3d(-0.075, -0.075, 0),
+        Eigen::Vector3d(-0.075,  0.075, 0) };
+    double rotorSpin[4] = { 1, -1, -1, 1 };   // sign of the reaction moment
+
+    double HoverSpeed() const
+    {
+        return std::sqrt(mass * g / 4 / kFT);
+    }
+
+    // UAM minidrone (DJI Air 2S like, as in models/UAM/minidrone)
+    static QuadrotorParams Minidrone()
+    {
+        return QuadrotorParams();
+    }
+};
+
+
+
+struct QuadrotorState
+{
+    Eigen::Vector3d    pos    = Eigen::Vector3d::Zero();        // world frame
+    Eigen::Quaterniond rot    = Eigen::Quaterniond::Identity(); // body to world
+    Eigen::Vector3d    vel    = Eigen::Vector3d::Zero();        // world frame
+    Eigen::Vector3d    angVel = Eigen::Vector3d::Zero();        // body frame
+
+    Eigen::Vector3d BodyVel() const
+    {
+        return rot.conjugate() * vel;
+    }
+
+    // Roll, pitch and yaw as in ignition::math::Quaternion::Euler()
+    Eigen::Vector3d Euler() const;
+};
+
+
+
+struct Wrench
+{
+    Eigen::Vector3d force;    // body frame, without gravity
+    Eigen::Vector3d torque;   // body frame
+};
+
+// Rotor and aerodynamic wrench for rotor speeds w (NE, NW, SE, SW)
+Wrench RotorWrench(const QuadrotorParams &params, const QuadrotorState &state, const Eigen::Vector4d &w,
+                   const Eigen::Vector3d &wind = Eigen::Vector3d::Zero());
+
+// Wrench that, applied in an explicit step of 'dt' seconds, gives the linearly
+// implicit step of the drag: the net force (with gravity) and the net torque
+// (with the gyroscopic term) per body axis are divided by 1 + dt * dDrag/dv.
+// The speeds then never overshoot their equilibrium, whatever the step.
+Wrench ImplicitDrag(const QuadrotorParams &params, const QuadrotorState &state, const Wrench &wrench,
+                    double dt, const Eigen::Vector3d &wind = Eigen::Vector3d::Zero());
+
+// Equal rotor speeds whose thrust balances the weight and the drag along the
+// body z axis in the current state (the hover speed when still and level),
+// clamped to [w_min, w_max]
+Eigen::Vector4d TrimRotorSpeeds(const QuadrotorParams &params, const QuadrotorState &state,
+                                const Eigen::Vector3d &wind = Eigen::Vector3d::Zero());
+
+
+
+enum class Integrator
+{
+    SemiImplicitEuler,
+    RK4
+};
+
+// Advances the rigid body 'dt' seconds with constant rotor speeds and wind
+void Step(const QuadrotorParams &params, QuadrotorState &state, const Eigen::Vector4d &w,
+          double dt, Integrator integrator = Integrator::SemiImplicitEuler,
+          const Eigen::Vector3d &wind = Eigen::Vector3d::Zero());
+
+} // namespace navsim
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef NAVSIM_CORE_SCENARIO_H
+#define NAVSIM_CORE_SCENARIO_H
+
+// Fleet and flight plans for the headless simulations, from a text file.
+//
+// One item per line ('#' starts a comment):
+//   uav  <name> <x> <y> <z> [yaw]      drone at rest at that pose
+//   plan <name> <plan_id> <radius>     flight plan for the drone, followed by
+//   wp   <t> <x> <y> <z>               its waypoints, in time order
+
+#include "navsim/core/PlanFollower.h"
+
+#include <Eigen/Core>
+
+#include <string>
+#include <vector>
+
+
+namespace navsim
+{
+
+struct ScenarioUAV
+{
+    std::string     name;
+    Eigen::Vector3d pos = Eigen::Vector3d::Zero();
+    double          yaw = 0;
+    Route           route;   // no waypoints: no plan
+};
+
+struct Scenario
+{
+    std::vector<ScenarioUAV> uavs;
+
+    // Time of the last waypoint of all the plans
+    double EndTime() const;
+
+    // Box around the UAVs and their waypoints
+    void Bounds(Eigen::Vector3d &lo, Eigen::Vector3d &hi) const;
+};
+
+
+
+// Returns false, with the reason in 'error', if the file cannot be read
+bool LoadScenario(const std::string &path, Scenario &scenario, std::string &error);
+
+} // namespace navsim
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef NAVSIM_CORE_SIMDRONE_H
+#define NAVSIM_CORE_SIMDRONE_H
+
+// A UAM minidrone flying flight plans without Gazebo: plan navigation, low
+// level control and rigid body dynamics, stepped as in UAM_minidrone_FP1.
+// The ground is a plane at z = 'ground'; with the rotors off a drone on the
+// ground stays there. Navigation and control may run on a measured state
+// (with sensor errors) instead of the true one.
+//
+// In flight, a drone may fly the kinematic model instead (Kinematic.h); back
+// to the full model the controller is seeded with the trim of the state.
+
+#include "navsim/core/Controller.h"
+#include "navsim/core/Kinematic.h"
+#include "navsim/core/PlanFollower.h"
+#include "navsim/core/Quadrotor.h"
+
+#include <memory>
+#include <string>
+
+
+namespace navsim
+{
+
+class SimDrone
+{
+
+private:
+
+QuadrotorController controller;
+bool   rotorsOn = false;
+bool   kinematic = false;
+double prevControlTime = 0;
+
+
+public:
+
+std::string     name;
+QuadrotorParams params;       // airframe simulated (the controller keeps the one of the constructor)
+QuadrotorState  state;
+PlanFollower    follower;
+Integrator      integrator = Integrator::SemiImplicitEuler;
+double          ground = 0;
+Eigen::Vector3d wind = Eigen::Vector3d::Zero();   // world axes [m/s]
+KinematicParams lags;                             // of the kinematic model
+
+VelocityCommand cmd;
+double          cmdExpTime = 0;
+
+
+SimDrone(const std::string &name = "", const QuadrotorParams &params = QuadrotorParams::Minidrone());
+
+// Direct velocity command (as a RemoteCommand) valid for 'duration' seconds
+void Command(const VelocityCommand &command, double t, double duration);
+
+// Navigation and control at time 't', then 'dt' seconds of dynamics
+NavEvent Step(double t, double dt);
+NavEvent Step(double t, double dt, const QuadrotorState &measured);
+
+// Kinematic or full model from time 't' on. The kinematic model only flies
+// drones with the rotors on; on the ground they stay with the full model.
+void SetKinematic(bool kinematic, double t);
+bool Kinematic() const { return kinematic; }
+
+// Gain schedule of the controller (null: the hover gains)
+void SetGains(std::shared_ptr<const GainSchedule> schedule) { controller.SetSchedule(std::move(schedule)); }
+
+bool RotorsOn() const { return rotorsOn; }
+const Eigen::Vector4d &RotorSpeeds() const { return controller.RotorSpeeds(); }
+
+};
+
+} // namespace navsim
+
+#endif
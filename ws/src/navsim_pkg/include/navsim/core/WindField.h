@@ -0,0 +1,160 @@
+#ifndef NAVSIM_CORE_WINDFIELD_H
+#define NAVSIM_CORE_WINDFIELD_H
+
+// 3D wind over the world: a static mean field plus time-varying turbulence.
+//
+// The mean field is a regular grid, generated from a power-law boundary layer
+// profile with the wakes of the obstacles, or loaded from a file (e.g. the
+// output of a CFD run). Every node keeps (u, v, w, k) in one 16-byte float
+// vector, where k scales the turbulence at the node (more in the wakes, none
+// inside the obstacles), so each corner of a trilinear interpolation is one
+// aligned SIMD load, and the two corners along x are contiguous in memory.
+//
+// The turbulence is Dryden-like: three independent first order Gauss-Markov
+// processes (correlation time L / U) on the nodes of a coarse lattice with
+// the spacing of the length scale L, interpolated in space.
+
+#include "navsim/ObstacleBVH.h"
+
+#include <Eigen/Core>
+
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+
+namespace navsim
+{
+
+struct WindProfile
+{
+    double speed       = 0;       // mean speed at the reference height       [m/s]
+    double direction   = 0;       // direction the wind blows to, from the x axis [rad]
+    double refHeight   = 10;      //                                           [m]
+    double shear       = 0.143;   // power law exponent (open terrain)
+    double wakeLength  = 3;       // length of the obstacle wakes, in obstacle heights
+    double wakeDeficit = 0.6;     // speed lost right behind an obstacle (fraction)
+    double wakeTurbulence = 1.5;  // extra turbulence right behind an obstacle (fraction)
+};
+
+struct TurbulenceParams
+{
+    double intensity     = 0;     // horizontal standard deviation (0: none)   [m/s]
+    double verticalRatio = 0.5;   // vertical / horizontal standard deviation
+    double lengthScale   = 50;    // correlation length, and lattice spacing   [m]
+    double period        = 0.1;   // step of the random processes              [s]
+};
+
+
+
+// Regular lattice with trilinear interpolation of float4 nodes, clamped at the borders
+class WindLattice
+{
+
+protected:
+
+typedef std::vector<Eigen::Array4f, Eigen::aligned_allocator<Eigen::Array4f>> Nodes;
+
+Eigen::Vector3d origin = Eigen::Vector3d::Zero();
+double cell = 1;
+int nx = 0, ny = 0, nz = 0;
+Nodes nodes;
+
+
+void Resize(const Eigen::Vector3d &lo, const Eigen::Vector3d &hi, double cellSize);
+
+size_t Index(int ix, int iy, int iz) const
+{
+    return ix + size_t(nx) * (iy + size_t(ny) * iz);
+}
+
+Eigen::Vector3d Position(int ix, int iy, int iz) const
+{
+    return origin + cell * Eigen::Vector3d(ix, iy, iz);
+}
+
+Eigen::Array4f Interpolate(double x, double y, double z) const;
+
+
+public:
+
+bool   Empty()    const { return nodes.empty(); }
+double CellSize() const { return cell; }
+Eigen::Vector3d Lo() const { return origin; }
+Eigen::Vector3d Hi() const { return Position(nx - 1, ny - 1, nz - 1); }
+
+};
+
+
+
+// Static mean wind
+class WindGrid : public WindLattice
+{
+
+public:
+
+// Grid over [lo, hi] for the profile, with the wakes of the obstacles
+void Generate(const Eigen::Vector3d &lo, const Eigen::Vector3d &hi, double cellSize,
+              const WindProfile &profile, const std::vector<Obstacle> &obstacles = {});
+
+// Text file: "<ox> <oy> <oz> <cell> <nx> <ny> <nz>", then nx*ny*nz lines
+// "<u> <v> <w> [k]" with x varying fastest, then y, then z ('#' comments)
+bool Load(const std::string &path, std::string &error);
+
+// Mean wind and turbulence scale at 'p'
+Eigen::Array4f At(const Eigen::Vector3d &p) const
+{
+    return Interpolate(p.x(), p.y(), p.z());
+}
+
+friend class WindField;
+
+};
+
+
+
+// Mean wind plus turbulence. Each simulation owns its field (the turbulence
+// state and its random generator); the mean grid can be shared.
+class WindField : public WindLattice
+{
+
+private:
+
+std::shared_ptr<const WindGrid> mean;
+TurbulenceParams turbulence;
+Eigen::Array4f   sigma;
+
+Nodes  prev, next;             // turbulence at tPrev and tNext, 'nodes' is the blend at 'now'
+double tPrev = 0, tNext = 0;
+double now = -1;
+double decay = 0;              // correlation between consecutive steps
+
+std::mt19937_64 rng;
+std::normal_distribution<float> normal;
+
+void Draw(Nodes &values, const Nodes *from);
+
+
+public:
+
+WindField(std::shared_ptr<const WindGrid> mean, const TurbulenceParams &turbulence = TurbulenceParams(),
+          uint64_t seed = 1);
+
+// Moves the turbulence to time 't' (restarts it if 't' goes back)
+void Advance(double t);
+
+// Wind at 'n' positions given as separate x, y and z arrays
+void Sample(size_t n, const double *x, const double *y, const double *z,
+            double *u, double *v, double *w) const;
+
+Eigen::Vector3d At(const Eigen::Vector3d &p) const;
+
+bool Calm() const { return !mean || mean->Empty(); }
+
+};
+
+} // namespace navsim
+
+#endif
@@ -0,0 +1,54 @@
+function export_gain_table(file, speeds, climbs, Hs, x0, Kx, Ky)
+% EXPORT_GAIN_TABLE  Writes the gain schedule of the minidrone controller
+%
+% Text file read by navsim::GainSchedule (navsim/core/GainSchedule.h), loaded
+% by the FP1 plugin (SDF <gain_table>) and by navsim_headless (--gains).
+%
+%   file     output file
+%   speeds   forward speed breakpoints, increasing  [m/s]   (1 x nu)
+%   climbs   vertical speed breakpoints, increasing [m/s]   (1 x nw)
+%   Hs       trim rotor speeds NE, NW, SE, SW   [rad/s]     (4 x nu x nw)
+%   x0       trim state [roll pitch bWx bWy bWz bVx bVy bVz] (8 x nu x nw)
+%   Kx       state control matrices                         (4 x 8 x nu x nw)
+%   Ky       error control matrices                         (4 x 4 x nu x nw)
+%
+% Each operating point (i, j) is the design of system_definition.mlx with the
+% model linearized at speeds(i), climbs(j) instead of at hover, and the
+% controller applies u = Hs - Kx (x - x0) - Ky E there.
+%
+% Example, the hover gains alone:
+%   export_gain_table('gains_hover.txt', 0, 0, w_hov*ones(4,1), zeros(8,1), Kx, Ky)
+
+nu = numel(speeds);
+nw = numel(climbs);
+assert(all(diff(speeds) > 0) && all(diff(climbs) > 0), 'breakpoints must be increasing');
+assert(isequal(size(Hs, 1), 4) && numel(Hs) == 4*nu*nw, 'Hs must be 4 x nu x nw');
+assert(numel(x0) == 8*nu*nw, 'x0 must be 8 x nu x nw');
+assert(numel(Kx) == 32*nu*nw, 'Kx must be 4 x 8 x nu x nw');
+assert(numel(Ky) == 16*nu*nw, 'Ky must be 4 x 4 x nu x nw');
+
+Hs = reshape(Hs, 4, nu, nw);
+x0 = reshape(x0, 8, nu, nw);
+Kx = reshape(Kx, 4, 8, nu, nw);
+Ky = reshape(Ky, 4, 4, nu, nw);
+
+f = fopen(file, 'w');
+assert(f > 0, ['cannot open ' file]);
+fprintf(f, '# NAVSIM minidrone gain schedule, %s\n', datestr(now));
+fprintf(f, '%d %d\n', nu, nw);
+fprintf(f, '%.6g ', speeds);  fprintf(f, '  # forward speeds [m/s]\n');
+fprintf(f, '%.6g ', climbs);  fprintf(f, '  # vertical speeds [m/s]\n');
+
+% Forward speed varying fastest, matrices by rows
+for j = 1:nw
+    for i = 1:nu
+        fprintf(f, '\n# u = %g m/s, w = %g m/s\n', speeds(i), climbs(j));
+        fprintf(f, '%.10g ', Hs(:, i, j));  fprintf(f, '\n');
+        fprintf(f, '%.10g ', x0(:, i, j));  fprintf(f, '\n');
+        fprintf(f, [repmat('%.10g ', 1, 8) '\n'], Kx(:, :, i, j).');
+        fprintf(f, [repmat('%.10g ', 1, 4) '\n'], Ky(:, :, i, j).');
+    end
+end
+
+fclose(f);
+end
@@ -10,6 +10,10 @@
 #include "navsim_msgs/msg/telemetry.hpp"
 #include "navsim_msgs/msg/remote_command.hpp"
 
+#include "navsim/CommandLatency.h"
+#include "navsim/MemoryAccount.h"
+#include "navsim/Profiler.h"
+
 
 
 namespace gazebo {
@@ -24,6 +28,11 @@ private:
 physics::ModelPtr    model;
 physics::LinkPtr     link;
 event::ConnectionPtr updateConnector;
+#if NAVSIM_ENABLE_PROFILING
+std::shared_ptr<navsim::UavTimes> updateTimes;   // of the world update (navsim/Profiler.h)
+#endif
+std::shared_ptr<navsim::UavLatency> commandLatency;   // (navsim/CommandLatency.h)
+navsim::MemoryAccount *memory = nullptr;              // (navsim/MemoryAccount.h)
 common::Time         currentTime;
 
 
@@ -146,6 +155,13 @@ common::Time CommandExpTime;
 ////////////////////////////////////////////////////////////////////////
 
 public: 
+~DCdrone()
+{
+    navsim::MemoryRegistry::Instance().Release(memory);
+}
+
+
+
 void Load(physics::ModelPtr _parent, sdf::ElementPtr /*_sdf*/)
 {
     // printf("DRONE CHALLENGE Drone plugin: loading\n");
@@ -153,7 +169,13 @@ void Load(physics::ModelPtr _parent, sdf::ElementPtr /*_sdf*/)
     // Get information from the model
     model = _parent;
     UAVname = model->GetName();
+    memory = navsim::MemoryRegistry::Instance().Spawn(UAVname, sizeof(*this));
+    navsim::MemoryScope memoryScope(memory);
     link = model->GetLink("dronelink");
+#if NAVSIM_ENABLE_PROFILING
+    updateTimes = navsim::Profiler::Instance().Uav(UAVname);
+#endif
+    commandLatency = navsim::LatencyMonitor::Instance().Uav(UAVname);
 
     // Periodic event
     updateConnector = event::Events::ConnectWorldUpdateBegin(
@@ -162,6 +184,7 @@ void Load(physics::ModelPtr _parent, sdf::ElementPtr /*_sdf*/)
     // ROS2
     if (rclcpp::ok()) 
     {
+        int64_t heap = navsim::ProcessMemory::Sample().heap;
         rosNode = rclcpp::Node::make_shared(this->UAVname);
 
         rosPub_Telemetry = rosNode->create_publisher<navsim_msgs::msg::Telemetry>(
@@ -170,14 +193,16 @@ void Load(physics::ModelPtr _parent, sdf::ElementPtr /*_sdf*/)
         rosSub_RemoteCommand = rosNode->create_subscription<navsim_msgs::msg::RemoteCommand>(
             "/NavSim/" + UAVname + "/RemoteCommand", 10,
             std::bind(&DCdrone::rosTopFn_RemoteCommand, this, 
-                    std::placeholders::_1));
+                    std::placeholders::_1, std::placeholders::_2));
     
+        memory->Set(navsim::MemoryCategory::Ros, navsim::ProcessMemory::Sample().heap - heap);
     }
     else
     {   
         std::cout << "\x1B[2J\x1B[H";       // Clear screen
         printf("\nERROR: NavSim world plugin is not running ROS2!\n\n");
     }
+    navsim::MemoryRegistry::Instance().Spawned();
 
 
     //Initial control matrices
@@ -241,6 +266,9 @@ void Init()
 
 void OnWorldUpdateBegin()
 {
+    NAVSIM_PROFILE_UAV(updateTimes.get());
+    navsim::MemoryScope memoryScope(memory);
+
     // Clear screen
     // std::cout << "\x1B[2J\x1B[H";
     // printf("DCdrone plugin: OnWorldUpdateBegin\n");
@@ -264,8 +292,11 @@ void OnWorldUpdateBegin()
 
 
 
-void rosTopFn_RemoteCommand(const std::shared_ptr<navsim_msgs::msg::RemoteCommand> msg)
+void rosTopFn_RemoteCommand(const std::shared_ptr<navsim_msgs::msg::RemoteCommand> msg,
+                            const rclcpp::MessageInfo &info)
 {
+    NAVSIM_TRACE(__func__);
+    commandLatency->Dequeued(navsim::MakeStamps(msg->stamp_wall, msg->stamp_sim, info, currentTime.Double()));
     // printf("DCdrone: data received in topic Remote Pilot\n");
     // printf("Received RemoteCommand: uav=%s, on=%d, cmd=[%f, %f, %f, %f], duration=(%d, %d)\n",
     //        msg->uav_id.c_str(), 
@@ -362,6 +393,9 @@ void rotorsOff()
 
 void ServoControl()
 {
+    NAVSIM_PROFILE(navsim::Phase::ServoControl);
+    commandLatency->Applied(currentTime.Double());
+
     // This fucntion converts 
     // a navigation command (desired velocity vector and rotation)
     // to speeds ot the for rotors
@@ -514,6 +548,8 @@ void ServoControl()
 
 void PlatformDynamics()
 {
+    NAVSIM_PROFILE(navsim::Phase::PlatformDynamics);
+
     // Esta funcion traduce 
     // la velocidad de rotacion de los 4 motores
     // a fuerzas y torques del solido libre
@@ -570,6 +606,32 @@ void PlatformDynamics()
         -kMDz * angular_vel.Z() * fabs(angular_vel.Z()));
     link->AddRelativeTorque(MD);
 
+
+	// ODE applies these forces explicitly, and with a coarse max_step_size the
+	// quadratic drag overshoots its equilibrium and diverges. Correct them so
+	// the step is linearly implicit in the drag: the net force and moment per
+	// body axis divided by 1 + dt * dDrag/dv (as navsim::ImplicitDrag).
+    double dt = model->GetWorld()->Physics()->GetMaxStepSize();
+    physics::InertialPtr inertial = link->GetInertial();
+    ignition::math::Vector3<double> I(inertial->IXX(), inertial->IYY(), inertial->IZZ());
+    ignition::math::Vector3<double> G = inertial->Mass() *
+        link->WorldPose().Rot().RotateVectorReverse(model->GetWorld()->Gravity());
+
+    ignition::math::Vector3<double> F = FT_NE + FT_NW + FT_SE + FT_SW + FD + G;
+    ignition::math::Vector3<double> M = pos_NE.Cross(FT_NE) + pos_NW.Cross(FT_NW) + pos_SE.Cross(FT_SE) + pos_SW.Cross(FT_SW)
+                                      + MDR_NE - MDR_NW - MDR_SE + MDR_SW + MD - angular_vel.Cross(I * angular_vel);
+
+    ignition::math::Vector3<double> linear(
+        1 + 2 * dt / inertial->Mass() * kFDx * fabs(linear_vel.X()),
+        1 + 2 * dt / inertial->Mass() * kFDy * fabs(linear_vel.Y()),
+        1 + 2 * dt / inertial->Mass() * kFDz * fabs(linear_vel.Z()));
+    ignition::math::Vector3<double> angular(
+        1 + 2 * dt * kMDx * fabs(angular_vel.X()) / I.X(),
+        1 + 2 * dt * kMDy * fabs(angular_vel.Y()) / I.Y(),
+        1 + 2 * dt * kMDz * fabs(angular_vel.Z()) / I.Z());
+    link->AddRelativeForce (F / linear  - F);
+    link->AddRelativeTorque(M / angular - M);
+
 }
 
 
@@ -578,6 +640,8 @@ void PlatformDynamics()
 
 void CheckROS()
 {
+    NAVSIM_PROFILE(navsim::Phase::CheckROS);
+
     
     // Check if the simulation was reset
     if (currentTime < prevRosCheckTime)
@@ -592,6 +656,7 @@ void CheckROS()
     prevRosCheckTime = currentTime;
 
     // ROS2 events proceessing
+    NAVSIM_TRACE("spin_some");
     rclcpp::spin_some(rosNode);
 
 }
@@ -603,6 +668,8 @@ void CheckROS()
 
 void Telemetry()
 {
+    NAVSIM_PROFILE(navsim::Phase::Telemetry);
+
     // printf("UAV Telemetry \n");
 
     // Check if the simulation was reset
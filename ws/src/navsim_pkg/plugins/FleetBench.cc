@@ -0,0 +1,371 @@
+// Fleet-scaling benchmark driver (world plugin, see worlds/fleet_bench.world).
+//
+// Deploys N flight-plan drones (UAM_minidrone_FP1) on a grid, sends each one
+// a plan that loops a square of its own cell (so no two plans conflict), and
+// once they are all airborne measures for <duration> simulated seconds:
+// the real time factor achieved, the percentiles of the wall time of the
+// world steps, the CPU time and the resident memory. It writes them as a JSON
+// object to <report> and stops gzserver. scripts/fleet_bench.sh runs it for
+// several N.
+//
+// SDF parameters (NAVSIM_BENCH_UAVS, NAVSIM_BENCH_DURATION and
+// NAVSIM_BENCH_REPORT override the first three):
+//   <uavs>       drones                                   (100)
+//   <duration>   measured simulated seconds               (60)
+//   <report>     JSON report file                         (fleet_bench.json)
+//   <warmup>     simulated seconds from the deployment to the plans' start (5)
+//   <spacing>    distance between the drones' cells [m]   (30)
+//   <model>      drone model                              (model://UAM/minidrone/model_FP1.sdf)
+
+#include "gazebo/gazebo.hh"
+#include "gazebo/physics/physics.hh"
+#include "gazebo/common/SystemPaths.hh"
+
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+
+#include "rclcpp/rclcpp.hpp"
+#include "navsim_msgs/msg/flight_plan.hpp"
+
+#include "navsim/CommandLatency.h"
+#include "navsim/FleetRegistry.h"
+#include "navsim/MemoryAccount.h"
+#include "navsim/Profiler.h"
+
+
+
+namespace gazebo
+{
+class FleetBench : public WorldPlugin
+{
+
+private:
+
+// Gazebo
+physics::WorldPtr    world;
+event::ConnectionPtr updateConnector;
+common::Time         currentTime;
+
+// ROS2
+rclcpp::Node::SharedPtr rosNode;
+
+// Benchmark
+int    NumUAVs   = 100;
+double Duration  = 60;          // seconds
+double Warmup    = 5;           // seconds
+double Spacing   = 30;          // meters
+std::string ReportPath = "fleet_bench.json";
+std::string ModelURI   = "model://UAM/minidrone/model_FP1.sdf";
+
+const double Altitude = 10;     // meters, of the square loops
+const double Side     = 10;     // meters
+const double Climb    = 5;      // seconds from the ground to the loop
+const double Leg      = 5;      // seconds per side of the square
+const double ResendPeriod = 0.5;   // seconds, until the drone has the plan
+
+enum class Stage { DEPLOYING, PLANNING, MEASURING, DONE };
+Stage stage = Stage::DEPLOYING;
+
+struct BenchUAV
+{
+    std::string name;
+    ignition::math::Vector3d start;
+    navsim_msgs::msg::FlightPlan plan;
+    rclcpp::Publisher<navsim_msgs::msg::FlightPlan>::SharedPtr pub;
+};
+std::vector<BenchUAV> uavs;
+
+common::Time planStart;         // first waypoint of every plan
+common::Time measureStart;
+common::Time prevResendTime;
+
+// Measurement window
+std::chrono::steady_clock::time_point prevStepWall, wallStart;
+navsim::TimeHistogram steps;    // wall time of a world step [ns]
+long   numSteps = 0;
+double cpuStart = 0;
+int    flying   = 0;
+
+
+public:
+
+void Load(physics::WorldPtr _parent, sdf::ElementPtr _sdf)
+{
+    world = _parent;
+
+    if (_sdf->HasElement("uavs"))
+        NumUAVs = _sdf->Get<int>("uavs");
+    if (_sdf->HasElement("duration"))
+        Duration = _sdf->Get<double>("duration");
+    if (_sdf->HasElement("report"))
+        ReportPath = _sdf->Get<std::string>("report");
+    if (_sdf->HasElement("warmup"))
+        Warmup = _sdf->Get<double>("warmup");
+    if (_sdf->HasElement("spacing"))
+        Spacing = _sdf->Get<double>("spacing");
+    if (_sdf->HasElement("model"))
+        ModelURI = _sdf->Get<std::string>("model");
+
+    if (const char *env = std::getenv("NAVSIM_BENCH_UAVS"))     NumUAVs    = std::atoi(env);
+    if (const char *env = std::getenv("NAVSIM_BENCH_DURATION")) Duration   = std::atof(env);
+    if (const char *env = std::getenv("NAVSIM_BENCH_REPORT"))   ReportPath = env;
+
+
+    // Drone model
+    std::string path = common::SystemPaths::Instance()->FindFileURI(ModelURI);
+    std::ifstream file(path.empty() ? ModelURI : path);
+    std::string modelTXT((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (modelTXT.empty())
+    {
+        printf("\nERROR: FleetBench cannot read the drone model %s\n\n", ModelURI.c_str());
+        return;
+    }
+
+
+    // ROS2 node (the World plugin initializes ROS)
+    if (!rclcpp::ok())
+        rclcpp::init(0, nullptr);
+    rosNode = rclcpp::Node::make_shared("FleetBench");
+
+
+    // Drones on a square grid centered at the origin, one per cell
+    int columns = int(std::ceil(std::sqrt(double(NumUAVs))));
+    for (int k = 0; k < NumUAVs; k++)
+    {
+        BenchUAV uav;
+        char name[32];
+        snprintf(name, sizeof(name), "BENCH%04d", k);
+        uav.name  = name;
+        uav.start = ignition::math::Vector3d((k % columns - 0.5 * (columns - 1)) * Spacing,
+                                             (k / columns - 0.5 * (columns - 1)) * Spacing, 0.1);
+
+        sdf::SDF modelSDF;
+        modelSDF.SetFromString(modelTXT);
+        sdf::ElementPtr modelElement = modelSDF.Root()->GetElement("model");
+        modelElement->GetAttribute("name")->SetFromString(uav.name);
+        modelElement->GetElement("pose")->Set(ignition::math::Pose3d(uav.start, ignition::math::Quaterniond::Identity));
+        world->InsertModelSDF(modelSDF);
+
+        uav.pub = rosNode->create_publisher<navsim_msgs::msg::FlightPlan>(
+            "/NavSim/" + uav.name + "/FlightPlan", 2);
+        uavs.push_back(uav);
+    }
+    navsim::MemoryRegistry::Instance().Expect();   // the models load in the next update
+
+    updateConnector = event::Events::ConnectWorldUpdateBegin(
+        std::bind(&FleetBench::OnWorldUpdateBegin, this));
+
+    printf("NAVSIM FleetBench: %d UAVs, %.0f s measured, report %s\n", NumUAVs, Duration, ReportPath.c_str());
+}
+
+
+
+void OnWorldUpdateBegin()
+{
+    currentTime = world->SimTime();
+
+    switch (stage)
+    {
+        case Stage::DEPLOYING: Deploying(); break;
+        case Stage::PLANNING:  Planning();  break;
+        case Stage::MEASURING: Measuring(); break;
+        case Stage::DONE: break;
+    }
+}
+
+
+
+// Waits until every drone is in the world, then plans their flights
+void Deploying()
+{
+    for (const BenchUAV &uav : uavs)
+        if (!world->ModelByName(uav.name)) return;
+
+    planStart    = currentTime + common::Time(Warmup);
+    measureStart = planStart + common::Time(Climb);
+
+    for (BenchUAV &uav : uavs)
+        uav.plan = SquareLoop(uav, planStart.Double(), measureStart.Double() + Duration + 2 * Leg);
+
+    prevResendTime = currentTime - common::Time(ResendPeriod);
+    stage = Stage::PLANNING;
+    printf("NAVSIM FleetBench: %zu UAVs deployed at %.2f s, plans start at %.2f s\n",
+           uavs.size(), currentTime.Double(), planStart.Double());
+}
+
+
+
+// Climbs to the loop altitude, then loops the square of the cell at 2 m/s
+navsim_msgs::msg::FlightPlan SquareLoop(const BenchUAV &uav, double start, double end)
+{
+    navsim_msgs::msg::FlightPlan plan;
+    plan.plan_id     = 1;
+    plan.uav_id      = uav.name;
+    plan.operator_id = "FleetBench";
+    plan.mode        = "TP";
+    plan.radius      = 1;
+
+    auto add = [&](double t, double x, double y, double z)
+    {
+        navsim_msgs::msg::Waypoint wp;
+        wp.pos.x = x;
+        wp.pos.y = y;
+        wp.pos.z = z;
+        wp.time.sec     = int32_t(std::floor(t));
+        wp.time.nanosec = uint32_t((t - std::floor(t)) * 1E9);
+        plan.route.push_back(wp);
+    };
+
+    const double corners[4][2] = { {-1, -1}, {1, -1}, {1, 1}, {-1, 1} };
+    double x = uav.start.X(), y = uav.start.Y(), r = Side / 2;
+
+    add(start, x, y, uav.start.Z());
+    double t = start + Climb;
+    add(t, x + corners[0][0] * r, y + corners[0][1] * r, Altitude);
+    for (int c = 1; t < end; c = (c + 1) % 4)
+    {
+        t += Leg;
+        add(t, x + corners[c][0] * r, y + corners[c][1] * r, Altitude);
+    }
+    return plan;
+}
+
+
+
+// Sends the plans until every drone has got its own
+void Planning()
+{
+    if ((currentTime - prevResendTime).Double() >= ResendPeriod && currentTime < planStart)
+    {
+        prevResendTime = currentTime;
+        for (BenchUAV &uav : uavs)
+            if (!navsim::FleetRegistry::Instance().Plan(uav.name))
+            {
+                uav.plan.stamp_wall = navsim::SecToTime(navsim::WallTime());   // for /NavSim/CommandLatency
+                uav.plan.stamp_sim  = navsim::SecToTime(currentTime.Double());
+                uav.pub->publish(uav.plan);
+            }
+    }
+
+    if (currentTime < measureStart) return;
+
+    flying = 0;
+    for (const BenchUAV &uav : uavs)
+        if (navsim::FleetRegistry::Instance().Plan(uav.name)) flying++;
+    if (flying < int(uavs.size()))
+        printf("NAVSIM FleetBench: WARNING only %d of %zu UAVs got their plans in time\n", flying, uavs.size());
+
+    wallStart = prevStepWall = std::chrono::steady_clock::now();
+    cpuStart  = CpuTime();
+    stage = Stage::MEASURING;
+}
+
+
+
+void Measuring()
+{
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    steps.Add(std::chrono::duration_cast<std::chrono::nanoseconds>(now - prevStepWall).count());
+    prevStepWall = now;
+    numSteps++;
+
+    double simTime = (currentTime - measureStart).Double();
+    if (simTime < Duration) return;
+
+    double wallTime = std::chrono::duration<double>(now - wallStart).count();
+    double cpuTime  = CpuTime() - cpuStart;
+    Report(simTime, wallTime, cpuTime);
+
+    stage = Stage::DONE;
+    std::raise(SIGINT);         // gzserver shuts down
+}
+
+
+
+void Report(double simTime, double wallTime, double cpuTime)
+{
+    std::vector<uint64_t> counts(navsim::TimeHistogram::Buckets, 0);
+    steps.Accumulate(counts);
+    double maxStep = steps.TakeMax() * 1E-6;
+
+    FILE *report = fopen(ReportPath.c_str(), "w");
+    if (!report)
+    {
+        printf("\nERROR: FleetBench cannot write %s\n\n", ReportPath.c_str());
+        return;
+    }
+
+    physics::PhysicsEnginePtr physics = world->Physics();
+    fprintf(report, "{\n");
+    fprintf(report, "  \"uavs\": %zu,\n", uavs.size());
+    fprintf(report, "  \"flying\": %d,\n", flying);
+    fprintf(report, "  \"max_step_size\": %g,\n", physics->GetMaxStepSize());
+    fprintf(report, "  \"sim_time\": %.3f,\n", simTime);
+    fprintf(report, "  \"wall_time\": %.3f,\n", wallTime);
+    fprintf(report, "  \"rtf\": %.4f,\n", wallTime > 0 ? simTime / wallTime : 0.0);
+    fprintf(report, "  \"steps\": %ld,\n", numSteps);
+    fprintf(report, "  \"step_ms\": { \"p50\": %.4f, \"p90\": %.4f, \"p99\": %.4f, \"max\": %.4f },\n",
+            navsim::Percentile(counts, 0.50) * 1E-6, navsim::Percentile(counts, 0.90) * 1E-6,
+            navsim::Percentile(counts, 0.99) * 1E-6, maxStep);
+    fprintf(report, "  \"cpu_time\": %.3f,\n", cpuTime);
+    fprintf(report, "  \"cpu_cores\": %.3f,\n", wallTime > 0 ? cpuTime / wallTime : 0.0);
+    std::vector<const navsim::MemoryAccount *> accounts = navsim::MemoryRegistry::Instance().Accounts();
+    fprintf(report, "  \"uav_memory_kb\": {");
+    for (int c = 0; c < int(navsim::MemoryCategory::Count); c++)
+    {
+        double total = 0;
+        for (const navsim::MemoryAccount *account : accounts)
+            total += account->Bytes(navsim::MemoryCategory(c));
+        fprintf(report, "%s \"%s\": %.1f", c ? "," : "", navsim::MemoryCategoryName(navsim::MemoryCategory(c)),
+                accounts.empty() ? 0.0 : total / accounts.size() / 1024);
+    }
+    fprintf(report, " },\n");
+    fprintf(report, "  \"rss_mb\": %.1f,\n", MemoryMB("VmRSS:"));
+    fprintf(report, "  \"peak_rss_mb\": %.1f\n", MemoryMB("VmHWM:"));
+    fprintf(report, "}\n");
+    fclose(report);
+
+    printf("NAVSIM FleetBench: %zu UAVs, RTF %.3f, step p50 %.3f ms p99 %.3f ms, report %s\n",
+           uavs.size(), wallTime > 0 ? simTime / wallTime : 0.0,
+           navsim::Percentile(counts, 0.50) * 1E-6, navsim::Percentile(counts, 0.99) * 1E-6, ReportPath.c_str());
+}
+
+
+
+// User and system CPU time of the process (all its threads) [s]
+static double CpuTime()
+{
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec * 1E-6
+         + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec * 1E-6;
+}
+
+
+
+// Field of /proc/self/status, in MB
+static double MemoryMB(const std::string &field)
+{
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
+        if (line.compare(0, field.size(), field) == 0)
+            return std::atof(line.c_str() + field.size()) / 1024;   // kB
+    return 0;
+}
+
+};
+
+// Register this plugin with the simulator
+GZ_REGISTER_WORLD_PLUGIN(FleetBench)
+
+}
@@ -13,6 +13,16 @@
 #include "navsim_msgs/msg/flight_plan.hpp"
 #include "navsim_msgs/msg/navigation_report.hpp"
 
+#include "navsim/FleetRegistry.h"
+#include "navsim/CommandLatency.h"
+#include "navsim/MemoryAccount.h"
+#include "navsim/Profiler.h"
+#include "navsim/core/Controller.h"
+#include "navsim/core/GainSchedule.h"
+#include "navsim/core/Kinematic.h"
+#include "navsim/core/PlanFollower.h"
+#include "navsim/core/Quadrotor.h"
+
 
 
 
@@ -28,6 +38,11 @@ private:
 physics::ModelPtr    model;
 physics::LinkPtr     link;
 event::ConnectionPtr updateConnector;
+#if NAVSIM_ENABLE_PROFILING
+std::shared_ptr<navsim::UavTimes> updateTimes;   // of the world update (navsim/Profiler.h)
+#endif
+std::shared_ptr<navsim::UavLatency> commandLatency;   // (navsim/CommandLatency.h)
+navsim::MemoryAccount *memory = nullptr;              // (navsim/MemoryAccount.h)
 common::Time         currentTime;
 
 
@@ -56,17 +71,8 @@ rclcpp::Publisher<navsim_msgs::msg::NavigationReport>::SharedPtr rosPub_NavRepor
 // Flight plan 
 navsim_msgs::msg::FlightPlan::SharedPtr fp = nullptr;
 
-// Waypoint currently flying to:
-// -1: no waypoint
-//  0: starting point
-//  1: first waypoint
-// numWPs-1: last waypoint
-
-int currentWP = -1;  
-
-double maxVarLinVel = 5;   // maximum variation in linear  velocity   [  m/s]
-double maxVarAngVel = 2;   // maximum variation in angular velocity   [rad/s]
-double targetStep = 2;     // Compute targetPos targetStep seconds later  [s]
+// Route navigation (waypoints, target velocity and heading), in navsim_core
+navsim::PlanFollower follower;
 
 
 // rotor engine status on/off
@@ -85,97 +91,79 @@ common::Time CommandExpTime;
 
 
 ////////////////////////////////////////////////////////////////////////
-// quadcopter parameters
+// quadcopter model and low level control, in navsim_core
 
-const double g    = 9.8;
-const double mass = 0.595;
+navsim::QuadrotorParams     params = navsim::QuadrotorParams::Minidrone();
+navsim::QuadrotorController controller{params};
 
+common::Time prevControlTime = 0; // Fecha de la ultima actualizacion del control de bajo nivel 
+        
 
-// Velocidad de rotación de los motores (rad/s)
-double w_rotor_NE;
-double w_rotor_NW;
-double w_rotor_SE;
-double w_rotor_SW;
-
-// Max and minimum angular velocity of the motors
-const double w_max = 628.3185;      // rad/s = 15000rpm
-const double w_min = 0;             // rad/s =     0rpm
 
-//Rotors position at distance 15cms from the center of mass, inclination 45º from the axes
-ignition::math::Vector3<double> pos_CM = ignition::math::Vector3<double>(     0,      0, 0);   // center of mass
-ignition::math::Vector3<double> pos_NE = ignition::math::Vector3<double>( 0.075, -0.075, 0);   // cosd(45º) * 0.15m
-ignition::math::Vector3<double> pos_NW = ignition::math::Vector3<double>( 0.075,  0.075, 0);
-ignition::math::Vector3<double> pos_SE = ignition::math::Vector3<double>(-0.075, -0.075, 0);
-ignition::math::Vector3<double> pos_SW = ignition::math::Vector3<double>(-0.075,  0.075, 0);
 
-// Aero-dynamic thrust force constant
-// Force generated by the rotors is FT = kFT * w²
-const double kFT = 1.7179e-05;                 // assuming that FT_max = 0.692kg
-const double w_hov = sqrt(mass * g / 4 /kFT);  // 628.3185 rad/s
+////////////////////////////////////////////////////////////////////////
+// Idle mode: a parked drone (at rest, rotors off, without command or plan)
+// disables its body and skips navigation, control and dynamics until woken up
 
-//Aero-dynamic drag force constant
-//Moment generated by the rotors is MDR = kMDR * w²
-const double kMDR = 3.6714e-08;
+bool   asleep = false;
+common::Time restSince = 0;       // idle and at rest since then
+double SleepDelay = 1.0;          // seconds at rest before sleeping
+double RestSpeed  = 0.05;         // m/s and rad/s
 
 
-//Aero-dynamic drag force constant per axis
-//Drag force generated by the air friction, opposite to the velocity is FD = -kFD * r_dot*|r_dot| (depends on the shape of the object in each axis).
-// Horizontal axis:
-const double kFDx = 1.1902e-04;
-const double kFDy = 1.1902e-04;
-// Vertical axis:
-const double kFDz = 36.4437e-4;
 
 
-//Aero-dynamic drag moment constant per axis
-//Drag moment generated by the air friction, opposite to the angular velocity is MD = -kMD * rpy_dot*|rpy_dot| (depends on the shape of the object in each axis).
+////////////////////////////////////////////////////////////////////////
+// Level of detail: cruising far from everything (flagged by the World in the
+// FleetRegistry), the drone flies the kinematic model of navsim_core instead
+// of the rotor dynamics, and sets its pose and velocity with the gravity off
 
-// Horizontal axis:
-//Assuming similar drag in both axes (although the fuselage is not equal), no gravity and the drone is propulsed by two rotors of the same side at maximum speed the maximum angular velocity is Vrp_max = 2 * 2*pi;
-//operating kMDxy =  2 * FT_max * sin(deg2rad(45))^2 / Vrp_max^2 we get that...
-const double kMDx = 1.1078e-04;
-const double kMDy = 1.1078e-04;
+bool kinematic = false;
+navsim::QuadrotorState kinematicState;
+common::Time prevKinematicTime;
 
-//Vertical axis:
-//Must be verified at maximum yaw velocity
-//Assuming that Vyaw_max = 4*pi rad/s (max yaw velocity of 2rev/s) and w_hov2 (rotor speed to maintain the hovering)
-//And taking into account that MDR = kMDR * w² and MDz = kMDz * Vyaw²
-//operating MDz  = MDR (the air friction compensates the effect of the rotors) and kMDz = kMDR* (2 * w_hov2²) / Vyaw_max² we get that...
-const double kMDz = 7.8914e-05;
 
 
 
 ////////////////////////////////////////////////////////////////////////
-// Control matrices variables
-Eigen::Matrix<double, 8, 1> x;  // model state
-Eigen::Matrix<double, 4, 1> y;  // model output
-Eigen::Matrix<double, 4, 8> Kx; // state control matrix
-Eigen::Matrix<double, 4, 4> Ky; // error control matrix
-Eigen::Matrix<double, 4, 1> Hs; // hovering speed
-Eigen::Matrix<double, 4, 1> u;  // input (rotors speeds)
-Eigen::Matrix<double, 4, 1> r;  // model reference
-Eigen::Matrix<double, 4, 1> e;  // model error
-Eigen::Matrix<double, 4, 1> E;  // model acumulated error
-
-int E_max = 15;  // prev value 5                  // maximun model acumulated error
-common::Time prevControlTime = 0; // Fecha de la ultima actualizacion del control de bajo nivel 
-        
-
+////////////////////////////////////////////////////////////////////////
 
+public: 
+~UAM_minidrone_FP1()
+{
+    navsim::FleetRegistry::Instance().Remove(UAVname);
+    navsim::MemoryRegistry::Instance().Release(memory);
+}
 
 
-////////////////////////////////////////////////////////////////////////
-////////////////////////////////////////////////////////////////////////
 
-public: 
-void Load(physics::ModelPtr _parent, sdf::ElementPtr /*_sdf*/)
+void Load(physics::ModelPtr _parent, sdf::ElementPtr _sdf)
 {
     // printf("DRONE CHALLENGE Drone plugin: loading\n");
 
     // Get information from the model
     model = _parent;
     UAVname = model->GetName();
+    memory = navsim::MemoryRegistry::Instance().Spawn(UAVname, sizeof(*this));
+    navsim::MemoryScope memoryScope(memory);
     link = model->GetLink("dronelink");
+#if NAVSIM_ENABLE_PROFILING
+    updateTimes = navsim::Profiler::Instance().Uav(UAVname);
+#endif
+    commandLatency = navsim::LatencyMonitor::Instance().Uav(UAVname);
+
+    // Gain schedule of the controller (SDF <gain_table>, a file or a model:// URI)
+    if (_sdf->HasElement("gain_table"))
+    {
+        std::string uri = _sdf->Get<std::string>("gain_table");
+        std::string path = common::SystemPaths::Instance()->FindFileURI(uri);
+        auto gains = std::make_shared<navsim::GainSchedule>();
+        std::string error;
+        if (gains->Load(path.empty() ? uri : path, error))
+            controller.SetSchedule(gains);
+        else
+            printf("NAVSIM %s: %s, flying with the hover gains\n", UAVname.c_str(), error.c_str());
+    }
 
     // Periodic event
     updateConnector = event::Events::ConnectWorldUpdateBegin(
@@ -184,6 +172,7 @@ void Load(physics::ModelPtr _parent, sdf::ElementPtr /*_sdf*/)
     // ROS2
     if (rclcpp::ok()) 
     {
+        int64_t heap = navsim::ProcessMemory::Sample().heap;
         rosNode = rclcpp::Node::make_shared(this->UAVname);
 
         rosPub_Telemetry = rosNode->create_publisher<navsim_msgs::msg::Telemetry>(
@@ -197,42 +186,19 @@ void Load(physics::ModelPtr _parent, sdf::ElementPtr /*_sdf*/)
         rosSub_FlightPlan = rosNode->create_subscription<navsim_msgs::msg::FlightPlan>(
             "/NavSim/" + UAVname + "/FlightPlan", 2,
             std::bind(&UAM_minidrone_FP1::rosTopFn_FlightPlan, this, 
-                    std::placeholders::_1));
+                    std::placeholders::_1, std::placeholders::_2));
 
         rosPub_NavReport = rosNode->create_publisher<navsim_msgs::msg::NavigationReport>(
             "/NavSim/" + UAVname + "/NavigationReport", 10);
 
+        memory->Set(navsim::MemoryCategory::Ros, navsim::ProcessMemory::Sample().heap - heap);
     }
     else
     {   
         std::cout << "\x1B[2J\x1B[H";       // Clear screen
         printf("\nERROR: NavSim world plugin is not running ROS2!\n\n");
     }
-
-
-    //Initial control matrices
-    Kx <<  -47.4820, -47.4820, -9.3626, -9.3626,  413.1508, -10.5091,  10.5091,  132.4440,
-            47.4820, -47.4820,  9.3626, -9.3626, -413.1508, -10.5091, -10.5091,  132.4440,
-           -47.4820,  47.4820, -9.3626,  9.3626, -413.1508,  10.5091,  10.5091,  132.4440,
-            47.4820,  47.4820,  9.3626,  9.3626,  413.1508,  10.5091, -10.5091,  132.4440;
-
-    Ky <<   -8.1889,  8.1889,  294.3201,  918.1130,
-            -8.1889, -8.1889,  294.3201, -918.1130,
-             8.1889,  8.1889,  294.3201, -918.1130,
-             8.1889, -8.1889,  294.3201,  918.1130;
-    
-	// Linearization point
-    Hs << w_hov, w_hov, w_hov, w_hov;
-    //    std::cout  << Hs << " \n\n";
-
-	//Reference to follow
-	r << 0, 0, 0, 0;
-
-	//Cumulative error in the reference following
-	E << 0, 0, 0, 0;
-
-	//Control input signal (rotor real speeds)
-	u << w_hov, w_hov, w_hov, w_hov;
+    navsim::MemoryRegistry::Instance().Spawned();
 
 }
 
@@ -265,6 +231,9 @@ void Init()
 
 void OnWorldUpdateBegin()
 {
+    NAVSIM_PROFILE_UAV(updateTimes.get());
+    navsim::MemoryScope memoryScope(memory);
+
     // Clear screen
     // std::cout << "\x1B[2J\x1B[H";
     // printf("DCdrone plugin: OnWorldUpdateBegin\n");
@@ -273,12 +242,23 @@ void OnWorldUpdateBegin()
     currentTime = model->GetWorld()->SimTime();
 
 
-    // UAV fligh plan navigation
-    Navigation();
-    
-    // Platform low level control
-    ServoControl();
-    PlatformDynamics();
+    // A parked drone only keeps its telemetry and its subscriptions
+    if (!Sleep())
+    {
+        // UAV fligh plan navigation
+        Navigation();
+
+        // Kinematic model in cruise far from everything, rotor dynamics otherwise
+        SelectFidelity();
+        if (kinematic)
+            KinematicDynamics();
+        else
+        {
+            // Platform low level control
+            ServoControl();
+            PlatformDynamics();
+        }
+    }
 
     // Telemetry communication
     Telemetry();
@@ -292,6 +272,8 @@ void OnWorldUpdateBegin()
 
 void Navigation()
 {
+    NAVSIM_PROFILE(navsim::Phase::Navigation);
+
     if (fp == nullptr) return;
 
     // Create a Navigation Report MSG
@@ -310,256 +292,227 @@ void Navigation()
     msg.time.nanosec = currentTime.nsec;
 
 
-    // Check FP vigency
-    int WP = GetWPatTime(currentTime);
-    std::vector<navsim_msgs::msg::Waypoint> route = fp->route;
-    int numWPs = route.size();
-
-    if (currentWP == -1 && WP != 0)
-    {
-        // This flight plan is obsolet
-        printf("%s discarding FP due to it is obsolet\n",UAVname.c_str());
-
-        msg.fp_aborted = true;
-        rosPub_NavReport->publish(msg);
-
-        fp = nullptr;
-        return;
-    }
-    
-
-    // Current UAV status
-    ignition::math::Pose3<double> pose = model->WorldPose();
-    ignition::math::Vector3<double> currentPos = pose.Pos();
-    double currentYaw = pose.Yaw();
-    ignition::math::Vector3<double> currentAbsVel = model->WorldLinearVel();
+    // Target velocity and heading of the flight plan
+    navsim::VelocityCommand cmd;
+    double cmdExpTime = CommandExpTime.Double();
+    navsim::NavEvent event = follower.Update(currentTime.Double(), GetState(), cmd, cmdExpTime);
 
 
     // Navigation status has changed?
-    if (currentWP != WP)
+    switch (event)
     {
+        case navsim::NavEvent::NONE:
+            break;
 
-        printf("%s ",UAVname.c_str());
-        if (WP == 0)
-        {
-            // drone waiting to start the flight
-            printf("waiting at starting WP%d \n",WP);
-
-            navsim_msgs::msg::Waypoint WP0 = fp->route[0];
-            ignition::math::Vector3<double> initPos = ignition::math::Vector3d(WP0.pos.x,WP0.pos.y,WP0.pos.z);
-            initPos = initPos - currentPos;
-            if (initPos.Length() > fp->radius)
-            {
-                // drone in an incorrect starting position
+        case navsim::NavEvent::OBSOLETE:
+        case navsim::NavEvent::WRONG_START:
+            if (event == navsim::NavEvent::OBSOLETE)
+                printf("%s discarding FP due to it is obsolet\n",UAVname.c_str());
+            else
                 printf("%s discarding FP due to an incorrect starting position\n",UAVname.c_str());
 
-                msg.fp_aborted = true;
-                rosPub_NavReport->publish(msg);
+            msg.fp_aborted = true;
+            rosPub_NavReport->publish(msg);
 
-                fp = nullptr;
-                return;
-            }
+            navsim::FleetRegistry::Instance().ClearPlan(UAVname);
+            fp = nullptr;
+            return;
+
+        case navsim::NavEvent::COMPLETED:
+            printf("%s has completed its flight plan\n",UAVname.c_str());
 
-        }
-        else if (WP == 1)
-            printf("starting flight to WP%d \n",WP);
-        else if (WP < numWPs)
-            printf("heading WP%d \n",WP);
-        else
-        {
-            // flight plan completed
-            printf("has completed its flight plan\n");
-    
             commandOff();
 
             msg.fp_completed = true;
             rosPub_NavReport->publish(msg);
 
+            navsim::FleetRegistry::Instance().ClearPlan(UAVname);
             fp = nullptr;
             return;
-        }
 
-        msg.fp_running = true;
-        msg.current_wp = WP;
-        rosPub_NavReport->publish(msg);
+        default:
+            if (event == navsim::NavEvent::WAITING)
+                printf("%s waiting at starting WP0 \n",UAVname.c_str());
+            else if (event == navsim::NavEvent::STARTED)
+                printf("%s starting flight to WP1 \n",UAVname.c_str());
+            else
+                printf("%s heading WP%d \n",UAVname.c_str(),follower.CurrentWaypoint());
 
+            msg.fp_running = true;
+            msg.current_wp = follower.CurrentWaypoint();
+            rosPub_NavReport->publish(msg);
+            break;
     }
 
-    currentWP = WP;
 
+    // CREATING COMMANDED RELATIVE VELOCITY VECTOR
+    cmd_on   = cmd.on;
+    cmd_velX = cmd.vel.x();
+    cmd_velY = cmd.vel.y();
+    cmd_velZ = cmd.vel.z();
+    cmd_rotZ = cmd.yawRate;
 
-    // Time step to analyze movement
-    common::Time FPtime;
-    FPtime.sec  = route[numWPs-1].time.sec;
-    FPtime.nsec = route[numWPs-1].time.nanosec;
+    CommandExpTime = common::Time(cmdExpTime);
 
-    double step = (FPtime - currentTime).Double();
-    if (step > targetStep)
-    {
-        step = targetStep;
-    }
-  
+}
 
-    // COMPUTING TARGET POSITION
-    ignition::math::Vector3<double> targetPos = PositionAtTime(currentTime + step);
 
-    // COMPUTING TARGET ABSOLUTE LINEAR VELOCITY (to achieve targetPos in 'targetStep' seconds)
-    ignition::math::Vector3<double> targetAbsVel = (targetPos - currentPos) / step;
-    ignition::math::Vector3<double> variationAbsVel = targetAbsVel - currentAbsVel;
-    if (variationAbsVel.Length() > maxVarLinVel)
-    {
-        variationAbsVel.Normalize();
-        variationAbsVel *= maxVarLinVel;
-    }
-    targetAbsVel = currentAbsVel + variationAbsVel;
 
 
-    // COMPUTING DRONE RELATIVE LINEAR VELOCITY
-    ignition::math::Quaterniond orientation = pose.Rot();
-    ignition::math::Vector3d targetRelVel = orientation.RotateVectorReverse(targetAbsVel);
+// Returns true while the drone is parked and asleep
+bool Sleep()
+{
+    if (asleep)
+    {
+        // ODE enables the body again on a contact with another body
+        if (!link->GetEnabled() && currentTime >= restSince) return true;
 
+        WakeUp();
+        return false;
+    }
 
+    bool idle = !cmd_on && !rotors_on && fp == nullptr
+             && model->WorldLinearVel().Length()  < RestSpeed
+             && model->WorldAngularVel().Length() < RestSpeed;
 
-    // COMPUTING TARGET YAW
-    double targetYaw = YawAtTime(currentTime + targetStep);
-    double errorYaw = targetYaw - currentYaw;
-    while (errorYaw < -M_PI)
+    // Busy, moving, or the simulation was reset
+    if (!idle || currentTime < restSince)
     {
-        errorYaw += 2*M_PI;
+        restSince = currentTime;
+        return false;
     }
-    while (M_PI < errorYaw)
-    {
-        errorYaw -= 2*M_PI;
-    }
-    
 
-    // COMPUTING TARGET ANGULAR VELOCITY
-    double currentWel = errorYaw / targetStep;
-    if (currentWel < -maxVarAngVel)
-    {
-        currentWel = -maxVarAngVel;
-    }
-    if (maxVarAngVel < currentWel)
-    {
-        currentWel = maxVarAngVel;
-    }
+    if ((currentTime - restSince).Double() < SleepDelay) return false;
 
+    link->SetEnabled(false);
+    asleep = true;
+    return true;
+}
 
-    // CREATING COMMANDED RELATIVE VELOCITY VECTOR
 
-    cmd_on   = true;
-    cmd_velX = targetRelVel.X();
-    cmd_velY = targetRelVel.Y();
-    cmd_velZ = targetRelVel.Z();
-    cmd_rotZ = currentWel; 
 
-    common::Time duration;
-    duration.sec  = 1;
-    duration.nsec = 0;
-    CommandExpTime = currentTime + duration;
 
+void WakeUp()
+{
+    if (!asleep) return;
 
+    asleep = false;
+    restSince = currentTime;
+    link->SetEnabled(true);
 }
-    
 
 
 
-int GetWPatTime(common::Time time)
-{
-    std::vector<navsim_msgs::msg::Waypoint> route = fp->route;
-    int numWPs = route.size();
 
-    int i;
-    for(i=0; i<numWPs; i++)
+void SelectFidelity()
+{
+    // Cruise: airborne between the takeoff leg (to WP1) and the landing leg (to the last WP)
+    int wp     = follower.CurrentWaypoint();
+    int numWPs = follower.GetRoute().waypoints.size();
+    bool cruise = fp != nullptr && rotors_on && cmd_on && 2 <= wp && wp <= numWPs - 2;
+
+    bool reset  = currentTime < prevKinematicTime;
+    bool wanted = cruise && !reset && navsim::FleetRegistry::Instance().Kinematic(UAVname);
+    if (wanted == kinematic) return;
+
+    // Both models share the state, so the switch carries the pose and velocities over
+    kinematic = wanted;
+    link->SetGravityMode(!kinematic);
+    if (kinematic)
     {
-        common::Time WPtime;
-        WPtime.sec  = route[i].time.sec;
-        WPtime.nsec = route[i].time.nanosec;
-        if (time < WPtime)
-            break;
-    } 
-    
-    return i;
-
+        kinematicState    = GetState();
+        prevKinematicTime = currentTime;
+    }
+    else if (!reset)
+    {
+        // The controller resumes at this step, with the velocities the kinematic
+        // model left as the reference and the rotors at their trim there
+        Eigen::Vector3d wind = navsim::FleetRegistry::Instance().Wind(UAVname);
+        controller.Seed(kinematicState, navsim::TrimRotorSpeeds(params, kinematicState, wind));
+        prevControlTime = currentTime;
+    }
 }
 
 
 
 
-ignition::math::Vector3<double> PositionAtTime(common::Time t)
+// Lags of the minidrone, fitted once to the full model for all the drones
+static const navsim::KinematicParams &KinematicLags()
 {
-    
-    int i = GetWPatTime(t);
-    int numWPs = fp->route.size();
-    
-    navsim_msgs::msg::Waypoint WP1 = fp->route[i-1];
-    ignition::math::Vector3<double> pos1 = ignition::math::Vector3d(WP1.pos.x,WP1.pos.y,WP1.pos.z);
-    ignition::math::Vector3<double> targetPos = pos1;
-
-    if (i < numWPs)
-    {
-        
-        navsim_msgs::msg::Waypoint WP2 = fp->route[i];
-        ignition::math::Vector3<double> pos2 = ignition::math::Vector3d(WP2.pos.x,WP2.pos.y,WP2.pos.z);
-
-        common::Time t1;
-        t1.sec  = WP1.time.sec;
-        t1.nsec = WP1.time.nanosec;
+    static const navsim::KinematicParams lags = navsim::FitKinematicParams(navsim::QuadrotorParams::Minidrone());
+    return lags;
+}
 
-        common::Time t2;
-        t2.sec  = WP2.time.sec;
-        t2.nsec = WP2.time.nanosec;
 
 
-        double interpol = (t-t1).Double() / (t2-t1).Double() ;
-        targetPos = pos1 + interpol * (pos2 - pos1);
 
-    }
-    
-    return targetPos;
+void KinematicDynamics()
+{
+    NAVSIM_PROFILE(navsim::Phase::KinematicDynamics);
+    commandLatency->Applied(currentTime.Double());
 
-}
+    double interval = (currentTime - prevKinematicTime).Double();
+    prevKinematicTime = currentTime;
 
+    // Check if the command has expired
+    if (CommandExpTime < currentTime)
+        hover();
 
+    navsim::VelocityCommand cmd;
+    cmd.on      = cmd_on;
+    cmd.vel     = Eigen::Vector3d(cmd_velX, cmd_velY, cmd_velZ);
+    cmd.yawRate = cmd_rotZ;
 
+    navsim::KinematicStep(KinematicLags(), kinematicState, cmd, interval);
 
-double YawAtTime(common::Time t)
-{
+    const navsim::QuadrotorState &s = kinematicState;
+    Eigen::Vector3d angVel = s.rot * s.angVel;
+    link->SetWorldPose(ignition::math::Pose3d(s.pos.x(), s.pos.y(), s.pos.z(),
+                                              s.rot.w(), s.rot.x(), s.rot.y(), s.rot.z()));
+    link->SetLinearVel (ignition::math::Vector3d(s.vel.x(),  s.vel.y(),  s.vel.z()));
+    link->SetAngularVel(ignition::math::Vector3d(angVel.x(), angVel.y(), angVel.z()));
+}
 
-    int i = GetWPatTime(t);
-    int numWPs = fp->route.size();
-    if (i == numWPs)
-    {
-        i--;
-    }
-    
-    navsim_msgs::msg::Waypoint WP1 = fp->route[i-1];
-    ignition::math::Vector3<double> prevWPpos = ignition::math::Vector3d(WP1.pos.x,WP1.pos.y,WP1.pos.z);
 
-    navsim_msgs::msg::Waypoint WP2 = fp->route[i];
-    ignition::math::Vector3<double> currentWPpos = ignition::math::Vector3d(WP2.pos.x,WP2.pos.y,WP2.pos.z);
-    
-    ignition::math::Vector3<double> targetDir = currentWPpos - prevWPpos;
-    targetDir.Z() = 0;
 
-    double targetYaw;
-    if (targetDir.Length() < 1)
-         targetYaw = model->WorldPose().Yaw();
-    else
-        targetYaw = atan2(targetDir.Y(), targetDir.X());
 
-    return targetYaw;
+navsim::QuadrotorState GetState()
+{
+    ignition::math::Pose3<double> pose = model->WorldPose();
+    ignition::math::Vector3<double> linear_vel = model->WorldLinearVel();
+    ignition::math::Vector3<double> angular_vel = model->RelativeAngularVel();
 
+    navsim::QuadrotorState state;
+    state.pos    = Eigen::Vector3d(pose.X(), pose.Y(), pose.Z());
+    state.rot    = Eigen::Quaterniond(pose.Rot().W(), pose.Rot().X(), pose.Rot().Y(), pose.Rot().Z());
+    state.vel    = Eigen::Vector3d(linear_vel.X(), linear_vel.Y(), linear_vel.Z());
+    state.angVel = Eigen::Vector3d(angular_vel.X(), angular_vel.Y(), angular_vel.Z());
+    return state;
 }
 
 
 
 
-void rosTopFn_FlightPlan(const std::shared_ptr<navsim_msgs::msg::FlightPlan> msg)
+void rosTopFn_FlightPlan(const std::shared_ptr<navsim_msgs::msg::FlightPlan> msg,
+                         const rclcpp::MessageInfo &info)
 {
+    NAVSIM_TRACE(__func__);
+    commandLatency->Dequeued(navsim::MakeStamps(msg->stamp_wall, msg->stamp_sim, info, currentTime.Double()));
     // printf("Data received in topic Flight Plan\n");
+    WakeUp();
     fp = msg;
-    currentWP = -1;
+
+    navsim::Route plan;
+    plan.id     = fp->plan_id;
+    plan.radius = fp->radius;
+    for (const navsim_msgs::msg::Waypoint &wp : fp->route)
+        plan.waypoints.push_back({wp.time.sec + wp.time.nanosec * 1E-9,
+                                  Eigen::Vector3d(wp.pos.x, wp.pos.y, wp.pos.z)});
+    follower.SetRoute(plan);
+
+    // Share the intent with the fleet layer
+    navsim::FleetRegistry::Instance().SetPlan(UAVname,
+        std::make_shared<const navsim::Plan4D>(navsim::MakePlan4D(*fp)));
 
     printf("%s has received FP %d \n",UAVname.c_str(),fp->plan_id);
 
@@ -580,6 +533,7 @@ void rosTopFn_FlightPlan(const std::shared_ptr<navsim_msgs::msg::FlightPlan> msg
 
 void rosTopFn_RemoteCommand(const std::shared_ptr<navsim_msgs::msg::RemoteCommand> msg)
 {
+    NAVSIM_TRACE(__func__);
     // printf("DCdrone: data received in topic Remote Pilot\n");
     // printf("Received RemoteCommand: uav=%s, on=%d, cmd=[%f, %f, %f, %f], duration=(%d, %d)\n",
     //        msg->uav_id.c_str(), 
@@ -654,15 +608,9 @@ void hover()
 void rotorsOff()
 {
 
-    // Apagamos motores
-    w_rotor_NE = 0;
-    w_rotor_NW = 0;
-    w_rotor_SE = 0;
-    w_rotor_SW = 0;
+    // Apagamos motores y reset del control
+    controller.Reset();
     rotors_on = false;
-
-    // Reset del control
-    E << 0, 0, 0, 0;
    
 }
 
@@ -671,12 +619,13 @@ void rotorsOff()
 
 void ServoControl()
 {
+    NAVSIM_PROFILE(navsim::Phase::ServoControl);
+    commandLatency->Applied(currentTime.Double());
+
     // This fucntion converts 
     // a navigation command (desired velocity vector and rotation)
     // to speeds ot the for rotors
 
-    // printf("DRONE CHALLENGE Drone plugin: ServoControl\n");
-
 
     if (cmd_on == false)
     {
@@ -710,98 +659,18 @@ void ServoControl()
         rotors_on = true;
         prevControlTime = currentTime; 
     }
-    // printf("previous control time: %.3f \n", prevControlTime.Double());
 
     double interval = (currentTime - prevControlTime).Double();
-    // printf("control interval (seconds): %.6f \n", interval);
-    
     prevControlTime = currentTime;
 
 
-    // Getting model status
-    ignition::math::Pose3<double> pose = model->WorldPose();
-    // printf("drone xyz =  %.2f  %.2f  %.2f \n", pose.X(), pose.Y(), pose.Z());
-    // printf("drone YPR =  %.2f  %.2f  %.2f \n", pose.Yaw(), pose.Pitch(), pose.Roll());
-    ignition::math::Vector3<double> linear_vel = model->RelativeLinearVel();
-    ignition::math::Vector3<double> angular_vel = model->RelativeAngularVel();
-    // printf("drone         vel xyz =  %.2f  %.2f  %.2f\n",  linear_vel.X(),  linear_vel.Y(),  linear_vel.Z());
-    // printf("drone angular vel xyz =  %.2f  %.2f  %.2f\n", angular_vel.X(), angular_vel.Y(), angular_vel.Z());
-
-
     //Velocities commanded in body axes
-    Eigen::Matrix<double, 3, 1> b_cmd;
-    b_cmd(0, 0) = cmd_velX;     // eXdot
-    b_cmd(1, 0) = cmd_velY;     // eYdot
-    b_cmd(2, 0) = cmd_velZ;     // eZdot
-    // std::cout  << "b_cmd:  " << b_cmd.transpose()  << " \n\n";
-
-
-	// Assign the model state
-    x(0,0) = pose.Roll();     // ePhi
-    x(1,0) = pose.Pitch();    // eTheta
-    x(2,0) = angular_vel.X(); // bWx
-    x(3,0) = angular_vel.Y(); // bWy
-    x(4,0) = angular_vel.Z(); // bWz
-    x(5,0) = linear_vel.X();  // bXdot
-    x(6,0) = linear_vel.Y();  // bYdot
-    x(7,0) = linear_vel.Z();  // bZdot
-    // std::cout  << "x:  " << x.transpose()  << " \n\n";
-
-	// Assign the model output
-    y(0,0) = linear_vel.X();  // bXdot
-    y(1,0) = linear_vel.Y();  // bYdot
-    y(2,0) = linear_vel.Z();  // bZdot
-    y(3,0) = angular_vel.Z(); // bWz
-    // std::cout  << "y:  " << y.transpose()  << " \n\n";
-
-	// Assign the model reference to be followed
-    r(0, 0) = b_cmd(0, 0);    // bXdot
-    r(1, 0) = b_cmd(1, 0);    // bYdot
-    r(2, 0) = b_cmd(2, 0);    // bZdot
-    r(3, 0) = cmd_rotZ;       // hZdot
-    // std::cout  << "r:  " << r.transpose()  << " \n\n";
-
-
-	// Error between the output and the reference (between the commanded velocity and the drone velocity)
-	e = y - r;
-    // std::cout  << "e:  " << e.transpose()  << " \n\n";
-
-	// Cumulative error
-    E = E + (e * interval);
-    // std::cout  << "E:  " << E.transpose()  << " \n\n";
-
-    if (E(0, 0) >  E_max)   E(0, 0) =  E_max;
-    if (E(0, 0) < -E_max)   E(0, 0) = -E_max;
-    if (E(1, 0) >  E_max)   E(1, 0) =  E_max;
-    if (E(1, 0) < -E_max)   E(1, 0) = -E_max;
-    if (E(2, 0) >  E_max)   E(2, 0) =  E_max;
-    if (E(2, 0) < -E_max)   E(2, 0) = -E_max;
-    if (E(3, 0) >  E_max)   E(3, 0) =  E_max;
-    if (E(3, 0) < -E_max)   E(3, 0) = -E_max;
-    // std::cout  << "E:  " << E.transpose()  << " \n\n";
+    navsim::VelocityCommand cmd;
+    cmd.on      = cmd_on;
+    cmd.vel     = Eigen::Vector3d(cmd_velX, cmd_velY, cmd_velZ);
+    cmd.yawRate = cmd_rotZ;
 
-    
-    // control del sistema dinamico
-    u = Hs - Kx * x - Ky * E;
-    // std::cout  << "u: " << u.transpose()  << " \n\n";
-   
-	// Saturating the rotors speed in case of exceeding the maximum or minimum rotations
-	if (u(0, 0) > w_max) u(0, 0) = w_max;
-	if (u(0, 0) < w_min) u(0, 0) = w_min;
-	if (u(1, 0) > w_max) u(1, 0) = w_max;
-	if (u(1, 0) < w_min) u(1, 0) = w_min;
-	if (u(2, 0) > w_max) u(2, 0) = w_max;
-	if (u(2, 0) < w_min) u(2, 0) = w_min;
-	if (u(3, 0) > w_max) u(3, 0) = w_max;
-	if (u(3, 0) < w_min) u(3, 0) = w_min;
-    // std::cout  << "u: " << u.transpose()  << " \n\n";
-
-
-    // Asignamos la rotación de los motores
-    w_rotor_NE = u(0, 0);
-    w_rotor_NW = u(1, 0);
-    w_rotor_SE = u(2, 0);
-    w_rotor_SW = u(3, 0);
+    controller.Update(GetState(), cmd, interval);
 
 }
 
@@ -810,61 +679,23 @@ void ServoControl()
 
 void PlatformDynamics()
 {
+    NAVSIM_PROFILE(navsim::Phase::PlatformDynamics);
+
     // Esta funcion traduce 
     // la velocidad de rotacion de los 4 motores
     // a fuerzas y torques del solido libre
 
-    // // con esto simulamos rotacion de sustentacion
-    // w_rotor_NE = w_hov;
-    // w_rotor_NW = w_rotor_NE;
-    // w_rotor_SE = w_rotor_NE;
-    // w_rotor_SW = w_rotor_NE;
-
-    // // con esto simulamos rotacion de giro
-    // w_rotor_NE = 411.9621;
-    // w_rotor_NW = 0;
-    // w_rotor_SE = 0;
-    // w_rotor_SW = 411.9621;
-
-
-	//Apply the thrust force to the drone
-    ignition::math::Vector3<double> FT_NE = ignition::math::Vector3<double>(0, 0, kFT * pow(w_rotor_NE, 2));
-    ignition::math::Vector3<double> FT_NW = ignition::math::Vector3<double>(0, 0, kFT * pow(w_rotor_NW, 2));
-    ignition::math::Vector3<double> FT_SE = ignition::math::Vector3<double>(0, 0, kFT * pow(w_rotor_SE, 2));
-    ignition::math::Vector3<double> FT_SW = ignition::math::Vector3<double>(0, 0, kFT * pow(w_rotor_SW, 2));
-    link->AddLinkForce(FT_NE, pos_NE);
-    link->AddLinkForce(FT_NW, pos_NW);
-    link->AddLinkForce(FT_SE, pos_SE);
-    link->AddLinkForce(FT_SW, pos_SW);
-
-
-	//Apply the drag moment to the drone
-    ignition::math::Vector3<double> MDR_NE = ignition::math::Vector3<double>(0, 0, kMDR * pow(w_rotor_NE, 2));
-    ignition::math::Vector3<double> MDR_NW = ignition::math::Vector3<double>(0, 0, kMDR * pow(w_rotor_NW, 2));
-    ignition::math::Vector3<double> MDR_SE = ignition::math::Vector3<double>(0, 0, kMDR * pow(w_rotor_SE, 2));
-    ignition::math::Vector3<double> MDR_SW = ignition::math::Vector3<double>(0, 0, kMDR * pow(w_rotor_SW, 2));
-    //    printf("MDR  = %.15f\n",MDR_NE.Z() - MDR_NW.Z() - MDR_SE.Z() + MDR_SW.Z());
-    link->AddRelativeTorque(MDR_NE - MDR_NW - MDR_SE + MDR_SW);
-
-
-	// Apply the air friction force to the drone
-    ignition::math::Vector3<double> linear_vel = model->RelativeLinearVel();
-    ignition::math::Vector3<double> FD = ignition::math::Vector3<double>(
-        -kFDx * linear_vel.X() * fabs(linear_vel.X()),
-        -kFDy * linear_vel.Y() * fabs(linear_vel.Y()),
-        -kFDz * linear_vel.Z() * fabs(linear_vel.Z()));
-    // printf("drone relative vel \nbZ  %.2f\n|Z| %.2f\nFDz %.2f \n\n",
-    //      linear_vel.Z(), fabs(linear_vel.Z()), -kFDz * linear_vel.Z() * fabs(linear_vel.Z()) );
-    link->AddLinkForce(FD, pos_CM);
-
-
-	// Apply the air friction moment to the drone
-    ignition::math::Vector3<double> angular_vel = model->RelativeAngularVel();
-    ignition::math::Vector3<double> MD = ignition::math::Vector3<double>(
-        -kMDx * angular_vel.X() * fabs(angular_vel.X()),
-        -kMDy * angular_vel.Y() * fabs(angular_vel.Y()),
-        -kMDz * angular_vel.Z() * fabs(angular_vel.Z()));
-    link->AddRelativeTorque(MD);
+    // Thrust, rotor moment and air friction (relative to the wind) in body axes. The
+    // center of mass is at the origin of the link, so r x FT of every rotor is in the torque.
+    Eigen::Vector3d wind = navsim::FleetRegistry::Instance().Wind(UAVname);
+    // ODE applies them explicitly: the drag is made linearly implicit for its step
+    double stepSize = model->GetWorld()->Physics()->GetMaxStepSize();
+    navsim::QuadrotorState state = GetState();
+    navsim::Wrench wrench = navsim::RotorWrench(params, state, controller.RotorSpeeds(), wind);
+    wrench = navsim::ImplicitDrag(params, state, wrench, stepSize, wind);
+
+    link->AddRelativeForce (ignition::math::Vector3d(wrench.force.x(),  wrench.force.y(),  wrench.force.z()));
+    link->AddRelativeTorque(ignition::math::Vector3d(wrench.torque.x(), wrench.torque.y(), wrench.torque.z()));
 
 }
 
@@ -873,6 +704,8 @@ void PlatformDynamics()
 
 void CheckROS()
 {
+    NAVSIM_PROFILE(navsim::Phase::CheckROS);
+
     
     // Check if the simulation was reset
     if (currentTime < prevRosCheckTime)
@@ -887,6 +720,7 @@ void CheckROS()
     prevRosCheckTime = currentTime;
 
     // ROS2 events proceessing
+    NAVSIM_TRACE("spin_some");
     rclcpp::spin_some(rosNode);
 
 }
@@ -896,6 +730,8 @@ void CheckROS()
 
 void Telemetry()
 {
+    NAVSIM_PROFILE(navsim::Phase::Telemetry);
+
     // printf("UAV Telemetry \n");
 
     // Check if the simulation was reset
@@ -10,6 +10,10 @@
 #include "navsim_msgs/msg/telemetry.hpp"
 #include "navsim_msgs/msg/remote_command.hpp"
 
+#include "navsim/CommandLatency.h"
+#include "navsim/MemoryAccount.h"
+#include "navsim/Profiler.h"
+
 
 
 namespace gazebo {
@@ -24,6 +28,11 @@ private:
 physics::ModelPtr    model;
 physics::LinkPtr     link;
 event::ConnectionPtr updateConnector;
+#if NAVSIM_ENABLE_PROFILING
+std::shared_ptr<navsim::UavTimes> updateTimes;   // of the world update (navsim/Profiler.h)
+#endif
+std::shared_ptr<navsim::UavLatency> commandLatency;   // (navsim/CommandLatency.h)
+navsim::MemoryAccount *memory = nullptr;              // (navsim/MemoryAccount.h)
 
 
 ////////////////////////////////////////////////////////////////////////
@@ -138,10 +147,28 @@ common::Time CommandExpTime;
 
 
 
+////////////////////////////////////////////////////////////////////////
+// Idle mode: a parked drone (at rest, rotors off, without command)
+// disables its body and skips control and dynamics until woken up
+
+bool   asleep = false;
+common::Time restSince = 0;       // idle and at rest since then
+double SleepDelay = 1.0;          // seconds at rest before sleeping
+double RestSpeed  = 0.05;         // m/s and rad/s
+
+
+
 ////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////
 
 public: 
+~UAM_minidrone_cmd()
+{
+    navsim::MemoryRegistry::Instance().Release(memory);
+}
+
+
+
 void Load(physics::ModelPtr _parent, sdf::ElementPtr /*_sdf*/)
 {
     // printf("DRONE CHALLENGE Drone plugin: loading\n");
@@ -149,7 +176,13 @@ void Load(physics::ModelPtr _parent, sdf::ElementPtr /*_sdf*/)
     // Get information from the model
     model = _parent;
     UAVname = model->GetName();
+    memory = navsim::MemoryRegistry::Instance().Spawn(UAVname, sizeof(*this));
+    navsim::MemoryScope memoryScope(memory);
     link = model->GetLink("dronelink");
+#if NAVSIM_ENABLE_PROFILING
+    updateTimes = navsim::Profiler::Instance().Uav(UAVname);
+#endif
+    commandLatency = navsim::LatencyMonitor::Instance().Uav(UAVname);
 
     // Periodic event
     updateConnector = event::Events::ConnectWorldUpdateBegin(
@@ -158,6 +191,7 @@ void Load(physics::ModelPtr _parent, sdf::ElementPtr /*_sdf*/)
     // ROS2
     if (rclcpp::ok()) 
     {
+        int64_t heap = navsim::ProcessMemory::Sample().heap;
         rosNode = rclcpp::Node::make_shared(this->UAVname);
 
         rosPub_Telemetry = rosNode->create_publisher<navsim_msgs::msg::Telemetry>(
@@ -166,15 +200,17 @@ void Load(physics::ModelPtr _parent, sdf::ElementPtr /*_sdf*/)
         rosSub_RemoteCommand = rosNode->create_subscription<navsim_msgs::msg::RemoteCommand>(
             "/NavSim/" + UAVname + "/RemoteCommand", 10,
             std::bind(&UAM_minidrone_cmd::rosTopFn_RemoteCommand, this, 
-                    std::placeholders::_1));
+                    std::placeholders::_1, std::placeholders::_2));
             
     
+        memory->Set(navsim::MemoryCategory::Ros, navsim::ProcessMemory::Sample().heap - heap);
     }
     else
     {   
         std::cout << "\x1B[2J\x1B[H";       // Clear screen
         printf("\nERROR: NavSim world plugin is not running ROS2!\n\n");
     }
+    navsim::MemoryRegistry::Instance().Spawned();
 
 
     //Initial control matrices
@@ -231,14 +267,21 @@ void Init()
 
 void OnWorldUpdateBegin()
 {
+    NAVSIM_PROFILE_UAV(updateTimes.get());
+    navsim::MemoryScope memoryScope(memory);
+
     // Clear screen
     // std::cout << "\x1B[2J\x1B[H";
     // printf("DCdrone plugin: OnWorldUpdateBegin\n");
     
     
-    // Platform low level control
-    ServoControl();
-    PlatformDynamics();
+    // A parked drone only keeps its telemetry and its subscription
+    if (!Sleep())
+    {
+        // Platform low level control
+        ServoControl();
+        PlatformDynamics();
+    }
 
     // Telemetry communication
     Telemetry();
@@ -251,8 +294,59 @@ void OnWorldUpdateBegin()
     
 
 
-void rosTopFn_RemoteCommand(const std::shared_ptr<navsim_msgs::msg::RemoteCommand> msg)
+// Returns true while the drone is parked and asleep
+bool Sleep()
+{
+    common::Time currentTime = model->GetWorld()->SimTime();
+
+    if (asleep)
+    {
+        // ODE enables the body again on a contact with another body
+        if (!link->GetEnabled() && currentTime >= restSince) return true;
+
+        WakeUp();
+        return false;
+    }
+
+    bool idle = !cmd_on && !rotors_on
+             && model->WorldLinearVel().Length()  < RestSpeed
+             && model->WorldAngularVel().Length() < RestSpeed;
+
+    // Busy, moving, or the simulation was reset
+    if (!idle || currentTime < restSince)
+    {
+        restSince = currentTime;
+        return false;
+    }
+
+    if ((currentTime - restSince).Double() < SleepDelay) return false;
+
+    link->SetEnabled(false);
+    asleep = true;
+    return true;
+}
+
+
+
+
+void WakeUp()
+{
+    if (!asleep) return;
+
+    asleep = false;
+    restSince = model->GetWorld()->SimTime();
+    link->SetEnabled(true);
+}
+
+
+
+
+void rosTopFn_RemoteCommand(const std::shared_ptr<navsim_msgs::msg::RemoteCommand> msg,
+                            const rclcpp::MessageInfo &info)
 {
+    NAVSIM_TRACE(__func__);
+    commandLatency->Dequeued(navsim::MakeStamps(msg->stamp_wall, msg->stamp_sim, info,
+                                                model->GetWorld()->SimTime().Double()));
     // printf("DCdrone: data received in topic Remote Pilot\n");
     // printf("Received RemoteCommand: uav=%s, on=%d, cmd=[%f, %f, %f, %f], duration=(%d, %d)\n",
     //        msg->uav_id.c_str(), 
@@ -262,6 +356,7 @@ void rosTopFn_RemoteCommand(const std::shared_ptr<navsim_msgs::msg::RemoteComman
     //        msg->duration.sec, msg->duration.nanosec);
     
     // This function listen and follow remote commands
+    WakeUp();
     cmd_on   =  msg->on;
     cmd_velX =  msg->vel.linear.x;
     cmd_velY =  msg->vel.linear.y;
@@ -345,6 +440,9 @@ void rotorsOff()
 
 void ServoControl()
 {
+    NAVSIM_PROFILE(navsim::Phase::ServoControl);
+    commandLatency->Applied(model->GetWorld()->SimTime().Double());
+
     // This fucntion converts 
     // a navigation command (desired velocity vector and rotation)
     // to speeds ot the for rotors
@@ -496,6 +594,8 @@ void ServoControl()
 
 void PlatformDynamics()
 {
+    NAVSIM_PROFILE(navsim::Phase::PlatformDynamics);
+
     // Esta funcion traduce 
     // la velocidad de rotacion de los 4 motores
     // a fuerzas y torques del solido libre
@@ -552,6 +652,32 @@ void PlatformDynamics()
         -kMDz * angular_vel.Z() * fabs(angular_vel.Z()));
     link->AddRelativeTorque(MD);
 
+
+	// ODE applies these forces explicitly, and with a coarse max_step_size the
+	// quadratic drag overshoots its equilibrium and diverges. Correct them so
+	// the step is linearly implicit in the drag: the net force and moment per
+	// body axis divided by 1 + dt * dDrag/dv (as navsim::ImplicitDrag).
+    double dt = model->GetWorld()->Physics()->GetMaxStepSize();
+    physics::InertialPtr inertial = link->GetInertial();
+    ignition::math::Vector3<double> I(inertial->IXX(), inertial->IYY(), inertial->IZZ());
+    ignition::math::Vector3<double> G = inertial->Mass() *
+        link->WorldPose().Rot().RotateVectorReverse(model->GetWorld()->Gravity());
+
+    ignition::math::Vector3<double> F = FT_NE + FT_NW + FT_SE + FT_SW + FD + G;
+    ignition::math::Vector3<double> M = pos_NE.Cross(FT_NE) + pos_NW.Cross(FT_NW) + pos_SE.Cross(FT_SE) + pos_SW.Cross(FT_SW)
+                                      + MDR_NE - MDR_NW - MDR_SE + MDR_SW + MD - angular_vel.Cross(I * angular_vel);
+
+    ignition::math::Vector3<double> linear(
+        1 + 2 * dt / inertial->Mass() * kFDx * fabs(linear_vel.X()),
+        1 + 2 * dt / inertial->Mass() * kFDy * fabs(linear_vel.Y()),
+        1 + 2 * dt / inertial->Mass() * kFDz * fabs(linear_vel.Z()));
+    ignition::math::Vector3<double> angular(
+        1 + 2 * dt * kMDx * fabs(angular_vel.X()) / I.X(),
+        1 + 2 * dt * kMDy * fabs(angular_vel.Y()) / I.Y(),
+        1 + 2 * dt * kMDz * fabs(angular_vel.Z()) / I.Z());
+    link->AddRelativeForce (F / linear  - F);
+    link->AddRelativeTorque(M / angular - M);
+
 }
 
 
@@ -559,6 +685,8 @@ void PlatformDynamics()
 
 void CheckSubs()
 {
+    NAVSIM_PROFILE(navsim::Phase::CheckROS);
+
     
     // Check if the simulation was reset
     common::Time currentTime = model->GetWorld()->SimTime();
@@ -575,6 +703,7 @@ void CheckSubs()
     prevCommandCheckTime = currentTime;
 
     // ROS2 events proceessing
+    NAVSIM_TRACE("spin_some");
     rclcpp::spin_some(rosNode);
 
 }
@@ -584,6 +713,8 @@ void CheckSubs()
 
 void Telemetry()
 {
+    NAVSIM_PROFILE(navsim::Phase::Telemetry);
+
     // printf("UAV Telemetry \n");
 
     // Check if the simulation was reset
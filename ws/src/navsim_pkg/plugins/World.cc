@@ -1,10 +1,52 @@
 #include "gazebo/gazebo.hh"
 #include "gazebo/physics/physics.hh"
 
+#include <chrono>
+#include <cstdlib>
+#include <map>
+#include <queue>
+#include <vector>
+
 #include "rclcpp/rclcpp/rclcpp.hpp"
 #include "navsim_msgs/srv/sim_control.hpp"
 #include "navsim_msgs/srv/deploy_model.hpp"
 #include "navsim_msgs/srv/remove_model.hpp"
+#include "navsim_msgs/srv/set_sim_alarm.hpp"
+#include "navsim_msgs/msg/sim_alarm.hpp"
+#include "navsim_msgs/msg/clock_stats.hpp"
+#include "navsim_msgs/srv/check_conflicts.hpp"
+#include "navsim_msgs/msg/separation_event.hpp"
+#include "navsim_msgs/srv/validate_flight_plan.hpp"
+#include "navsim_msgs/srv/add_geofence.hpp"
+#include "navsim_msgs/srv/remove_geofence.hpp"
+#include "navsim_msgs/srv/list_geofences.hpp"
+#include "navsim_msgs/msg/geofence_event.hpp"
+#include "navsim_msgs/srv/reserve_airspace.hpp"
+#include "navsim_msgs/msg/navigation_report.hpp"
+#include "navsim_msgs/srv/plan_flights.hpp"
+#include "navsim_msgs/srv/check_feasibility.hpp"
+#include "navsim_msgs/msg/predicted_conflict.hpp"
+#include "navsim_msgs/msg/occupancy_map.hpp"
+#include "navsim_msgs/msg/sim_stats.hpp"
+#include "navsim_msgs/srv/save_trace.hpp"
+#include "navsim_msgs/msg/command_latency.hpp"
+#include "navsim_msgs/srv/memory_report.hpp"
+
+#include "navsim/ConflictDetector.h"
+#include "navsim/SpatialHash.h"
+#include "navsim/ObstacleBVH.h"
+#include "navsim/GeofenceEngine.h"
+#include "navsim/ReservationTable.h"
+#include "navsim/PathPlanner.h"
+#include "navsim/FeasibilityChecker.h"
+#include "navsim/FleetRegistry.h"
+#include "navsim/ConflictProbe.h"
+#include "navsim/OccupancyMap.h"
+#include "navsim/core/WindField.h"
+#include "navsim/CollisionCuller.h"
+#include "navsim/Profiler.h"
+#include "navsim/CommandLatency.h"
+#include "navsim/MemoryAccount.h"
 // #include "navsim/teletransport.h"
 
 
@@ -26,7 +68,30 @@ rclcpp::Node::SharedPtr rosNode;
 // ROS2 NAVSIM topics
 rclcpp::Publisher<builtin_interfaces::msg::Time>::SharedPtr rosPub_SimTime;
 common::Time prevTimePubTime;
-double TimePubPeriod = 0.1;    // seconds
+double TimePubPeriod = 0.1;    // seconds (SDF <time_pub_period>)
+
+// Pacing: wall-clock time elapsed between two time broadcasts
+rclcpp::Publisher<navsim_msgs::msg::ClockStats>::SharedPtr rosPub_ClockStats;
+std::chrono::steady_clock::time_point prevTimePubWall;
+
+// Sim-time alarms: each registered deadline is notified exactly once
+struct SimAlarm
+{
+    common::Time deadline;
+    uint32_t     id;
+    std::string  client;
+};
+struct SimAlarmLater
+{
+    bool operator()(const SimAlarm &a, const SimAlarm &b) const
+    {
+        if (a.deadline == b.deadline) return a.id > b.id;
+        return a.deadline > b.deadline;
+    }
+};
+std::priority_queue<SimAlarm, std::vector<SimAlarm>, SimAlarmLater> alarms;
+uint32_t nextAlarmId = 1;
+rclcpp::Publisher<navsim_msgs::msg::SimAlarm>::SharedPtr rosPub_SimAlarm;
 
 
 // ROS2 NAVSIM services
@@ -34,13 +99,155 @@ double TimePubPeriod = 0.1;    // seconds
 rclcpp::Service<navsim_msgs::srv::SimControl>::SharedPtr  rosSrv_SimControl;
 rclcpp::Service<navsim_msgs::srv::DeployModel>::SharedPtr rosSrv_DeployModel;
 rclcpp::Service<navsim_msgs::srv::RemoveModel>::SharedPtr rosSrv_RemoveModel;
+rclcpp::Service<navsim_msgs::srv::SetSimAlarm>::SharedPtr rosSrv_SetSimAlarm;
+rclcpp::Service<navsim_msgs::srv::CheckConflicts>::SharedPtr rosSrv_CheckConflicts;
+rclcpp::Service<navsim_msgs::srv::ValidateFlightPlan>::SharedPtr rosSrv_ValidateFlightPlan;
+rclcpp::Service<navsim_msgs::srv::AddGeofence>::SharedPtr    rosSrv_AddGeofence;
+rclcpp::Service<navsim_msgs::srv::RemoveGeofence>::SharedPtr rosSrv_RemoveGeofence;
+rclcpp::Service<navsim_msgs::srv::ListGeofences>::SharedPtr  rosSrv_ListGeofences;
+rclcpp::Service<navsim_msgs::srv::ReserveAirspace>::SharedPtr rosSrv_ReserveAirspace;
+rclcpp::Service<navsim_msgs::srv::PlanFlights>::SharedPtr     rosSrv_PlanFlights;
+rclcpp::Service<navsim_msgs::srv::CheckFeasibility>::SharedPtr rosSrv_CheckFeasibility;
+rclcpp::Service<navsim_msgs::srv::SaveTrace>::SharedPtr        rosSrv_SaveTrace;
+rclcpp::Service<navsim_msgs::srv::MemoryReport>::SharedPtr     rosSrv_MemoryReport;
 common::Time prevRosCheckTime;
 double RosCheckPeriod = 0.1;   // seconds
 
 
+// Strategic conflict detection (stored flight plans)
+std::unique_ptr<navsim::ConflictDetector> conflictDetector;
+
+
+// Live UAVs (collected at most once per step)
+common::Time uavUpdateTime = -1;
+std::vector<physics::ModelPtr> uavModels;
+std::vector<std::string>       uavNames;
+std::vector<Eigen::Vector3d>   uavPositions;
+std::vector<Eigen::Vector3d>   uavVelocities;
+
+
+// Tactical separation monitor (live UAV positions)
+rclcpp::Publisher<navsim_msgs::msg::SeparationEvent>::SharedPtr rosPub_Separation;
+common::Time prevSeparationTime;
+double SeparationPeriod    = 0.1;    // seconds (SDF <separation_period>)
+double SeparationThreshold = 5.0;    // meters  (SDF <separation_threshold>)
+
+navsim::SpatialHash uavHash;
+
+
+// Geofences
+std::unique_ptr<navsim::GeofenceEngine> geofences;
+rclcpp::Publisher<navsim_msgs::msg::GeofenceEvent>::SharedPtr rosPub_GeofenceEvent;
+common::Time prevGeofenceTime;
+double GeofencePeriod = 0.1;         // seconds (SDF <geofence_period>)
+
+
+// Intent-based conflict probe (active flight plans from the FleetRegistry)
+navsim::ConflictProbe probe;
+rclcpp::Publisher<navsim_msgs::msg::PredictedConflict>::SharedPtr rosPub_ConflictProbe;
+common::Time prevProbeTime;
+double ProbePeriod = 1.0;            // seconds (SDF <probe_period>)
+
+
+// Airspace occupancy and density (updated as UAVs change cells)
+std::unique_ptr<navsim::OccupancyMap> occupancy;
+rclcpp::Publisher<navsim_msgs::msg::OccupancyMap>::SharedPtr rosPub_Occupancy;
+common::Time prevOccupancyTime;
+common::Time prevOccupancyPubTime;
+double OccupancyPeriod    = 0.1;     // seconds (SDF <occupancy_period>)
+double OccupancyPubPeriod = 1.0;     // seconds (SDF <occupancy_pub_period>)
+
+
+// 4D airspace reservations (released on NavigationReport or time expiry)
+std::unique_ptr<navsim::ReservationTable> reservations;
+std::map<std::string, rclcpp::Subscription<navsim_msgs::msg::NavigationReport>::SharedPtr> rosSub_NavReports;
+common::Time prevReservationTime;
+
+
+// Static obstacles (rebuilt when the set of models changes)
+navsim::ObstacleBVH obstacles;
+unsigned int obstaclesModelCount = 0;
+
+
+// Batch flight planner (voxelized obstacles)
+double PlannerCellSize = 5;      // meters  (SDF <planner_cell_size>)
+double PlannerCeiling  = 120;    // meters  (SDF <planner_ceiling>)
+int    PlannerThreads  = 0;      // 0: one per hardware thread (SDF <planner_threads>)
+
+
+// Flight plan screening against the airframe limits
+std::unique_ptr<navsim::FeasibilityChecker> feasibility;
+
+
+// Wind field (mean grid over the obstacles plus turbulence), sampled at the UAVs
+std::shared_ptr<navsim::WindGrid>  windGrid;
+std::unique_ptr<navsim::WindField> wind;
+navsim::WindProfile      windProfile;
+navsim::TurbulenceParams windTurbulence;
+std::string  WindFile;                    // mean grid file, instead of the profile (SDF <wind_file>)
+double WindCellSize = 10;                 // meters  (SDF <wind_cell_size>)
+double WindPeriod   = 0.01;               // seconds (SDF <wind_period>)
+size_t windObstacles = 0;                 // obstacles of the mean grid
+common::Time prevWindTime;
+common::Time prevWindGridTime;
+std::vector<double> windX, windY, windZ, windU, windV, windW;
+std::vector<Eigen::Vector3d> uavWinds;
+
+
+// UAV-UAV contacts only within clusters of close UAVs (collide bitmasks)
+navsim::CollisionCuller culler;
+std::map<uint32_t, uint32_t> uavCollideBits;   // bits set on each UAV model (by id)
+common::Time prevCullingTime;
+bool   CollisionCulling = true;      // (SDF <collision_culling>)
+double CullingPeriod    = 0.05;      // seconds (SDF <collision_period>)
+double CullingRadius    = 2.0;       // meters  (SDF <collision_radius>)
+
+
+// Level of detail: UAVs far from other UAVs, obstacles and geofences are flagged
+// in the FleetRegistry, and may fly a kinematic model while cruising
+bool   KinematicLOD = false;         // (SDF <kinematic_lod>)
+double LodPeriod    = 0.5;           // seconds (SDF <lod_period>)
+double LodRadius    = 100;           // meters  (SDF <lod_radius>)
+common::Time prevLodTime;
+navsim::SpatialHash lodHash;
+std::vector<bool>   uavKinematic;
+
+
+// Timing of the world update of the plugins (navsim/Profiler.h): the phase
+// histograms count since the start, the ones of the period are the difference
+rclcpp::Publisher<navsim_msgs::msg::SimStats>::SharedPtr rosPub_Stats;
+common::Time prevStatsTime;
+double StatsPeriod   = 1.0;          // seconds (SDF <stats_period>)
+int    StatsOutliers = 10;           // UAVs    (SDF <stats_outliers>)
+std::vector<uint64_t> statsCounts[int(navsim::Phase::Count)];
+std::map<std::string, std::pair<uint64_t, uint64_t>> statsUavs;   // updates and their ticks
+
+
+// Latency of the commands and plans to the drones (navsim/CommandLatency.h)
+rclcpp::Publisher<navsim_msgs::msg::CommandLatency>::SharedPtr rosPub_Latency;
+common::Time prevLatencyTime;
+double LatencyPeriod = 5.0;          // seconds (SDF <latency_period>)
+
+
+// Trace of the simulation loop (navsim/Tracer.h), off unless a file is given
+// by the SDF or the environment variable NAVSIM_TRACE
+std::string TraceFile;                    // (SDF <trace_file>)
+int         TraceCapacity = 1 << 16;      // events per thread (SDF <trace_capacity>)
+
+
 public:
 
-void Load(physics::WorldPtr _parent, sdf::ElementPtr /*_sdf*/)
+~World()
+{
+    // The trace is saved here, once the world no longer updates
+    navsim::Tracer &tracer = navsim::Tracer::Instance();
+    if (tracer.Enabled() && !tracer.Path().empty())
+        tracer.Save(tracer.Path());
+}
+
+
+
+void Load(physics::WorldPtr _parent, sdf::ElementPtr _sdf)
 {
     // gzmsg << "NAVSIM World plugin: loading" << std::endl;
     // printf("NAVSIM World plugin: loading\n");
@@ -50,6 +257,143 @@ void Load(physics::WorldPtr _parent, sdf::ElementPtr /*_sdf*/)
     world = _parent;
 
 
+    // Plugin parameters
+    if (_sdf->HasElement("time_pub_period"))
+        TimePubPeriod = _sdf->Get<double>("time_pub_period");
+    if (_sdf->HasElement("ros_check_period"))
+        RosCheckPeriod = _sdf->Get<double>("ros_check_period");
+
+    // Conflict detection grid: cell size [m] and time slice [s]
+    double conflictCellXY = 50, conflictCellZ = 50, conflictTimeSlice = 10;
+    if (_sdf->HasElement("conflict_cell_size"))
+        conflictCellXY = _sdf->Get<double>("conflict_cell_size");
+    if (_sdf->HasElement("conflict_cell_height"))
+        conflictCellZ = _sdf->Get<double>("conflict_cell_height");
+    if (_sdf->HasElement("conflict_time_slice"))
+        conflictTimeSlice = _sdf->Get<double>("conflict_time_slice");
+    conflictDetector = std::make_unique<navsim::ConflictDetector>(
+        conflictCellXY, conflictCellZ, conflictTimeSlice);
+
+    if (_sdf->HasElement("separation_period"))
+        SeparationPeriod = _sdf->Get<double>("separation_period");
+    if (_sdf->HasElement("separation_threshold"))
+        SeparationThreshold = _sdf->Get<double>("separation_threshold");
+
+    double geofenceCellSize = 50;
+    if (_sdf->HasElement("geofence_period"))
+        GeofencePeriod = _sdf->Get<double>("geofence_period");
+    if (_sdf->HasElement("geofence_cell_size"))
+        geofenceCellSize = _sdf->Get<double>("geofence_cell_size");
+    geofences = std::make_unique<navsim::GeofenceEngine>(geofenceCellSize);
+
+    if (_sdf->HasElement("probe_period"))
+        ProbePeriod = _sdf->Get<double>("probe_period");
+    if (_sdf->HasElement("probe_horizon"))
+        probe.horizon = _sdf->Get<double>("probe_horizon");
+    if (_sdf->HasElement("probe_step"))
+        probe.step = _sdf->Get<double>("probe_step");
+    if (_sdf->HasElement("probe_blend_time"))
+        probe.blendTime = _sdf->Get<double>("probe_blend_time");
+
+    // Occupancy cells of 5m, with a window of 6 x 10s by default
+    double occupancyCellSize = 5, occupancyBucketPeriod = 10;
+    int occupancyBuckets = 6;
+    if (_sdf->HasElement("occupancy_period"))
+        OccupancyPeriod = _sdf->Get<double>("occupancy_period");
+    if (_sdf->HasElement("occupancy_pub_period"))
+        OccupancyPubPeriod = _sdf->Get<double>("occupancy_pub_period");
+    if (_sdf->HasElement("occupancy_cell_size"))
+        occupancyCellSize = _sdf->Get<double>("occupancy_cell_size");
+    if (_sdf->HasElement("occupancy_bucket_period"))
+        occupancyBucketPeriod = _sdf->Get<double>("occupancy_bucket_period");
+    if (_sdf->HasElement("occupancy_buckets"))
+        occupancyBuckets = _sdf->Get<int>("occupancy_buckets");
+    occupancy = std::make_unique<navsim::OccupancyMap>(
+        occupancyCellSize, occupancyBucketPeriod, occupancyBuckets);
+
+    // Reservation cells: 10m x 10m x 5m x 1s by default
+    double reservationCellXY = 10, reservationCellZ = 5, reservationTimeSlice = 1;
+    if (_sdf->HasElement("reservation_cell_size"))
+        reservationCellXY = _sdf->Get<double>("reservation_cell_size");
+    if (_sdf->HasElement("reservation_cell_height"))
+        reservationCellZ = _sdf->Get<double>("reservation_cell_height");
+    if (_sdf->HasElement("reservation_time_slice"))
+        reservationTimeSlice = _sdf->Get<double>("reservation_time_slice");
+    reservations = std::make_unique<navsim::ReservationTable>(
+        reservationCellXY, reservationCellZ, reservationTimeSlice);
+
+    if (_sdf->HasElement("planner_cell_size"))
+        PlannerCellSize = _sdf->Get<double>("planner_cell_size");
+    if (_sdf->HasElement("planner_ceiling"))
+        PlannerCeiling = _sdf->Get<double>("planner_ceiling");
+    if (_sdf->HasElement("planner_threads"))
+        PlannerThreads = _sdf->Get<int>("planner_threads");
+    if (PlannerThreads <= 0)
+        PlannerThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    // Horizontal limits of the minidrone for a maximum tilt (rad)
+    double feasibilityMaxTilt = 0.5;
+    if (_sdf->HasElement("feasibility_max_tilt"))
+        feasibilityMaxTilt = _sdf->Get<double>("feasibility_max_tilt");
+    feasibility = std::make_unique<navsim::FeasibilityChecker>(navsim::MinidroneLimits(feasibilityMaxTilt));
+
+    // Wind: speed at the reference height (m/s), direction it blows to (rad), turbulence (m/s)
+    if (_sdf->HasElement("wind_speed"))
+        windProfile.speed = _sdf->Get<double>("wind_speed");
+    if (_sdf->HasElement("wind_direction"))
+        windProfile.direction = _sdf->Get<double>("wind_direction");
+    if (_sdf->HasElement("wind_ref_height"))
+        windProfile.refHeight = _sdf->Get<double>("wind_ref_height");
+    if (_sdf->HasElement("wind_shear"))
+        windProfile.shear = _sdf->Get<double>("wind_shear");
+    if (_sdf->HasElement("wind_file"))
+        WindFile = _sdf->Get<std::string>("wind_file");
+    if (_sdf->HasElement("wind_cell_size"))
+        WindCellSize = _sdf->Get<double>("wind_cell_size");
+    if (_sdf->HasElement("wind_period"))
+        WindPeriod = _sdf->Get<double>("wind_period");
+    if (_sdf->HasElement("turbulence_intensity"))
+        windTurbulence.intensity = _sdf->Get<double>("turbulence_intensity");
+    if (_sdf->HasElement("turbulence_length"))
+        windTurbulence.lengthScale = _sdf->Get<double>("turbulence_length");
+
+    if (_sdf->HasElement("collision_culling"))
+        CollisionCulling = _sdf->Get<bool>("collision_culling");
+    if (_sdf->HasElement("collision_period"))
+        CullingPeriod = _sdf->Get<double>("collision_period");
+    if (_sdf->HasElement("collision_radius"))
+        CullingRadius = _sdf->Get<double>("collision_radius");
+
+    if (_sdf->HasElement("kinematic_lod"))
+        KinematicLOD = _sdf->Get<bool>("kinematic_lod");
+    if (_sdf->HasElement("lod_period"))
+        LodPeriod = _sdf->Get<double>("lod_period");
+    if (_sdf->HasElement("lod_radius"))
+        LodRadius = _sdf->Get<double>("lod_radius");
+
+    if (_sdf->HasElement("stats_period"))
+        StatsPeriod = _sdf->Get<double>("stats_period");
+    if (_sdf->HasElement("stats_outliers"))
+        StatsOutliers = _sdf->Get<int>("stats_outliers");
+
+    if (_sdf->HasElement("latency_period"))
+        LatencyPeriod = _sdf->Get<double>("latency_period");
+
+    if (_sdf->HasElement("trace_file"))
+        TraceFile = _sdf->Get<std::string>("trace_file");
+    if (_sdf->HasElement("trace_capacity"))
+        TraceCapacity = _sdf->Get<int>("trace_capacity");
+    if (const char *env = std::getenv("NAVSIM_TRACE"))
+        TraceFile = env;
+#if NAVSIM_ENABLE_PROFILING
+    if (!TraceFile.empty())
+    {
+        navsim::Tracer::Instance().Enable(TraceFile, std::max(TraceCapacity, 1));
+        printf("NAVSIM World plugin: tracing to %s\n", TraceFile.c_str());
+    }
+#endif
+
+
     // Periodic event
     updateConnector = event::Events::ConnectWorldUpdateBegin(
         std::bind(&World::OnWorldUpdateBegin, this));  
@@ -68,6 +412,30 @@ void Load(physics::WorldPtr _parent, sdf::ElementPtr /*_sdf*/)
     rosPub_SimTime  = rosNode->create_publisher<builtin_interfaces::msg::Time>(
         "NavSim/Time", 1);
 
+    rosPub_ClockStats = rosNode->create_publisher<navsim_msgs::msg::ClockStats>(
+        "NavSim/ClockStats", 1);
+
+    rosPub_SimAlarm = rosNode->create_publisher<navsim_msgs::msg::SimAlarm>(
+        "NavSim/Alarm", 100);
+
+    rosPub_Separation = rosNode->create_publisher<navsim_msgs::msg::SeparationEvent>(
+        "NavSim/Separation", 100);
+
+    rosPub_GeofenceEvent = rosNode->create_publisher<navsim_msgs::msg::GeofenceEvent>(
+        "NavSim/GeofenceEvents", 100);
+
+    rosPub_ConflictProbe = rosNode->create_publisher<navsim_msgs::msg::PredictedConflict>(
+        "NavSim/ConflictProbe", 100);
+
+    rosPub_Occupancy = rosNode->create_publisher<navsim_msgs::msg::OccupancyMap>(
+        "NavSim/Occupancy", 10);
+
+    rosPub_Stats = rosNode->create_publisher<navsim_msgs::msg::SimStats>(
+        "NavSim/Stats", 10);
+
+    rosPub_Latency = rosNode->create_publisher<navsim_msgs::msg::CommandLatency>(
+        "NavSim/CommandLatency", 10);
+
 
     // ROS2 NAVSIM services
 
@@ -86,6 +454,61 @@ void Load(physics::WorldPtr _parent, sdf::ElementPtr /*_sdf*/)
         std::bind(&World::rosSrvFn_RemoveModel, this,
                 std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
 
+    rosSrv_SetSimAlarm = rosNode->create_service<navsim_msgs::srv::SetSimAlarm>(
+        "NavSim/SetSimAlarm",
+        std::bind(&World::rosSrvFn_SetSimAlarm, this,
+                std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+
+    rosSrv_CheckConflicts = rosNode->create_service<navsim_msgs::srv::CheckConflicts>(
+        "NavSim/CheckConflicts",
+        std::bind(&World::rosSrvFn_CheckConflicts, this,
+                std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+
+    rosSrv_ValidateFlightPlan = rosNode->create_service<navsim_msgs::srv::ValidateFlightPlan>(
+        "NavSim/ValidateFlightPlan",
+        std::bind(&World::rosSrvFn_ValidateFlightPlan, this,
+                std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+
+    rosSrv_AddGeofence = rosNode->create_service<navsim_msgs::srv::AddGeofence>(
+        "NavSim/AddGeofence",
+        std::bind(&World::rosSrvFn_AddGeofence, this,
+                std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+
+    rosSrv_RemoveGeofence = rosNode->create_service<navsim_msgs::srv::RemoveGeofence>(
+        "NavSim/RemoveGeofence",
+        std::bind(&World::rosSrvFn_RemoveGeofence, this,
+                std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+
+    rosSrv_ListGeofences = rosNode->create_service<navsim_msgs::srv::ListGeofences>(
+        "NavSim/ListGeofences",
+        std::bind(&World::rosSrvFn_ListGeofences, this,
+                std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+
+    rosSrv_ReserveAirspace = rosNode->create_service<navsim_msgs::srv::ReserveAirspace>(
+        "NavSim/ReserveAirspace",
+        std::bind(&World::rosSrvFn_ReserveAirspace, this,
+                std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+
+    rosSrv_PlanFlights = rosNode->create_service<navsim_msgs::srv::PlanFlights>(
+        "NavSim/PlanFlights",
+        std::bind(&World::rosSrvFn_PlanFlights, this,
+                std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+
+    rosSrv_CheckFeasibility = rosNode->create_service<navsim_msgs::srv::CheckFeasibility>(
+        "NavSim/CheckFeasibility",
+        std::bind(&World::rosSrvFn_CheckFeasibility, this,
+                std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+
+    rosSrv_SaveTrace = rosNode->create_service<navsim_msgs::srv::SaveTrace>(
+        "NavSim/SaveTrace",
+        std::bind(&World::rosSrvFn_SaveTrace, this,
+                std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+
+    rosSrv_MemoryReport = rosNode->create_service<navsim_msgs::srv::MemoryReport>(
+        "NavSim/MemoryReport",
+        std::bind(&World::rosSrvFn_MemoryReport, this,
+                std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+
 
     //  printf("NAVSIM World plugin: loaded\n");
 
@@ -99,6 +522,19 @@ void Init()
     currentTime = world->SimTime();
     prevTimePubTime  = currentTime;
     prevRosCheckTime = currentTime;
+    prevTimePubWall  = std::chrono::steady_clock::now();
+    prevSeparationTime = currentTime;
+    prevGeofenceTime   = currentTime;
+    prevProbeTime      = currentTime;
+    prevOccupancyTime    = currentTime;
+    prevOccupancyPubTime = currentTime;
+    prevReservationTime = currentTime;
+    prevWindTime        = currentTime;
+    prevWindGridTime    = currentTime;
+    prevCullingTime     = currentTime;
+    prevLodTime         = currentTime;
+    prevStatsTime       = currentTime;
+    prevLatencyTime     = currentTime;
 
 
 }
@@ -109,8 +545,42 @@ void OnWorldUpdateBegin()
 {
     // printf("NAVSIM World plugin: OnWorldUpdateBegin\n");
 
+    NAVSIM_TRACE("WorldUpdate");
     currentTime = world->SimTime();
+    navsim::Tracer::Instance().SetSimTime(currentTime.Double());
+    navsim::MemoryRegistry::Instance().Settle();
     TimeBroadcast();
+    CheckAlarms();
+
+    // Tactical loss of separation
+    SeparationMonitor();
+
+    // Geofence intrusions
+    GeofenceMonitor();
+
+    // Predicted losses of separation
+    ProbeConflicts();
+
+    // Airspace density
+    OccupancyMonitor();
+
+    // Past airspace reservations
+    ReservationExpiry();
+
+    // Wind at the UAVs
+    WindUpdate();
+
+    // UAV-UAV contacts for the next physics steps
+    CullCollisions();
+
+    // UAVs that may fly the kinematic model
+    LodMonitor();
+
+    // Timing of the plugins
+    StatsMonitor();
+
+    // Latency of the commands and plans
+    LatencyMonitor();
 
     // ROS2 events proceessing
     CheckROS();
@@ -120,6 +590,7 @@ void OnWorldUpdateBegin()
 
 void CheckROS()
 {
+    NAVSIM_PROFILE(navsim::Phase::WorldCheckROS);
     
     // Check if the simulation was reset
     if (currentTime < prevRosCheckTime)
@@ -131,6 +602,7 @@ void CheckROS()
     prevRosCheckTime = currentTime;
 
     // ROS2 events proceessing
+    NAVSIM_TRACE("spin_some");
     rclcpp::spin_some(rosNode);
 
 }
@@ -143,6 +615,7 @@ void rosSrvFn_SimControl(
     const std::shared_ptr<navsim_msgs::srv::SimControl::Request>  request,   
           std::shared_ptr<navsim_msgs::srv::SimControl::Response> response)  
 {
+    NAVSIM_TRACE(__func__);
     // printf("NAVSIM World plugin: Service SimControl called\n");
 
     if (request->reset)
@@ -172,6 +645,7 @@ void rosSrvFn_DeployModel(
     const std::shared_ptr<navsim_msgs::srv::DeployModel::Request>  request,   
           std::shared_ptr<navsim_msgs::srv::DeployModel::Response> response)  
 {
+    NAVSIM_TRACE(__func__);
     // printf("NAVSIM World plugin: DeployModel\n");
 
     // printf("Model SDF:  %s\n", request->model_sdf.c_str());
@@ -244,6 +718,7 @@ void rosSrvFn_DeployModel(
 
     // Insert the model in the world
     // this->world->InsertModelString(model);
+    navsim::MemoryRegistry::Instance().Expect();
     world->InsertModelSDF(modelSDF);
     
 
@@ -266,6 +741,7 @@ void rosSrvFn_RemoveModel(
     const std::shared_ptr<navsim_msgs::srv::RemoveModel::Request>  request,   
           std::shared_ptr<navsim_msgs::srv::RemoveModel::Response> response)  
 {
+    NAVSIM_TRACE(__func__);
     // printf("NAVSIM World plugin: RemoveModel\n");
     physics::ModelPtr model = this->world->ModelByName(request->name);
 
@@ -283,8 +759,906 @@ void rosSrvFn_RemoveModel(
 
 
 
+void rosSrvFn_SetSimAlarm(
+    const std::shared_ptr<rmw_request_id_t> request_header,
+    const std::shared_ptr<navsim_msgs::srv::SetSimAlarm::Request>  request,   
+          std::shared_ptr<navsim_msgs::srv::SetSimAlarm::Response> response)  
+{
+    NAVSIM_TRACE(__func__);
+    // printf("NAVSIM World plugin: SetSimAlarm\n");
+
+    SimAlarm alarm;
+    alarm.deadline.sec  = request->deadline.sec;
+    alarm.deadline.nsec = request->deadline.nanosec;
+    alarm.id            = nextAlarmId++;
+    alarm.client        = request->client_id;
+
+    // A deadline already crossed is notified in the next update
+    alarms.push(alarm);
+
+    response->status   = true;
+    response->alarm_id = alarm.id;
+}
+
+
+
+
+void rosSrvFn_CheckConflicts(
+    const std::shared_ptr<rmw_request_id_t> request_header,
+    const std::shared_ptr<navsim_msgs::srv::CheckConflicts::Request>  request,   
+          std::shared_ptr<navsim_msgs::srv::CheckConflicts::Response> response)  
+{
+    NAVSIM_TRACE(__func__);
+    // printf("NAVSIM World plugin: CheckConflicts\n");
+
+    if (request->reset)
+        conflictDetector->Clear();
+
+    for (const navsim_msgs::msg::FlightPlan &fp : request->plans)
+    {
+        navsim::Plan4D plan = navsim::MakePlan4D(fp);
+
+        for (const navsim::Conflict &c : conflictDetector->Check(plan))
+        {
+            navsim_msgs::msg::Conflict conflict;
+            conflict.plan_id1 = c.id1;
+            conflict.uav_id1  = c.uav1;
+            conflict.plan_id2 = c.id2;
+            conflict.uav_id2  = c.uav2;
+            conflict.distance = c.distance;
+            conflict.time     = navsim::SecToTime(c.time);
+            response->conflicts.push_back(conflict);
+        }
+
+        if (request->store)
+            conflictDetector->Insert(plan);
+    }
+}
+
+
+
+
+void UpdateObstacles()
+{
+    // Models deployed or removed since the last build?
+    if (world->ModelCount() == obstaclesModelCount)
+        return;
+    obstaclesModelCount = world->ModelCount();
+
+    std::vector<navsim::Obstacle> obs;
+    for (const physics::ModelPtr &model : world->Models())
+    {
+        if (!model->IsStatic()) continue;
+
+        for (const physics::LinkPtr &link : model->GetLinks())
+        {
+            for (const physics::CollisionPtr &collision : link->GetCollisions())
+            {
+                // Infinite planes are not obstacles
+                if (collision->GetShape()->HasType(physics::Base::PLANE_SHAPE)) continue;
+
+                ignition::math::Box box = collision->BoundingBox();
+                navsim::Obstacle o;
+                o.lo   = Eigen::Vector3d(box.Min().X(), box.Min().Y(), box.Min().Z());
+                o.hi   = Eigen::Vector3d(box.Max().X(), box.Max().Y(), box.Max().Z());
+                o.name = collision->GetScopedName();
+                obs.push_back(o);
+            }
+        }
+    }
+
+    obstacles.Build(std::move(obs));
+    printf("NAVSIM obstacles: %zu static collisions\n", obstacles.Size());
+}
+
+
+
+
+void rosSrvFn_ValidateFlightPlan(
+    const std::shared_ptr<rmw_request_id_t> request_header,
+    const std::shared_ptr<navsim_msgs::srv::ValidateFlightPlan::Request>  request,   
+          std::shared_ptr<navsim_msgs::srv::ValidateFlightPlan::Response> response)  
+{
+    NAVSIM_TRACE(__func__);
+    // printf("NAVSIM World plugin: ValidateFlightPlan\n");
+
+    UpdateObstacles();
+
+    for (const navsim_msgs::msg::FlightPlan &fp : request->plans)
+    {
+        int numWPs = fp.route.size();
+        double radius = fp.radius;
+
+        for (int i = 1; i < numWPs; i++)
+        {
+            const navsim_msgs::msg::Waypoint &WP1 = fp.route[i-1];
+            const navsim_msgs::msg::Waypoint &WP2 = fp.route[i];
+            Eigen::Vector3d p1(WP1.pos.x, WP1.pos.y, WP1.pos.z);
+            Eigen::Vector3d p2(WP2.pos.x, WP2.pos.y, WP2.pos.z);
+
+            // The take-off and landing pads are in contact with the ground
+            // or a building, so the first and last 'radius' meters are not checked
+            double length = (p2 - p1).norm();
+            double sLo = 0, sHi = 1;
+            if (length > 0 && i == 1)          sLo = std::min(1.0, radius / length);
+            if (length > 0 && i == numWPs - 1) sHi = std::max(0.0, 1.0 - radius / length);
+
+            double s;
+            int hit = obstacles.FirstHit(p1, p2, radius, sLo, sHi, s);
+            if (hit < 0) continue;
+
+            double t1 = navsim::TimeToSec(WP1.time);
+            double t2 = navsim::TimeToSec(WP2.time);
+            Eigen::Vector3d pos = p1 + s * (p2 - p1);
+
+            navsim_msgs::msg::ObstacleViolation violation;
+            violation.plan_id    = fp.plan_id;
+            violation.waypoint   = i;
+            violation.obstacle   = obstacles[hit].name;
+            violation.position.x = pos.x();
+            violation.position.y = pos.y();
+            violation.position.z = pos.z();
+            violation.time       = navsim::SecToTime(t1 + s * (t2 - t1));
+            response->violations.push_back(violation);
+            break;
+        }
+    }
+}
+
+
+
+
+void rosSrvFn_PlanFlights(
+    const std::shared_ptr<rmw_request_id_t> request_header,
+    const std::shared_ptr<navsim_msgs::srv::PlanFlights::Request>  request,   
+          std::shared_ptr<navsim_msgs::srv::PlanFlights::Response> response)  
+{
+    NAVSIM_TRACE(__func__);
+    UpdateObstacles();
+
+    int numRequests = request->requests.size();
+    if (numRequests == 0) return;
+
+    // Route end points: over the origin and the destination at cruise altitude
+    std::vector<Eigen::Vector3d> starts(numRequests), goals(numRequests);
+    Eigen::Vector3d lo = Eigen::Vector3d::Constant( std::numeric_limits<double>::infinity());
+    Eigen::Vector3d hi = Eigen::Vector3d::Constant(-std::numeric_limits<double>::infinity());
+    double clearance = 0;
+    for (int i = 0; i < numRequests; i++)
+    {
+        const navsim_msgs::msg::PlanRequest &req = request->requests[i];
+        starts[i] = Eigen::Vector3d(req.origin.x,      req.origin.y,      req.origin.z);
+        goals[i]  = Eigen::Vector3d(req.destination.x, req.destination.y, req.destination.z);
+        if (req.cruise_altitude > 0)
+        {
+            starts[i].z() = std::max(starts[i].z(), req.cruise_altitude);
+            goals[i].z()  = std::max(goals[i].z(),  req.cruise_altitude);
+        }
+        lo = lo.cwiseMin(starts[i]).cwiseMin(goals[i]);
+        hi = hi.cwiseMax(starts[i]).cwiseMax(goals[i]);
+        clearance = std::max(clearance, req.radius);
+    }
+
+    // Grid over the requests and the obstacles, from the ground to the ceiling.
+    // The whole batch is planned with the largest clearance requested.
+    double ceiling = std::max(PlannerCeiling, hi.z() + PlannerCellSize);
+    for (size_t i = 0; i < obstacles.Size(); i++)
+    {
+        lo = lo.cwiseMin(obstacles[i].lo);
+        hi = hi.cwiseMax(obstacles[i].hi);
+    }
+    double margin = clearance + 2 * PlannerCellSize;
+    lo = lo.array() - margin;
+    hi = hi.array() + margin;
+    lo.z() = std::min(lo.z() + margin, 0.0);
+    hi.z() = ceiling;
+
+    navsim::VoxelGrid grid;
+    if (!grid.Build(obstacles, lo, hi, PlannerCellSize, clearance))
+    {
+        printf("NAVSIM planner: the world is too large for a %.1f m grid\n", PlannerCellSize);
+        response->plans.resize(numRequests);
+        return;
+    }
+
+    auto wallStart = std::chrono::steady_clock::now();
+    std::vector<std::vector<Eigen::Vector3d>> paths = navsim::PlanBatch(grid, starts, goals, PlannerThreads);
+    double wallTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+
+    // Timed waypoints at the requested speed (mode TP: constant velocity between waypoints)
+    int numPlanned = 0;
+    response->plans.resize(numRequests);
+    for (int i = 0; i < numRequests; i++)
+    {
+        const navsim_msgs::msg::PlanRequest &req = request->requests[i];
+        navsim_msgs::msg::FlightPlan &fp = response->plans[i];
+        fp.plan_id     = req.plan_id;
+        fp.uav_id      = req.uav_id;
+        fp.operator_id = req.operator_id;
+        fp.mode        = "TP";
+        fp.radius      = req.radius;
+
+        if (paths[i].empty() || req.speed <= 0) continue;
+        numPlanned++;
+
+        std::vector<Eigen::Vector3d> &path = paths[i];
+        Eigen::Vector3d origin(req.origin.x, req.origin.y, req.origin.z);
+        Eigen::Vector3d destination(req.destination.x, req.destination.y, req.destination.z);
+        if ((path.front() - origin).norm() > 1e-6) path.insert(path.begin(), origin);
+        if ((path.back() - destination).norm() > 1e-6) path.push_back(destination);
+
+        double t = navsim::TimeToSec(req.departure);
+        for (size_t k = 0; k < path.size(); k++)
+        {
+            if (k > 0) t += (path[k] - path[k-1]).norm() / req.speed;
+
+            Eigen::Vector3d vel = Eigen::Vector3d::Zero();
+            if (k + 1 < path.size())
+                vel = (path[k+1] - path[k]).normalized() * req.speed;
+
+            navsim_msgs::msg::Waypoint wp;
+            wp.pos.x = path[k].x();
+            wp.pos.y = path[k].y();
+            wp.pos.z = path[k].z();
+            wp.vel.x = vel.x();
+            wp.vel.y = vel.y();
+            wp.vel.z = vel.z();
+            wp.time  = navsim::SecToTime(t);
+            fp.route.push_back(wp);
+        }
+    }
+
+    printf("NAVSIM planner: %d of %d flight plans in %.3f s (%d threads)\n",
+           numPlanned, numRequests, wallTime, PlannerThreads);
+}
+
+
+
+
+void rosSrvFn_CheckFeasibility(
+    const std::shared_ptr<rmw_request_id_t> request_header,
+    const std::shared_ptr<navsim_msgs::srv::CheckFeasibility::Request>  request,   
+          std::shared_ptr<navsim_msgs::srv::CheckFeasibility::Response> response)  
+{
+    NAVSIM_TRACE(__func__);
+    std::vector<navsim::SegmentViolation> violations = feasibility->Check(request->plans);
+
+    response->violations.reserve(violations.size());
+    for (const navsim::SegmentViolation &v : violations)
+    {
+        navsim_msgs::msg::SegmentViolation msg;
+        msg.plan_id  = request->plans[v.plan].plan_id;
+        msg.waypoint = v.waypoint;
+        msg.type     = v.type;
+        msg.required = v.required;
+        msg.limit    = v.limit;
+        response->violations.push_back(msg);
+    }
+}
+
+
+
+
+void CheckAlarms()
+{
+    // Alarms are checked every update, not every TimePubPeriod,
+    // so clients are notified at the exact step that crosses the deadline
+    while (!alarms.empty() && alarms.top().deadline <= currentTime)
+    {
+        const SimAlarm &alarm = alarms.top();
+
+        navsim_msgs::msg::SimAlarm msg;
+        msg.alarm_id         = alarm.id;
+        msg.client_id        = alarm.client;
+        msg.deadline.sec     = alarm.deadline.sec;
+        msg.deadline.nanosec = alarm.deadline.nsec;
+        msg.time.sec         = currentTime.sec;
+        msg.time.nanosec     = currentTime.nsec;
+
+        rosPub_SimAlarm->publish(msg);
+        alarms.pop();
+    }
+}
+
+
+
+
+void UpdateUAVs()
+{
+    if (uavUpdateTime == currentTime) return;
+    uavUpdateTime = currentTime;
+
+    // UAVs are the dynamic models flown by a NAVSIM drone plugin ("dronelink")
+    uavModels.clear();
+    uavNames.clear();
+    uavPositions.clear();
+    uavVelocities.clear();
+
+    for (const physics::ModelPtr &model : world->Models())
+    {
+        if (model->IsStatic() || !model->GetLink("dronelink")) continue;
+
+        uavModels.push_back(model);
+        uavNames.push_back(model->GetName());
+        ignition::math::Vector3d pos = model->WorldPose().Pos();
+        uavPositions.emplace_back(pos.X(), pos.Y(), pos.Z());
+        ignition::math::Vector3d vel = model->WorldLinearVel();
+        uavVelocities.emplace_back(vel.X(), vel.Y(), vel.Z());
+    }
+}
+
+
+
+
+void SeparationMonitor()
+{
+    // Check if the simulation was reset
+    if (currentTime < prevSeparationTime)
+        prevSeparationTime = currentTime; // The simulation was reset
+
+    double interval = (currentTime - prevSeparationTime).Double();
+    if (interval < SeparationPeriod) return;
+
+    prevSeparationTime = currentTime;
+
+    UpdateUAVs();
+    uavHash.Build(uavPositions, SeparationThreshold);
+
+    uavHash.ForEachPair(SeparationThreshold, [&](int i, int j, double dist)
+    {
+        Eigen::Vector3d relPos = uavPositions[j]  - uavPositions[i];
+        Eigen::Vector3d relVel = uavVelocities[j] - uavVelocities[i];
+
+        navsim_msgs::msg::SeparationEvent msg;
+        msg.time.sec      = currentTime.sec;
+        msg.time.nanosec  = currentTime.nsec;
+        msg.uav_id1       = uavNames[i];
+        msg.uav_id2       = uavNames[j];
+        msg.distance      = dist;
+        msg.closing_speed = (dist > 0) ? -relPos.dot(relVel) / dist : relVel.norm();
+
+        rosPub_Separation->publish(msg);
+    });
+}
+
+
+
+
+void GeofenceMonitor()
+{
+    // Check if the simulation was reset
+    if (currentTime < prevGeofenceTime)
+        prevGeofenceTime = currentTime; // The simulation was reset
+
+    double interval = (currentTime - prevGeofenceTime).Double();
+    if (interval < GeofencePeriod) return;
+
+    prevGeofenceTime = currentTime;
+
+    UpdateUAVs();
+
+    for (const navsim::GeofenceEvent &e : geofences->Evaluate(currentTime.Double(), uavNames, uavPositions))
+    {
+        navsim_msgs::msg::GeofenceEvent msg;
+        msg.time.sec     = currentTime.sec;
+        msg.time.nanosec = currentTime.nsec;
+        msg.uav_id       = e.uav;
+        msg.fence_id     = e.fence;
+        msg.intrusion    = e.intrusion;
+
+        rosPub_GeofenceEvent->publish(msg);
+    }
+}
+
+
+
+
+void ProbeConflicts()
+{
+    // Check if the simulation was reset
+    if (currentTime < prevProbeTime)
+        prevProbeTime = currentTime; // The simulation was reset
+
+    double interval = (currentTime - prevProbeTime).Double();
+    if (interval < ProbePeriod) return;
+
+    prevProbeTime = currentTime;
+
+    UpdateUAVs();
+
+    // The plans are shared with the drones: hold them while predicting
+    std::vector<std::shared_ptr<const navsim::Plan4D>> activePlans(uavNames.size());
+    std::vector<const navsim::Plan4D*> plans(uavNames.size());
+    for (size_t i = 0; i < uavNames.size(); i++)
+    {
+        activePlans[i] = navsim::FleetRegistry::Instance().Plan(uavNames[i]);
+        plans[i] = activePlans[i].get();
+    }
+
+    std::vector<navsim::PredictedConflict> conflicts = probe.Run(
+        currentTime.Double(), SeparationThreshold, uavPositions, uavVelocities, plans);
+
+    for (const navsim::PredictedConflict &c : conflicts)
+    {
+        navsim_msgs::msg::PredictedConflict msg;
+        msg.time.sec     = currentTime.sec;
+        msg.time.nanosec = currentTime.nsec;
+        msg.uav_id1      = uavNames[c.i];
+        msg.uav_id2      = uavNames[c.j];
+        msg.time_to_los  = c.timeToLoS;
+        msg.min_distance = c.minDistance;
+        msg.position1.x  = c.pos1.x();
+        msg.position1.y  = c.pos1.y();
+        msg.position1.z  = c.pos1.z();
+        msg.position2.x  = c.pos2.x();
+        msg.position2.y  = c.pos2.y();
+        msg.position2.z  = c.pos2.z();
+
+        rosPub_ConflictProbe->publish(msg);
+    }
+}
+
+
+
+
+void OccupancyMonitor()
+{
+    // Check if the simulation was reset
+    if (currentTime < prevOccupancyTime)
+    {
+        prevOccupancyTime    = currentTime; // The simulation was reset
+        prevOccupancyPubTime = currentTime;
+        occupancy->Clear();
+    }
+
+    double interval = (currentTime - prevOccupancyTime).Double();
+    if (interval < OccupancyPeriod) return;
+
+    prevOccupancyTime = currentTime;
+
+    UpdateUAVs();
+    occupancy->Update(currentTime.Double(), uavNames, uavPositions);
+
+
+    interval = (currentTime - prevOccupancyPubTime).Double();
+    if (interval < OccupancyPubPeriod) return;
+
+    prevOccupancyPubTime = currentTime;
+
+    navsim_msgs::msg::OccupancyMap msg;
+    msg.time.sec      = currentTime.sec;
+    msg.time.nanosec  = currentTime.nsec;
+    msg.cell_size     = occupancy->CellSize();
+    msg.bucket_period = occupancy->BucketPeriod();
+    msg.num_buckets   = occupancy->NumBuckets();
+
+    int numBuckets = occupancy->NumBuckets();
+    occupancy->Snapshot(currentTime.Double(),
+        [&](int32_t ix, int32_t iy, int32_t iz, uint16_t count, double dwell, const float *series)
+        {
+            msg.ix.push_back(ix);
+            msg.iy.push_back(iy);
+            msg.iz.push_back(iz);
+            msg.count.push_back(count);
+            msg.dwell.push_back(dwell);
+            msg.series.insert(msg.series.end(), series, series + numBuckets);
+        });
+
+    rosPub_Occupancy->publish(msg);
+}
+
+
+
+
+void rosSrvFn_AddGeofence(
+    const std::shared_ptr<rmw_request_id_t> request_header,
+    const std::shared_ptr<navsim_msgs::srv::AddGeofence::Request>  request,   
+          std::shared_ptr<navsim_msgs::srv::AddGeofence::Response> response)  
+{
+    NAVSIM_TRACE(__func__);
+    const navsim_msgs::msg::Geofence &msg = request->fence;
+
+    navsim::Geofence fence;
+    fence.shape   = (msg.shape == navsim_msgs::msg::Geofence::CYLINDER) ?
+                        navsim::Geofence::CYLINDER : navsim::Geofence::PRISM;
+    for (const geometry_msgs::msg::Point &v : msg.polygon)
+        fence.polygon.emplace_back(v.x, v.y);
+    fence.center  = Eigen::Vector2d(msg.center.x, msg.center.y);
+    fence.radius  = msg.radius;
+    fence.floor   = msg.floor;
+    fence.ceiling = msg.ceiling;
+    fence.start   = navsim::TimeToSec(msg.start_time);
+    fence.end     = navsim::TimeToSec(msg.end_time);
+
+    // Check the geometry
+    bool valid = (fence.floor < fence.ceiling) &&
+                 ((fence.shape == navsim::Geofence::CYLINDER) ? fence.radius > 0 : fence.polygon.size() >= 3);
+    if (!valid)
+    {
+        printf("\nInvalid geofence geometry\n\n");
+        response->status = false;
+        return;
+    }
+
+    response->id     = geofences->Add(fence);
+    response->status = true;
+}
+
+
+
+
+void rosSrvFn_RemoveGeofence(
+    const std::shared_ptr<rmw_request_id_t> request_header,
+    const std::shared_ptr<navsim_msgs::srv::RemoveGeofence::Request>  request,   
+          std::shared_ptr<navsim_msgs::srv::RemoveGeofence::Response> response)  
+{
+    NAVSIM_TRACE(__func__);
+    response->status = geofences->Remove(request->id);
+}
+
+
+
+
+void rosSrvFn_ListGeofences(
+    const std::shared_ptr<rmw_request_id_t> request_header,
+    const std::shared_ptr<navsim_msgs::srv::ListGeofences::Request>  request,   
+          std::shared_ptr<navsim_msgs::srv::ListGeofences::Response> response)  
+{
+    NAVSIM_TRACE(__func__);
+    for (const navsim::Geofence &fence : geofences->List())
+    {
+        navsim_msgs::msg::Geofence msg;
+        msg.id    = fence.id;
+        msg.shape = (fence.shape == navsim::Geofence::CYLINDER) ?
+                        navsim_msgs::msg::Geofence::CYLINDER : navsim_msgs::msg::Geofence::PRISM;
+        for (const Eigen::Vector2d &v : fence.polygon)
+        {
+            geometry_msgs::msg::Point p;
+            p.x = v.x();
+            p.y = v.y();
+            msg.polygon.push_back(p);
+        }
+        msg.center.x   = fence.center.x();
+        msg.center.y   = fence.center.y();
+        msg.radius     = fence.radius;
+        msg.floor      = fence.floor;
+        msg.ceiling    = fence.ceiling;
+        msg.start_time = navsim::SecToTime(fence.start);
+        msg.end_time   = navsim::SecToTime(fence.end);
+        response->fences.push_back(msg);
+    }
+}
+
+
+
+
+void rosSrvFn_ReserveAirspace(
+    const std::shared_ptr<rmw_request_id_t> request_header,
+    const std::shared_ptr<navsim_msgs::srv::ReserveAirspace::Request>  request,   
+          std::shared_ptr<navsim_msgs::srv::ReserveAirspace::Response> response)  
+{
+    NAVSIM_TRACE(__func__);
+    navsim::Plan4D plan = navsim::MakePlan4D(request->plan);
+
+    navsim::Reservation result = request->check_only ?
+        reservations->Check(plan) : reservations->Reserve(plan);
+
+    response->accepted = result.accepted;
+    if (!result.accepted)
+    {
+        response->conflict_plan_id = result.conflictPlan;
+        response->conflict_uav_id  = result.conflictUav;
+        response->conflict_cell.x  = result.conflictCell.x();
+        response->conflict_cell.y  = result.conflictCell.y();
+        response->conflict_cell.z  = result.conflictCell.z();
+        response->conflict_time    = navsim::SecToTime(result.conflictTime);
+        return;
+    }
+    if (request->check_only) return;
+
+    // Listen to the UAV navigation reports to release the plan when it ends
+    const std::string &uav = request->plan.uav_id;
+    if (!uav.empty() && rosSub_NavReports.count(uav) == 0)
+    {
+        rosSub_NavReports[uav] = rosNode->create_subscription<navsim_msgs::msg::NavigationReport>(
+            "/NavSim/" + uav + "/NavigationReport", 10,
+            [this, uav](const std::shared_ptr<navsim_msgs::msg::NavigationReport> msg)
+            {
+                rosTopFn_NavigationReport(msg, uav);
+            });
+    }
+}
+
+
+
+
+void rosSrvFn_SaveTrace(
+    const std::shared_ptr<rmw_request_id_t> request_header,
+    const std::shared_ptr<navsim_msgs::srv::SaveTrace::Request>  request,   
+          std::shared_ptr<navsim_msgs::srv::SaveTrace::Response> response)  
+{
+    NAVSIM_TRACE(__func__);
+    navsim::Tracer &tracer = navsim::Tracer::Instance();
+    response->file = request->file.empty() ? tracer.Path() : request->file;
+    if (!tracer.Enabled() || response->file.empty())
+    {
+        response->status = false;
+        return;
+    }
+
+    long events = tracer.Save(response->file);
+    response->status = (events >= 0);
+    response->events = std::max(events, 0L);
+}
+
+
+
+
+void rosSrvFn_MemoryReport(
+    const std::shared_ptr<rmw_request_id_t> request_header,
+    const std::shared_ptr<navsim_msgs::srv::MemoryReport::Request>  request,   
+          std::shared_ptr<navsim_msgs::srv::MemoryReport::Response> response)  
+{
+    NAVSIM_TRACE(__func__);
+    navsim::MemoryRegistry &registry = navsim::MemoryRegistry::Instance();
+    navsim::ProcessMemory process = navsim::ProcessMemory::Sample();
+    std::vector<const navsim::MemoryAccount *> accounts = registry.Accounts();
+
+    response->rss  = process.rss;
+    response->heap = process.heap;
+    response->uavs = accounts.size();
+
+    for (int c = 0; c < int(navsim::MemoryCategory::Count); c++)
+    {
+        navsim::MemoryCategory category = navsim::MemoryCategory(c);
+        int64_t total = 0, max = 0;
+        for (const navsim::MemoryAccount *account : accounts)
+        {
+            int64_t bytes = account->Bytes(category);
+            total += bytes;
+            max    = std::max(max, bytes);
+        }
+        response->category.push_back(navsim::MemoryCategoryName(category));
+        response->mean.push_back(accounts.empty() ? 0.0 : double(total) / accounts.size());
+        response->max.push_back(max);
+        response->total.push_back(total);
+        response->shared.push_back(registry.Shared().Bytes(category));
+    }
+
+    // Rows of the UAV requested, or of every UAV
+    if (request->uav.empty() && !request->detail) return;
+    for (const navsim::MemoryAccount *account : accounts)
+    {
+        if (!request->uav.empty() && account->uav != request->uav) continue;
+        for (int c = 0; c < int(navsim::MemoryCategory::Count); c++)
+        {
+            response->row_uav.push_back(account->uav);
+            response->row_category.push_back(navsim::MemoryCategoryName(navsim::MemoryCategory(c)));
+            response->row_bytes.push_back(account->Bytes(navsim::MemoryCategory(c)));
+        }
+    }
+}
+
+
+
+
+// Reports of the UAV 'uav' (the one of the topic) only release its own plans
+void rosTopFn_NavigationReport(const std::shared_ptr<navsim_msgs::msg::NavigationReport> msg,
+                               const std::string &uav)
+{
+    NAVSIM_TRACE(__func__);
+    if (msg->fp_completed || msg->fp_aborted)
+        reservations->Release({uav, msg->plan_id});
+}
+
+
+
+
+void ReservationExpiry()
+{
+    // Check if the simulation was reset
+    if (currentTime < prevReservationTime)
+        reservations->Clear();     // The simulation was reset
+
+    prevReservationTime = currentTime;
+
+    // Only does work when a time slice is over
+    reservations->Evict(currentTime.Double());
+}
+
+
+
+
+void WindUpdate()
+{
+    if (WindFile.empty() && windProfile.speed == 0 && windTurbulence.intensity == 0) return;
+
+    // Check if the simulation was reset (the turbulence restarts by itself)
+    if (currentTime < prevWindTime)
+    {
+        prevWindTime     = currentTime; // The simulation was reset
+        prevWindGridTime = currentTime;
+    }
+
+    double interval = (currentTime - prevWindTime).Double();
+    if (interval < WindPeriod && wind) return;
+
+    prevWindTime = currentTime;
+
+    // Static obstacles may be deployed later: check them every 10 seconds
+    if (!wind || (WindFile.empty() && (currentTime - prevWindGridTime).Double() >= 10))
+    {
+        prevWindGridTime = currentTime;
+        BuildWindGrid();
+        if (!wind) return;
+    }
+
+    wind->Advance(currentTime.Double());
+
+    UpdateUAVs();
+    size_t n = uavPositions.size();
+    windX.resize(n);  windY.resize(n);  windZ.resize(n);
+    windU.resize(n);  windV.resize(n);  windW.resize(n);
+    for (size_t i = 0; i < n; i++)
+    {
+        windX[i] = uavPositions[i].x();
+        windY[i] = uavPositions[i].y();
+        windZ[i] = uavPositions[i].z();
+    }
+
+    wind->Sample(n, windX.data(), windY.data(), windZ.data(), windU.data(), windV.data(), windW.data());
+
+    uavWinds.resize(n);
+    for (size_t i = 0; i < n; i++)
+        uavWinds[i] = Eigen::Vector3d(windU[i], windV[i], windW[i]);
+    navsim::FleetRegistry::Instance().SetWinds(uavNames, uavWinds);
+}
+
+
+
+
+void CullCollisions()
+{
+    if (!CollisionCulling) return;
+
+    // Check if the simulation was reset
+    if (currentTime < prevCullingTime)
+        prevCullingTime = currentTime; // The simulation was reset
+
+    // Also at once after the start or a reset
+    double interval = (currentTime - prevCullingTime).Double();
+    if (interval < CullingPeriod && currentTime != prevCullingTime) return;
+
+    prevCullingTime = currentTime;
+
+    UpdateUAVs();
+    culler.Update(uavPositions, uavVelocities, CullingRadius, CullingPeriod);
+
+    // Only the UAVs whose cluster changed are touched (new UAVs have all the bits)
+    std::map<uint32_t, uint32_t> applied;
+    for (size_t i = 0; i < uavModels.size(); i++)
+    {
+        uint32_t id   = uavModels[i]->GetId();
+        uint32_t bits = culler.CollideBits(i);
+        applied[id] = bits;
+
+        auto prev = uavCollideBits.find(id);
+        if (prev != uavCollideBits.end() && prev->second == bits) continue;
+
+        for (const physics::LinkPtr &link : uavModels[i]->GetLinks())
+            for (const physics::CollisionPtr &collision : link->GetCollisions())
+            {
+                collision->SetCategoryBits(culler.CategoryBits(i));
+                collision->SetCollideBits(bits);
+            }
+    }
+    uavCollideBits.swap(applied);
+}
+
+
+
+
+void LodMonitor()
+{
+    if (!KinematicLOD) return;
+
+    // Check if the simulation was reset
+    if (currentTime < prevLodTime)
+        prevLodTime = currentTime; // The simulation was reset
+
+    double interval = (currentTime - prevLodTime).Double();
+    if (interval < LodPeriod) return;
+
+    prevLodTime = currentTime;
+
+    UpdateUAVs();
+    UpdateObstacles();
+    navsim::FleetRegistry &registry = navsim::FleetRegistry::Instance();
+    size_t n = uavNames.size();
+
+    // Hysteresis: a kinematic UAV returns to full detail within LodRadius of
+    // anything, and a detailed one only becomes kinematic beyond 1.25 LodRadius
+    double farRadius = 1.25 * LodRadius;
+    std::vector<double> reach(n);
+    for (size_t i = 0; i < n; i++)
+        reach[i] = registry.Kinematic(uavNames[i]) ? LodRadius : farRadius;
+
+    uavKinematic.assign(n, true);
+    lodHash.Build(uavPositions, farRadius);
+    lodHash.ForEachPair(farRadius, [&](int i, int j, double dist)
+    {
+        if (dist < reach[i]) uavKinematic[i] = false;
+        if (dist < reach[j]) uavKinematic[j] = false;
+    });
+
+    double t = currentTime.Double();
+    for (size_t i = 0; i < n; i++)
+    {
+        if (!uavKinematic[i]) continue;
+
+        // Obstacle boxes inflated by the radius (a zero length segment)
+        double sHit;
+        if (obstacles.FirstHit(uavPositions[i], uavPositions[i], reach[i], 0, 1, sHit) >= 0 ||
+            geofences->Near(t, uavPositions[i], reach[i]))
+            uavKinematic[i] = false;
+    }
+
+    registry.SetKinematic(uavNames, uavKinematic);
+}
+
+
+
+
+void BuildWindGrid()
+{
+    if (!WindFile.empty())
+    {
+        windGrid = std::make_shared<navsim::WindGrid>();
+        std::string error;
+        if (!windGrid->Load(WindFile, error))
+        {
+            printf("NAVSIM wind: %s\n", error.c_str());
+            WindFile.clear();
+            windProfile.speed = windTurbulence.intensity = 0;   // no wind
+            return;
+        }
+    }
+    else
+    {
+        UpdateObstacles();
+        if (wind && obstacles.Size() == windObstacles) return;
+        windObstacles = obstacles.Size();
+
+        // Over the obstacles (and 1km x 1km around the origin), from the ground to the ceiling
+        Eigen::Vector3d lo(-500, -500, 0), hi(500, 500, PlannerCeiling);
+        std::vector<navsim::Obstacle> obs;
+        for (size_t i = 0; i < obstacles.Size(); i++)
+        {
+            obs.push_back(obstacles[i]);
+            lo = lo.cwiseMin(obstacles[i].lo);
+            hi = hi.cwiseMax(obstacles[i].hi);
+        }
+        lo -= Eigen::Vector3d(100, 100, 0);
+        hi += Eigen::Vector3d(100, 100, 0);
+        lo.z() = 0;
+
+        windGrid = std::make_shared<navsim::WindGrid>();
+        windGrid->Generate(lo, hi, WindCellSize, windProfile, obs);
+    }
+
+    wind = std::make_unique<navsim::WindField>(windGrid, windTurbulence);
+    printf("NAVSIM wind: grid of %.0f m cells over [%.0f %.0f %.0f] - [%.0f %.0f %.0f]\n",
+           windGrid->CellSize(), windGrid->Lo().x(), windGrid->Lo().y(), windGrid->Lo().z(),
+           windGrid->Hi().x(), windGrid->Hi().y(), windGrid->Hi().z());
+}
+
+
+
+
 void TimeBroadcast()
 {
+    NAVSIM_PROFILE(navsim::Phase::TimeBroadcast);
+
     // printf("WORLD Time broadcast \n");
 
     // Check if the simulation was reset
@@ -307,6 +1681,180 @@ void TimeBroadcast()
     rosPub_SimTime->publish(msg);
 
 
+    // Pacing statistics
+    std::chrono::steady_clock::time_point wallTime = std::chrono::steady_clock::now();
+    double wallInterval = std::chrono::duration<double>(wallTime - prevTimePubWall).count();
+    prevTimePubWall = wallTime;
+
+    navsim_msgs::msg::ClockStats stats;
+    stats.time             = msg;
+    stats.wall_per_sim     = wallInterval / interval;
+    stats.real_time_factor = (wallInterval > 0) ? interval / wallInterval : 0.0;
+
+    rosPub_ClockStats->publish(stats);
+
+
+}
+
+
+
+
+void StatsMonitor()
+{
+#if NAVSIM_ENABLE_PROFILING
+    // Check if the simulation was reset
+    if (currentTime < prevStatsTime)
+        prevStatsTime = currentTime;
+
+    double interval = (currentTime - prevStatsTime).Double();
+    if (interval < StatsPeriod) return;
+    prevStatsTime = currentTime;
+
+    navsim::Profiler &profiler = navsim::Profiler::Instance();
+    double tick = profiler.SecondsPerTick();
+
+    navsim_msgs::msg::SimStats msg;
+    msg.time.sec     = currentTime.sec;
+    msg.time.nanosec = currentTime.nsec;
+    msg.period       = interval;
+
+
+    // Percentiles of every phase called in the period
+    std::vector<uint64_t> counts;
+    uint64_t max;
+    double updateP99 = 0;
+    for (int p = 0; p < int(navsim::Phase::Count); p++)
+    {
+        profiler.Collect(navsim::Phase(p), counts, max);
+
+        std::vector<uint64_t> &prev = statsCounts[p];
+        prev.resize(counts.size(), 0);
+        uint64_t calls = 0;
+        for (size_t b = 0; b < counts.size(); b++)
+        {
+            std::swap(counts[b], prev[b]);
+            counts[b] = prev[b] - counts[b];
+            calls += counts[b];
+        }
+        if (calls == 0) continue;
+
+        msg.phase.push_back(navsim::PhaseName(navsim::Phase(p)));
+        msg.count.push_back(calls);
+        msg.p50.push_back(navsim::Percentile(counts, 0.50) * tick);
+        msg.p99.push_back(navsim::Percentile(counts, 0.99) * tick);
+        msg.max.push_back(max * tick);
+
+        if (navsim::Phase(p) == navsim::Phase::UavUpdate)
+            updateP99 = msg.p99.back();
+    }
+
+
+    // UAVs whose slowest update is above the p99 of the fleet
+    struct Outlier
+    {
+        std::string uav;
+        double max, mean;
+    };
+    std::vector<Outlier> outliers;
+    std::map<std::string, std::pair<uint64_t, uint64_t>> uavs;
+
+    for (const std::shared_ptr<navsim::UavTimes> &times : profiler.Uavs())
+    {
+        uint64_t updates = times->count.load(std::memory_order_relaxed);
+        uint64_t ticks   = times->sum.load(std::memory_order_relaxed);
+        uint64_t slowest = times->max.exchange(0, std::memory_order_relaxed);
+        uavs[times->uav] = std::make_pair(updates, ticks);
+
+        auto prev = statsUavs.find(times->uav);
+        if (prev != statsUavs.end() && prev->second.first <= updates)
+        {
+            updates -= prev->second.first;       // else a new UAV of the same name
+            ticks   -= prev->second.second;
+        }
+
+        if (updates > 0 && updateP99 > 0 && slowest * tick > updateP99)
+            outliers.push_back({times->uav, slowest * tick, ticks * tick / updates});
+    }
+    statsUavs.swap(uavs);
+
+    std::sort(outliers.begin(), outliers.end(),
+              [](const Outlier &a, const Outlier &b) { return a.max > b.max; });
+    if (int(outliers.size()) > StatsOutliers)
+        outliers.resize(std::max(0, StatsOutliers));
+
+    for (const Outlier &outlier : outliers)
+    {
+        msg.outlier_uav.push_back(outlier.uav);
+        msg.outlier_max.push_back(outlier.max);
+        msg.outlier_mean.push_back(outlier.mean);
+    }
+
+    rosPub_Stats->publish(msg);
+#endif
+}
+
+
+
+
+void LatencyMonitor()
+{
+    // Check if the simulation was reset
+    if (currentTime < prevLatencyTime)
+        prevLatencyTime = currentTime;
+
+    double interval = (currentTime - prevLatencyTime).Double();
+    if (interval < LatencyPeriod) return;
+    prevLatencyTime = currentTime;
+
+    navsim_msgs::msg::CommandLatency msg;
+    msg.time.sec     = currentTime.sec;
+    msg.time.nanosec = currentTime.nsec;
+    msg.period       = interval;
+
+    auto addRow = [&msg](const std::string &uav, int stage, std::vector<double> &samples)
+    {
+        if (samples.empty()) return;
+        msg.uav.push_back(uav);
+        msg.stage.push_back(navsim::LatencyStageName(navsim::LatencyStage(stage)));
+        msg.count.push_back(samples.size());
+        msg.p50.push_back(navsim::SamplePercentile(samples, 0.50));
+        msg.p99.push_back(navsim::SamplePercentile(samples, 0.99));
+        msg.max.push_back(*std::max_element(samples.begin(), samples.end()));
+    };
+
+
+    // Samples of the period, of the UAVs and of the whole fleet
+    const int stages = int(navsim::LatencyStage::Count);
+    struct Samples
+    {
+        std::string uav;
+        std::vector<double> stage[int(navsim::LatencyStage::Count)];
+    };
+    std::vector<Samples> uavs;
+    Samples fleet;
+    size_t count = 0;
+
+    for (const std::shared_ptr<navsim::UavLatency> &latency : navsim::LatencyMonitor::Instance().Uavs())
+    {
+        uavs.emplace_back();
+        uavs.back().uav = latency->uav;
+        latency->Take(uavs.back().stage);
+        for (int s = 0; s < stages; s++)
+        {
+            std::vector<double> &samples = uavs.back().stage[s];
+            fleet.stage[s].insert(fleet.stage[s].end(), samples.begin(), samples.end());
+            count += samples.size();
+        }
+    }
+    if (count == 0) return;
+
+    for (int s = 0; s < stages; s++)
+        addRow(fleet.uav, s, fleet.stage[s]);
+    for (Samples &samples : uavs)
+        for (int s = 0; s < stages; s++)
+            addRow(samples.uav, s, samples.stage[s]);
+
+    rosPub_Latency->publish(msg);
 }
 
 
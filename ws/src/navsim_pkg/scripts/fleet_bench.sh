@@ -0,0 +1,100 @@
+#!/bin/bash
+# Fleet-scaling benchmark: how many flight-plan drones this host simulates at RTF >= 1.
+#
+# Runs headless gzserver on worlds/fleet_bench.world once per fleet size. The
+# FleetBench plugin deploys the drones, flies them and writes the RTF, the step
+# time percentiles, the CPU time and the resident memory of the run, and this
+# script merges the runs into one JSON report. No display is needed.
+#
+# Usage: fleet_bench.sh [options]
+#   -n "N1 N2 ..."   fleet sizes                         ("10 50 100 250 500 1000")
+#   -d seconds       measured simulated time per run     (60)
+#   -o file          JSON report                         (fleet_bench.json)
+#   -t seconds       wall-time limit per run             (1800)
+#   -w file          world                               (../worlds/fleet_bench.world)
+#   -p dir           plugins (libWorld.so, libUAM_minidrone_FP1.so, libFleetBench.so)
+#   -m dir           models (UAM/minidrone)
+#
+# ROS 2 and the NAVSIM workspace must be sourced (install/setup.bash), as for gazebo.
+
+set -u
+
+here=$(cd "$(dirname "$0")" && pwd)
+sizes="10 50 100 250 500 1000"
+duration=60
+out=fleet_bench.json
+limit=1800
+world="$here/../worlds/fleet_bench.world"                       # source tree
+[ -f "$world" ] || world="$here/../../share/navsim_pkg/worlds/fleet_bench.world"   # installed
+plugins=""
+models=""
+
+while getopts "n:d:o:t:w:p:m:h" opt; do
+    case $opt in
+        n) sizes=$OPTARG ;;
+        d) duration=$OPTARG ;;
+        o) out=$OPTARG ;;
+        t) limit=$OPTARG ;;
+        w) world=$OPTARG ;;
+        p) plugins=$OPTARG ;;
+        m) models=$OPTARG ;;
+        *) sed -n '2,18p' "$0"; exit 1 ;;
+    esac
+done
+
+[ -f "$world" ] || { echo "ERROR: world $world not found"; exit 1; }
+command -v gzserver > /dev/null || { echo "ERROR: gzserver not found (source Gazebo and ROS 2)"; exit 1; }
+[ -n "$plugins" ] && export GAZEBO_PLUGIN_PATH="$plugins${GAZEBO_PLUGIN_PATH:+:$GAZEBO_PLUGIN_PATH}"
+[ -n "$models" ]  && export GAZEBO_MODEL_PATH="$models${GAZEBO_MODEL_PATH:+:$GAZEBO_MODEL_PATH}"
+unset DISPLAY
+
+runs=$(mktemp -d)
+trap 'rm -rf "$runs"' EXIT
+
+
+for n in $sizes; do
+    echo "=== $n UAVs"
+    report="$runs/$n.json"
+    NAVSIM_BENCH_UAVS=$n NAVSIM_BENCH_DURATION=$duration NAVSIM_BENCH_REPORT="$report" \
+        timeout --signal=INT --kill-after=30 "$limit" gzserver "$world" > "$runs/$n.log" 2>&1
+
+    if [ ! -s "$report" ]; then
+        echo "    no report (timeout or crash), see the end of its log:"
+        tail -5 "$runs/$n.log" | sed 's/^/    /'
+        printf '{\n  "uavs": %d,\n  "error": "no report within %d s"\n}\n' "$n" "$limit" > "$report"
+    fi
+done
+
+
+# Report: the host and the runs
+{
+    printf '{\n  "host": "%s",\n  "cpus": %d,\n' "$(hostname)" "$(nproc)"
+    printf '  "cpu_model": "%s",\n' "$(sed -n 's/^model name\s*:\s*//p' /proc/cpuinfo | head -1)"
+    printf '  "date": "%s",\n  "duration": %s,\n  "runs": [\n' "$(date -Iseconds)" "$duration"
+    first=1
+    for n in $sizes; do
+        [ $first -eq 1 ] || printf ',\n'
+        first=0
+        tr -d '\n' < "$runs/$n.json" | sed 's/  */ /g; s/ *$//; s/^/    /'
+    done
+    printf '\n  ]\n}\n'
+} > "$out"
+
+
+# Summary
+echo
+printf '%8s %8s %10s %10s %8s %10s\n' UAVs RTF "p50 [ms]" "p99 [ms]" cores "RSS [MB]"
+best=0
+for n in $sizes; do
+    field() { sed -n "s/.*\"$1\": \([0-9.]*\).*/\1/p" "$runs/$n.json" | head -1; }
+    rtf=$(field rtf)
+    if [ -z "$rtf" ]; then
+        printf '%8d %8s\n' "$n" failed
+        continue
+    fi
+    printf '%8d %8.3f %10.3f %10.3f %8.2f %10.1f\n' "$n" "$rtf" "$(field p50)" "$(field p99)" "$(field cpu_cores)" "$(field rss_mb)"
+    awk -v r="$rtf" 'BEGIN { exit !(r >= 1) }' && best=$n
+done
+echo
+echo "Largest fleet at RTF >= 1: $best UAVs"
+echo "Report: $out"
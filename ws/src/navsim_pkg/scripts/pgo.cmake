@@ -0,0 +1,94 @@
+# Profile-guided build of the NAVSIM plugins ('make pgo' of navsim_pkg).
+#
+#   1. builds instrumented plugins in BINARY_DIR/pgo-generate (NAVSIM_PGO=GENERATE)
+#   2. trains them with the fleet benchmark (scripts/fleet_bench.sh TRAINING),
+#      which leaves the profiles in PROFILE_DIR
+#   3. builds optimized plugins in BINARY_DIR/pgo-use with the profiles
+#      (NAVSIM_PGO=USE)
+#
+# BINARY_DIR itself, which may be running this script, is left untouched.
+#
+# Usage: cmake -D SOURCE_DIR=<navsim_pkg> -D BINARY_DIR=<build> -D PROFILE_DIR=<dir>
+#              [-D TRAINING="-n 100 -d 30"] [-D BUILD_TYPE=Release] [-D LTO=ON]
+#              [-D CXX_COMPILER=<path>] [-D CXX_COMPILER_ID=GNU|Clang]
+#              -P pgo.cmake
+#
+# ROS 2, Gazebo and the NAVSIM workspace must be sourced, as for the benchmark.
+
+cmake_minimum_required(VERSION 3.13)
+
+foreach(var SOURCE_DIR BINARY_DIR PROFILE_DIR)
+  if(NOT ${var})
+    message(FATAL_ERROR "pgo.cmake: ${var} not given")
+  endif()
+endforeach()
+if(NOT DEFINED TRAINING)
+  set(TRAINING "-n 100 -d 30")
+endif()
+if(NOT BUILD_TYPE)
+  set(BUILD_TYPE Release)
+endif()
+if(NOT DEFINED LTO)
+  set(LTO OFF)
+endif()
+
+set(generate_dir "${BINARY_DIR}/pgo-generate")
+set(use_dir      "${BINARY_DIR}/pgo-use")
+set(common_args
+  -DCMAKE_BUILD_TYPE=${BUILD_TYPE}
+  -DNAVSIM_ENABLE_LTO=${LTO}
+  -DNAVSIM_PGO_DIR=${PROFILE_DIR})
+if(CXX_COMPILER)
+  list(APPEND common_args -DCMAKE_CXX_COMPILER=${CXX_COMPILER})
+endif()
+
+function(run)
+  execute_process(COMMAND ${ARGN} RESULT_VARIABLE result)
+  if(NOT result EQUAL 0)
+    message(FATAL_ERROR "pgo.cmake: failed (${result}): ${ARGN}")
+  endif()
+endfunction()
+
+
+# 1. Instrumented build (profiles of a previous training are discarded)
+message(STATUS "PGO 1/3: instrumented build in ${generate_dir}")
+file(REMOVE_RECURSE "${PROFILE_DIR}")
+file(MAKE_DIRECTORY "${PROFILE_DIR}" "${generate_dir}")
+run(${CMAKE_COMMAND} -S ${SOURCE_DIR} -B ${generate_dir} ${common_args} -DNAVSIM_PGO=GENERATE)
+run(${CMAKE_COMMAND} --build ${generate_dir} --target World UAM_minidrone_FP1 FleetBench)
+
+
+# 2. Training. The instrumented gzserver writes the profiles when it exits.
+message(STATUS "PGO 2/3: training, fleet_bench.sh ${TRAINING}")
+separate_arguments(training_args UNIX_COMMAND "${TRAINING}")
+run(${SOURCE_DIR}/scripts/fleet_bench.sh ${training_args}
+    -w ${SOURCE_DIR}/worlds/fleet_bench.world
+    -p ${generate_dir}
+    -m ${SOURCE_DIR}/models
+    -o ${generate_dir}/training.json)
+
+file(GLOB_RECURSE profiles "${PROFILE_DIR}/*.gcda" "${PROFILE_DIR}/*.profraw")
+if(NOT profiles)
+  message(FATAL_ERROR "pgo.cmake: the training left no profiles in ${PROFILE_DIR} "
+                      "(see ${generate_dir}/training.json)")
+endif()
+list(LENGTH profiles num_profiles)
+message(STATUS "PGO: ${num_profiles} profiles")
+
+if(CXX_COMPILER_ID MATCHES "Clang")
+  find_program(LLVM_PROFDATA NAMES llvm-profdata
+               HINTS ${CMAKE_CURRENT_LIST_DIR} $ENV{LLVM_DIR}/bin)
+  if(NOT LLVM_PROFDATA)
+    message(FATAL_ERROR "pgo.cmake: llvm-profdata not found")
+  endif()
+  run(${LLVM_PROFDATA} merge -output=${PROFILE_DIR}/navsim.profdata ${profiles})
+endif()
+
+
+# 3. Optimized build with the profiles
+message(STATUS "PGO 3/3: optimized build in ${use_dir}")
+file(MAKE_DIRECTORY "${use_dir}")
+run(${CMAKE_COMMAND} -S ${SOURCE_DIR} -B ${use_dir} ${common_args} -DNAVSIM_PGO=USE)
+run(${CMAKE_COMMAND} --build ${use_dir})
+
+message(STATUS "PGO: done, plugins in ${use_dir}, profiles in ${PROFILE_DIR}")
@@ -0,0 +1,103 @@
+#include "navsim/core/Controller.h"
+
+#include <Eigen/QR>
+
+
+namespace navsim
+{
+
+QuadrotorController::QuadrotorController(const QuadrotorParams &p)
+    : params(p)
+{
+    SetSchedule(nullptr);
+    Reset();
+}
+
+
+
+
+void QuadrotorController::SetSchedule(std::shared_ptr<const GainSchedule> s)
+{
+    if (!s || s->points.empty())
+        s = std::make_shared<GainSchedule>(GainSchedule::Hover(params));
+
+    schedule = std::move(s);
+    gains = schedule->points.front();
+}
+
+
+
+
+void QuadrotorController::Reset()
+{
+    E.setZero();
+    u.setZero();
+}
+
+
+
+
+void QuadrotorController::Seed(const QuadrotorState &state, const Eigen::Vector4d &trim)
+{
+    Reset();
+
+    Eigen::Vector3d euler = state.Euler();
+    Eigen::Vector3d v = state.BodyVel();
+    const Eigen::Vector3d &w = state.angVel;
+
+    Eigen::Matrix<double, 8, 1> x;
+    x << euler.x(), euler.y(), w.x(), w.y(), w.z(), v.x(), v.y(), v.z();
+
+    // Gains at the operating point of the current velocity, the reference
+    if (schedule->Scheduled())
+        schedule->Lookup(v.x(), v.z(), gains);
+    x -= gains.x0;
+    Eigen::Vector4d ux = gains.Hs - gains.Kx * x;
+
+    // Ky E = ux - trim
+    E = gains.Ky.colPivHouseholderQr().solve(ux - trim).cwiseMax(-E_max).cwiseMin(E_max);
+    u = (ux - gains.Ky * E).cwiseMax(params.w_min).cwiseMin(params.w_max);
+}
+
+
+
+
+const Eigen::Vector4d &QuadrotorController::Update(const QuadrotorState &state, const VelocityCommand &cmd, double dt)
+{
+    if (!cmd.on)
+    {
+        Reset();
+        return u;
+    }
+
+    Eigen::Vector3d euler = state.Euler();
+    Eigen::Vector3d v = state.BodyVel();
+    const Eigen::Vector3d &w = state.angVel;
+
+    Eigen::Matrix<double, 8, 1> x;
+    x << euler.x(), euler.y(), w.x(), w.y(), w.z(), v.x(), v.y(), v.z();
+
+    Eigen::Vector4d y(v.x(), v.y(), v.z(), w.z());
+    Eigen::Vector4d r(cmd.vel.x(), cmd.vel.y(), cmd.vel.z(), cmd.yawRate);
+
+    // Gains at the operating point of the reference
+    if (schedule->Scheduled())
+        schedule->Lookup(r.x(), r.z(), gains);
+    x -= gains.x0;
+    Eigen::Vector4d ux = gains.Hs - gains.Kx * x;
+
+    // Cumulative error between the output and the reference, only while it
+    // does not push a saturated rotor further out of its range (anti-windup)
+    Eigen::Vector4d next = (E + (y - r) * dt).cwiseMax(-E_max).cwiseMin(E_max);
+    Eigen::Array4d  free = ux - gains.Ky * next;
+    Eigen::Array4d  push = gains.Ky * (E - next);
+    if (!((free > params.w_max && push > 0) || (free < params.w_min && push < 0)).any())
+        E = next;
+
+    // Saturating the rotors speed in case of exceeding the maximum or minimum rotations
+    u = (ux - gains.Ky * E).cwiseMax(params.w_min).cwiseMin(params.w_max);
+
+    return u;
+}
+
+} // namespace navsim
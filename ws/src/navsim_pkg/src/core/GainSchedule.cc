@@ -0,0 +1,276 @@
+#include "navsim/core/GainSchedule.h"
+
+#include <Eigen/Dense>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <sstream>
+
+
+namespace navsim
+{
+
+namespace
+{
+
+// Cell of 'value' between the breakpoints and its fraction, clamped at the borders
+void Locate(const std::vector<double> &breaks, double value, int &i, double &f)
+{
+    i = 0;
+    f = 0;
+    if (breaks.size() < 2) return;
+
+    value = std::min(std::max(value, breaks.front()), breaks.back());
+    i = std::upper_bound(breaks.begin(), breaks.end(), value) - breaks.begin() - 1;
+    i = std::min(std::max(i, 0), int(breaks.size()) - 2);
+    f = (value - breaks[i]) / (breaks[i + 1] - breaks[i]);
+}
+
+
+
+bool Increasing(const std::vector<double> &breaks)
+{
+    return std::adjacent_find(breaks.begin(), breaks.end(), std::greater_equal<double>()) == breaks.end();
+}
+
+
+
+template <typename Matrix>
+bool Read(std::istream &values, Matrix &m)
+{
+    for (int r = 0; r < m.rows(); r++)
+        for (int c = 0; c < m.cols(); c++)
+            if (!(values >> m(r, c))) return false;
+    return true;
+}
+
+
+
+typedef Eigen::Matrix<double, 8, 1> ModelState;
+
+// Derivative of the model state with constant rotor speeds (no yaw, no wind)
+ModelState Derivative(const QuadrotorParams &params, const ModelState &x, const Eigen::Vector4d &w)
+{
+    double roll = x[0], pitch = x[1];
+    Eigen::Vector3d angVel = x.segment<3>(2);
+    Eigen::Vector3d vel    = x.segment<3>(5);
+
+    QuadrotorState state;
+    state.rot = Eigen::AngleAxisd(pitch, Eigen::Vector3d::UnitY()) * Eigen::AngleAxisd(roll, Eigen::Vector3d::UnitX());
+    state.angVel = angVel;
+    state.vel = state.rot * vel;
+    Wrench wrench = RotorWrench(params, state, w);
+
+    const Eigen::Vector3d &I = params.inertia;
+    ModelState d;
+    d[0] = angVel.x() + std::tan(pitch) * (angVel.y() * std::sin(roll) + angVel.z() * std::cos(roll));
+    d[1] = angVel.y() * std::cos(roll) - angVel.z() * std::sin(roll);
+    d.segment<3>(2) = (wrench.torque - angVel.cross(I.cwiseProduct(angVel))).cwiseQuotient(I);
+    d.segment<3>(5) = wrench.force / params.mass - angVel.cross(vel)
+                    + state.rot.conjugate() * Eigen::Vector3d(0, 0, -params.g);
+    return d;
+}
+
+
+
+// Matrix exponential: scaling and squaring of the Taylor series
+template <int N>
+Eigen::Matrix<double, N, N> Exp(Eigen::Matrix<double, N, N> m)
+{
+    int squarings = 0;
+    for (double norm = m.cwiseAbs().rowwise().sum().maxCoeff(); norm > 0.5; norm /= 2, squarings++)
+        m /= 2;
+
+    Eigen::Matrix<double, N, N> result = Eigen::Matrix<double, N, N>::Identity();
+    Eigen::Matrix<double, N, N> term   = Eigen::Matrix<double, N, N>::Identity();
+    for (int k = 1; k <= 12; k++)
+    {
+        term = term * m / k;
+        result += term;
+    }
+    while (squarings--)
+        result = result * result;
+    return result;
+}
+
+
+
+GainPoint Discretize(const QuadrotorParams &params, const GainPoint &p, double dt)
+{
+    // Linearization at the trim: x' = A x + B u
+    Eigen::Matrix<double, 8, 8> A;
+    Eigen::Matrix<double, 8, 4> B;
+    for (int i = 0; i < 8; i++)
+    {
+        ModelState h = ModelState::Zero();
+        h[i] = 1e-4;
+        A.col(i) = (Derivative(params, p.x0 + h, p.Hs) - Derivative(params, p.x0 - h, p.Hs)) / 2e-4;
+    }
+    for (int i = 0; i < 4; i++)
+    {
+        Eigen::Vector4d h = Eigen::Vector4d::Zero();
+        h[i] = 1e-2;
+        B.col(i) = (Derivative(params, p.x0, p.Hs + h) - Derivative(params, p.x0, p.Hs - h)) / 2e-2;
+    }
+
+    // Outputs bVx, bVy, bVz, bWz
+    Eigen::Matrix<double, 4, 8> C = Eigen::Matrix<double, 4, 8>::Zero();
+    C(0, 5) = C(1, 6) = C(2, 7) = C(3, 4) = 1;
+
+    // Continuous closed loop of [x, E] after dt
+    Eigen::Matrix<double, 12, 12> loop = Eigen::Matrix<double, 12, 12>::Zero();
+    loop.topLeftCorner<8, 8>()     = A - B * p.Kx;
+    loop.topRightCorner<8, 4>()    = -B * p.Ky;
+    loop.bottomLeftCorner<4, 8>()  = C;
+    Eigen::Matrix<double, 12, 12> target = Exp<12>(loop * dt);
+
+    // Plant with the rotor speeds held: x(k+1) = Ad x(k) + Bd u(k)
+    Eigen::Matrix<double, 12, 12> hold = Eigen::Matrix<double, 12, 12>::Zero();
+    hold.topLeftCorner<8, 8>()  = A * dt;
+    hold.topRightCorner<8, 4>() = B * dt;
+    hold = Exp<12>(hold);
+    Eigen::Matrix<double, 8, 8> Ad = hold.topLeftCorner<8, 8>();
+    Eigen::Matrix<double, 8, 4> Bd = hold.topRightCorner<8, 4>();
+
+    // The controller sees z = [x(k), E(k-1)] with E(k) = E(k-1) + dt C x(k), and
+    // applies u = -Kz z. Its x(k+1) = Ad x - Bd Kz z must be the one of the
+    // continuous loop from [x(k), E(k)] = T z.
+    Eigen::Matrix<double, 12, 12> T = Eigen::Matrix<double, 12, 12>::Identity();
+    T.bottomLeftCorner<4, 8>() = dt * C;
+    Eigen::Matrix<double, 8, 12> rhs = -(target * T).topRows<8>();
+    rhs.leftCols<8>() += Ad;
+    Eigen::Matrix<double, 4, 12> Kz = (Bd.transpose() * Bd).ldlt().solve(Bd.transpose() * rhs);   // least squares
+
+    GainPoint q = p;
+    q.Ky = Kz.rightCols<4>();
+    q.Kx = Kz.leftCols<8>() - dt * q.Ky * C;
+    return q;
+}
+
+} // namespace
+
+
+
+
+GainSchedule GainSchedule::Hover(const QuadrotorParams &params)
+{
+    GainPoint p;
+    p.Kx << -47.4820, -47.4820, -9.3626, -9.3626,  413.1508, -10.5091,  10.5091,  132.4440,
+             47.4820, -47.4820,  9.3626, -9.3626, -413.1508, -10.5091, -10.5091,  132.4440,
+            -47.4820,  47.4820, -9.3626,  9.3626, -413.1508,  10.5091,  10.5091,  132.4440,
+             47.4820,  47.4820,  9.3626,  9.3626,  413.1508,  10.5091, -10.5091,  132.4440;
+
+    p.Ky << -8.1889,  8.1889,  294.3201,  918.1130,
+            -8.1889, -8.1889,  294.3201, -918.1130,
+             8.1889,  8.1889,  294.3201, -918.1130,
+             8.1889, -8.1889,  294.3201,  918.1130;
+
+    // Linearization point
+    p.Hs.setConstant(params.HoverSpeed());
+
+    GainSchedule schedule;
+    schedule.speeds = {0};
+    schedule.climbs = {0};
+    schedule.points = {p};
+    return schedule;
+}
+
+
+
+
+bool GainSchedule::Load(const std::string &path, std::string &error)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        error = "cannot open " + path;
+        return false;
+    }
+
+    // Numbers of the file without the comments
+    std::stringstream values;
+    std::string line;
+    while (std::getline(file, line))
+        values << line.substr(0, line.find('#')) << '\n';
+
+    int nu, nw;
+    if (!(values >> nu >> nw) || nu < 1 || nw < 1)
+    {
+        error = path + ": invalid header";
+        return false;
+    }
+
+    std::vector<double> u(nu), w(nw);
+    for (double &b : u) values >> b;
+    for (double &b : w) values >> b;
+    if (!values || !Increasing(u) || !Increasing(w))
+    {
+        error = path + ": invalid breakpoints (they must be increasing)";
+        return false;
+    }
+
+    decltype(points) p(size_t(nu) * nw);
+    for (size_t i = 0; i < p.size(); i++)
+    {
+        if (!Read(values, p[i].Hs) || !Read(values, p[i].x0) || !Read(values, p[i].Kx) || !Read(values, p[i].Ky))
+        {
+            error = path + ": " + std::to_string(p.size()) + " points expected, invalid point " + std::to_string(i);
+            return false;
+        }
+    }
+
+    speeds.swap(u);
+    climbs.swap(w);
+    points.swap(p);
+    return true;
+}
+
+
+
+
+void GainSchedule::Lookup(double u, double w, GainPoint &gains) const
+{
+    if (!Scheduled())
+    {
+        gains = points.front();
+        return;
+    }
+
+    int iu, iw;
+    double fu, fw;
+    Locate(speeds, u, iu, fu);
+    Locate(climbs, w, iw, fw);
+
+    // Corners of the cell (the same along a dimension with one breakpoint)
+    const size_t nu = speeds.size();
+    const size_t du = nu > 1 ? 1 : 0;
+    const size_t dw = climbs.size() > 1 ? nu : 0;
+    const GainPoint &p00 = points[iu + nu * iw];
+    const GainPoint &p10 = points[iu + nu * iw + du];
+    const GainPoint &p01 = points[iu + nu * iw + dw];
+    const GainPoint &p11 = points[iu + nu * iw + du + dw];
+
+    const double w00 = (1 - fu) * (1 - fw), w10 = fu * (1 - fw);
+    const double w01 = (1 - fu) * fw,       w11 = fu * fw;
+    gains.Hs = w00 * p00.Hs + w10 * p10.Hs + w01 * p01.Hs + w11 * p11.Hs;
+    gains.x0 = w00 * p00.x0 + w10 * p10.x0 + w01 * p01.x0 + w11 * p11.x0;
+    gains.Kx = w00 * p00.Kx + w10 * p10.Kx + w01 * p01.Kx + w11 * p11.Kx;
+    gains.Ky = w00 * p00.Ky + w10 * p10.Ky + w01 * p01.Ky + w11 * p11.Ky;
+}
+
+
+
+
+GainSchedule GainSchedule::Discretize(const QuadrotorParams &params, double dt) const
+{
+    GainSchedule discrete = *this;
+    if (dt <= 0) return discrete;
+
+    for (GainPoint &p : discrete.points)
+        p = navsim::Discretize(params, p, dt);
+    return discrete;
+}
+
+} // namespace navsim
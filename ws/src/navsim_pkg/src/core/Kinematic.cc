@@ -0,0 +1,111 @@
+#include "navsim/core/Kinematic.h"
+
+#include <Eigen/Geometry>
+
+#include <algorithm>
+#include <cmath>
+
+
+namespace navsim
+{
+
+namespace
+{
+
+// Area between a unit step of one output (body vx, vz or yaw rate) and the
+// response of the full model, starting from hovering
+double StepLag(const QuadrotorParams &params, const VelocityCommand &step, int output, double dt)
+{
+    QuadrotorState state;
+    QuadrotorController controller(params);
+
+    VelocityCommand hover;
+    hover.on = true;
+    for (double t = 0; t < 2; t += dt)
+    {
+        controller.Update(state, hover, dt);
+        Step(params, state, controller.RotorSpeeds(), dt);
+    }
+
+    double area = 0;
+    for (double t = 0; t < 10; t += dt)
+    {
+        controller.Update(state, step, dt);
+        Step(params, state, controller.RotorSpeeds(), dt);
+
+        double y = (output == 3) ? state.angVel.z() / step.yawRate
+                                 : state.BodyVel()[output] / step.vel[output];
+        area += (1 - y) * dt;
+    }
+    return std::max(area, dt);
+}
+
+} // namespace
+
+
+
+
+KinematicParams FitKinematicParams(const QuadrotorParams &params, double dt)
+{
+    KinematicParams k;
+    k.g = params.g;
+
+    VelocityCommand step;
+    step.on = true;
+
+    step.vel = Eigen::Vector3d(1, 0, 0);
+    k.tauXY = StepLag(params, step, 0, dt);
+
+    step.vel = Eigen::Vector3d(0, 0, 1);
+    k.tauZ = StepLag(params, step, 2, dt);
+
+    step.vel = Eigen::Vector3d::Zero();
+    step.yawRate = 0.5;
+    k.tauYaw = StepLag(params, step, 3, dt);
+
+    return k;
+}
+
+
+
+
+void KinematicStep(const KinematicParams &params, QuadrotorState &state, const VelocityCommand &cmd, double dt)
+{
+    if (dt <= 0) return;
+
+    double yaw     = state.Euler().z();
+    double yawRate = (state.rot * state.angVel).z();
+
+    double aXY  = 1 - std::exp(-dt / params.tauXY);
+    double aZ   = 1 - std::exp(-dt / params.tauZ);
+    double aYaw = 1 - std::exp(-dt / params.tauYaw);
+
+    // First-order lags towards the command in the heading frame, which turns
+    // with the drone (the controller regulates the velocity in body axes)
+    Eigen::AngleAxisd heading(-yaw, Eigen::Vector3d::UnitZ());
+    Eigen::Vector3d target = heading * (state.rot * cmd.vel);
+    Eigen::Vector3d vel    = heading * state.vel;
+    vel.x() += aXY * (target.x() - vel.x());
+    vel.y() += aXY * (target.y() - vel.y());
+    vel.z() += aZ  * (target.z() - vel.z());
+    yawRate += aYaw * (cmd.yawRate - yawRate);
+    vel = Eigen::AngleAxisd(yaw + yawRate * dt, Eigen::Vector3d::UnitZ()) * vel;
+
+    Eigen::Vector3d acc = (vel - state.vel) / dt;
+    state.pos += 0.5 * (state.vel + vel) * dt;
+    state.vel  = vel;
+    yaw += yawRate * dt;
+
+    // Roll and pitch that point the thrust (body z) along acc - gravity, in the heading frame
+    Eigen::Vector3d n = Eigen::AngleAxisd(-yaw, Eigen::Vector3d::UnitZ()) * (acc + Eigen::Vector3d(0, 0, params.g));
+    n.z() = std::max(n.z(), 0.1 * params.g);
+    double pitch = std::atan2(n.x(), n.z());
+    double roll  = std::atan2(-n.y(), std::hypot(n.x(), n.z()));
+
+    state.rot = Eigen::AngleAxisd(yaw,   Eigen::Vector3d::UnitZ())
+              * Eigen::AngleAxisd(pitch, Eigen::Vector3d::UnitY())
+              * Eigen::AngleAxisd(roll,  Eigen::Vector3d::UnitX());
+    state.angVel = state.rot.conjugate() * Eigen::Vector3d(0, 0, yawRate);
+}
+
+} // namespace navsim
@@ -0,0 +1,151 @@
+#include "navsim/core/PlanFollower.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+namespace navsim
+{
+
+void PlanFollower::SetRoute(const Route &r)
+{
+    route = r;
+    active = !route.waypoints.empty();
+    currentWP = -1;
+}
+
+
+
+
+void PlanFollower::Clear()
+{
+    route.waypoints.clear();
+    active = false;
+    currentWP = -1;
+}
+
+
+
+
+int PlanFollower::WaypointAtTime(double t) const
+{
+    int numWPs = route.waypoints.size();
+
+    int i;
+    for (i = 0; i < numWPs; i++)
+        if (t < route.waypoints[i].t)
+            break;
+
+    return i;
+}
+
+
+
+
+Eigen::Vector3d PlanFollower::PositionAtTime(double t) const
+{
+    int i = WaypointAtTime(t);
+    int numWPs = route.waypoints.size();
+
+    // Before the start the UAV holds at the first waypoint
+    if (i == 0) return route.waypoints[0].pos;
+
+    const TimedWaypoint &WP1 = route.waypoints[i-1];
+    if (i == numWPs) return WP1.pos;
+
+    const TimedWaypoint &WP2 = route.waypoints[i];
+    double interpol = (t - WP1.t) / (WP2.t - WP1.t);
+    return WP1.pos + interpol * (WP2.pos - WP1.pos);
+}
+
+
+
+
+double PlanFollower::YawAtTime(double t, double currentYaw) const
+{
+    int numWPs = route.waypoints.size();
+    if (numWPs < 2) return currentYaw;
+
+    // Segment flown at time 't' (the first one before the start, the last one after the end)
+    int i = std::min(std::max(WaypointAtTime(t), 1), numWPs - 1);
+
+    Eigen::Vector3d targetDir = route.waypoints[i].pos - route.waypoints[i-1].pos;
+    targetDir.z() = 0;
+
+    if (targetDir.norm() < 1)
+        return currentYaw;
+    return std::atan2(targetDir.y(), targetDir.x());
+}
+
+
+
+
+NavEvent PlanFollower::Update(double t, const QuadrotorState &state, VelocityCommand &cmd, double &cmdExpTime)
+{
+    if (!active) return NavEvent::NONE;
+
+    int WP = WaypointAtTime(t);
+    int numWPs = route.waypoints.size();
+
+    if (currentWP == -1 && WP != 0)
+    {
+        // This flight plan is obsolete
+        Clear();
+        return NavEvent::OBSOLETE;
+    }
+
+    // Navigation status has changed?
+    NavEvent event = NavEvent::NONE;
+    if (currentWP != WP)
+    {
+        if (WP == 0)
+        {
+            // UAV waiting to start the flight, in the right starting position?
+            if ((route.waypoints[0].pos - state.pos).norm() > route.radius)
+            {
+                Clear();
+                return NavEvent::WRONG_START;
+            }
+            event = NavEvent::WAITING;
+        }
+        else if (WP == 1)
+            event = NavEvent::STARTED;
+        else if (WP < numWPs)
+            event = NavEvent::WAYPOINT;
+        else
+        {
+            // Flight plan completed
+            cmd = VelocityCommand();
+            Clear();
+            return NavEvent::COMPLETED;
+        }
+    }
+    currentWP = WP;
+
+
+    // Time step to analyze movement
+    double step = std::min(targetStep, route.waypoints[numWPs-1].t - t);
+
+    // Target absolute linear velocity (to achieve targetPos in 'step' seconds)
+    Eigen::Vector3d targetPos = PositionAtTime(t + step);
+    Eigen::Vector3d targetAbsVel = (targetPos - state.pos) / step;
+    Eigen::Vector3d variationAbsVel = targetAbsVel - state.vel;
+    if (variationAbsVel.norm() > maxVarLinVel)
+        variationAbsVel = variationAbsVel.normalized() * maxVarLinVel;
+    targetAbsVel = state.vel + variationAbsVel;
+
+    // Target yaw and angular velocity
+    double currentYaw = state.Euler().z();
+    double errorYaw = YawAtTime(t + targetStep, currentYaw) - currentYaw;
+    while (errorYaw < -M_PI) errorYaw += 2*M_PI;
+    while (M_PI < errorYaw)  errorYaw -= 2*M_PI;
+
+    cmd.on      = true;
+    cmd.vel     = state.rot.conjugate() * targetAbsVel;
+    cmd.yawRate = std::min(std::max(errorYaw / targetStep, -maxVarAngVel), maxVarAngVel);
+    cmdExpTime  = t + commandTTL;
+
+    return event;
+}
+
+} // namespace navsim
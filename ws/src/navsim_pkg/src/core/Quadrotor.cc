@@ -0,0 +1,172 @@
+#include "navsim/core/Quadrotor.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+namespace navsim
+{
+
+Eigen::Vector3d QuadrotorState::Euler() const
+{
+    const Eigen::Quaterniond &q = rot;
+
+    double roll  = std::atan2(2 * (q.w() * q.x() + q.y() * q.z()), 1 - 2 * (q.x() * q.x() + q.y() * q.y()));
+    double sinp  = std::min(1.0, std::max(-1.0, 2 * (q.w() * q.y() - q.z() * q.x())));
+    double pitch = std::asin(sinp);
+    double yaw   = std::atan2(2 * (q.w() * q.z() + q.x() * q.y()), 1 - 2 * (q.y() * q.y() + q.z() * q.z()));
+
+    return Eigen::Vector3d(roll, pitch, yaw);
+}
+
+
+
+
+Wrench RotorWrench(const QuadrotorParams &params, const QuadrotorState &state, const Eigen::Vector4d &w,
+                   const Eigen::Vector3d &wind)
+{
+    Wrench wrench;
+    wrench.force  = Eigen::Vector3d::Zero();
+    wrench.torque = Eigen::Vector3d::Zero();
+
+    // Thrust of every rotor, applied at the rotor, and its reaction moment
+    for (int i = 0; i < 4; i++)
+    {
+        double w2 = w[i] * w[i];
+        Eigen::Vector3d FT(0, 0, params.kFT * w2);
+        wrench.force  += FT;
+        wrench.torque += params.rotorPos[i].cross(FT);
+        wrench.torque.z() += params.rotorSpin[i] * params.kMDR * w2;
+    }
+
+    // Air friction, opposite to the velocity: FD = -kFD * v*|v|, MD = -kMD * w*|w|
+    Eigen::Vector3d v = state.rot.conjugate() * (state.vel - wind);
+    wrench.force  -= params.kFD.cwiseProduct(v.cwiseProduct(v.cwiseAbs()));
+    wrench.torque -= params.kMD.cwiseProduct(state.angVel.cwiseProduct(state.angVel.cwiseAbs()));
+
+    return wrench;
+}
+
+
+
+
+Wrench ImplicitDrag(const QuadrotorParams &params, const QuadrotorState &state, const Wrench &wrench,
+                    double dt, const Eigen::Vector3d &wind)
+{
+    if (dt <= 0) return wrench;
+
+    const Eigen::Vector3d &I = params.inertia;
+    Eigen::Vector3d v = state.rot.conjugate() * (state.vel - wind);
+
+    // 1 + dt * derivatives of the drag accelerations: 2 * kFD * |v| / m and 2 * kMD * |w| / I
+    Eigen::Array3d linear  = 1 + 2 * dt / params.mass * params.kFD.array() * v.array().abs();
+    Eigen::Array3d angular = 1 + 2 * dt * params.kMD.array() * state.angVel.array().abs() / I.array();
+
+    Eigen::Vector3d gravity   = state.rot.conjugate() * Eigen::Vector3d(0, 0, -params.mass * params.g);
+    Eigen::Vector3d gyroscope = state.angVel.cross(I.cwiseProduct(state.angVel));
+
+    Wrench damped;
+    damped.force  = ((wrench.force + gravity).array() / linear).matrix() - gravity;
+    damped.torque = ((wrench.torque - gyroscope).array() / angular).matrix() + gyroscope;
+    return damped;
+}
+
+
+
+
+Eigen::Vector4d TrimRotorSpeeds(const QuadrotorParams &params, const QuadrotorState &state,
+                                const Eigen::Vector3d &wind)
+{
+    Eigen::Vector3d v = state.rot.conjugate() * (state.vel - wind);
+    Eigen::Vector3d gravity = state.rot.conjugate() * Eigen::Vector3d(0, 0, -params.mass * params.g);
+
+    double thrust = params.kFD.z() * v.z() * std::abs(v.z()) - gravity.z();
+    double w = std::sqrt(std::max(thrust, 0.0) / (4 * params.kFT));
+    return Eigen::Vector4d::Constant(std::min(std::max(w, params.w_min), params.w_max));
+}
+
+
+
+
+namespace
+{
+
+struct Derivative
+{
+    Eigen::Vector3d    dPos;
+    Eigen::Vector3d    dVel;
+    Eigen::Quaterniond dRot;   // not normalized
+    Eigen::Vector3d    dAngVel;
+};
+
+
+Derivative Evaluate(const QuadrotorParams &params, const QuadrotorState &state, const Wrench &wrench)
+{
+    Derivative d;
+    d.dPos = state.vel;
+    d.dVel = state.rot * wrench.force / params.mass - Eigen::Vector3d(0, 0, params.g);
+
+    // q' = 1/2 q (0, w)
+    Eigen::Quaterniond omega(0, state.angVel.x(), state.angVel.y(), state.angVel.z());
+    d.dRot.coeffs() = 0.5 * (state.rot * omega).coeffs();
+
+    // Euler equations: I w' = T - w x (I w)
+    const Eigen::Vector3d &I = params.inertia;
+    d.dAngVel = (wrench.torque - state.angVel.cross(I.cwiseProduct(state.angVel))).cwiseQuotient(I);
+
+    return d;
+}
+
+
+QuadrotorState Apply(const QuadrotorState &state, const Derivative &d, double dt)
+{
+    QuadrotorState next;
+    next.pos    = state.pos    + dt * d.dPos;
+    next.vel    = state.vel    + dt * d.dVel;
+    next.angVel = state.angVel + dt * d.dAngVel;
+    next.rot.coeffs() = state.rot.coeffs() + dt * d.dRot.coeffs();
+    next.rot.normalize();
+    return next;
+}
+
+} // namespace
+
+
+
+
+void Step(const QuadrotorParams &params, QuadrotorState &state, const Eigen::Vector4d &w,
+          double dt, Integrator integrator, const Eigen::Vector3d &wind)
+{
+    if (integrator == Integrator::RK4)
+    {
+        auto evaluate = [&](const QuadrotorState &s) { return Evaluate(params, s, RotorWrench(params, s, w, wind)); };
+        Derivative k1 = evaluate(state);
+        Derivative k2 = evaluate(Apply(state, k1, dt / 2));
+        Derivative k3 = evaluate(Apply(state, k2, dt / 2));
+        Derivative k4 = evaluate(Apply(state, k3, dt));
+
+        Derivative sum;
+        sum.dPos    = k1.dPos    + 2 * k2.dPos    + 2 * k3.dPos    + k4.dPos;
+        sum.dVel    = k1.dVel    + 2 * k2.dVel    + 2 * k3.dVel    + k4.dVel;
+        sum.dAngVel = k1.dAngVel + 2 * k2.dAngVel + 2 * k3.dAngVel + k4.dAngVel;
+        sum.dRot.coeffs() = k1.dRot.coeffs() + 2 * k2.dRot.coeffs() + 2 * k3.dRot.coeffs() + k4.dRot.coeffs();
+
+        state = Apply(state, sum, dt / 6);
+        return;
+    }
+
+    // Semi-implicit Euler: velocities first (with the drag linearly implicit),
+    // then positions with the new velocities
+    Wrench wrench = ImplicitDrag(params, state, RotorWrench(params, state, w, wind), dt, wind);
+    Derivative d = Evaluate(params, state, wrench);
+    state.vel    += dt * d.dVel;
+    state.angVel += dt * d.dAngVel;
+    state.pos    += dt * state.vel;
+
+    double angle = state.angVel.norm() * dt;
+    if (angle > 0)
+        state.rot = state.rot * Eigen::Quaterniond(Eigen::AngleAxisd(angle, state.angVel.normalized()));
+    state.rot.normalize();
+}
+
+} // namespace navsim
@@ -0,0 +1,109 @@
+#include "navsim/core/Scenario.h"
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+
+namespace navsim
+{
+
+double Scenario::EndTime() const
+{
+    double end = 0;
+    for (const ScenarioUAV &uav : uavs)
+        if (!uav.route.waypoints.empty())
+            end = std::max(end, uav.route.waypoints.back().t);
+    return end;
+}
+
+
+
+
+void Scenario::Bounds(Eigen::Vector3d &lo, Eigen::Vector3d &hi) const
+{
+    lo = hi = uavs.empty() ? Eigen::Vector3d::Zero() : uavs.front().pos;
+    for (const ScenarioUAV &uav : uavs)
+    {
+        lo = lo.cwiseMin(uav.pos);
+        hi = hi.cwiseMax(uav.pos);
+        for (const TimedWaypoint &wp : uav.route.waypoints)
+        {
+            lo = lo.cwiseMin(wp.pos);
+            hi = hi.cwiseMax(wp.pos);
+        }
+    }
+}
+
+
+
+
+bool LoadScenario(const std::string &path, Scenario &scenario, std::string &error)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        error = "cannot open " + path;
+        return false;
+    }
+
+    scenario.uavs.clear();
+    std::map<std::string, size_t> index;
+    Route *route = nullptr;
+
+    std::string line;
+    for (int n = 1; std::getline(file, line); n++)
+    {
+        line = line.substr(0, line.find('#'));
+        std::istringstream in(line);
+        std::string item;
+        if (!(in >> item)) continue;
+
+        bool ok = true;
+        if (item == "uav")
+        {
+            ScenarioUAV uav;
+            ok = bool(in >> uav.name >> uav.pos.x() >> uav.pos.y() >> uav.pos.z()) && !index.count(uav.name);
+            in >> uav.yaw;
+            if (ok)
+            {
+                index[uav.name] = scenario.uavs.size();
+                scenario.uavs.push_back(uav);
+                route = nullptr;
+            }
+        }
+        else if (item == "plan")
+        {
+            std::string name;
+            int id;
+            double radius;
+            ok = bool(in >> name >> id >> radius) && index.count(name);
+            if (ok)
+            {
+                route = &scenario.uavs[index[name]].route;
+                route->id     = id;
+                route->radius = radius;
+                route->waypoints.clear();
+            }
+        }
+        else if (item == "wp")
+        {
+            TimedWaypoint wp;
+            ok = route && bool(in >> wp.t >> wp.pos.x() >> wp.pos.y() >> wp.pos.z());
+            if (ok) route->waypoints.push_back(wp);
+        }
+        else
+            ok = false;
+
+        if (!ok)
+        {
+            error = path + ":" + std::to_string(n) + ": invalid line";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+} // namespace navsim
@@ -0,0 +1,107 @@
+#include "navsim/core/SimDrone.h"
+
+#include <cmath>
+
+
+namespace navsim
+{
+
+SimDrone::SimDrone(const std::string &n, const QuadrotorParams &p)
+    : controller(p), name(n), params(p)
+{
+}
+
+
+
+
+void SimDrone::Command(const VelocityCommand &command, double t, double duration)
+{
+    cmd = command;
+    cmdExpTime = t + duration;
+}
+
+
+
+
+void SimDrone::SetKinematic(bool k, double t)
+{
+    if (k == kinematic) return;
+    kinematic = k;
+
+    // The controller resumes from the trim of the state left by the kinematic model
+    if (!kinematic && rotorsOn)
+    {
+        controller.Seed(state, TrimRotorSpeeds(params, state, wind));
+        prevControlTime = t;
+    }
+}
+
+
+
+
+NavEvent SimDrone::Step(double t, double dt)
+{
+    return Step(t, dt, state);
+}
+
+
+
+
+NavEvent SimDrone::Step(double t, double dt, const QuadrotorState &measured)
+{
+    // UAV flight plan navigation
+    NavEvent event = follower.Update(t, measured, cmd, cmdExpTime);
+
+    // Platform low level control
+    if (!cmd.on)
+    {
+        controller.Reset();
+        rotorsOn = false;
+    }
+    else
+    {
+        // Hover when the command has expired
+        if (cmdExpTime < t)
+        {
+            cmd = VelocityCommand();
+            cmd.on = true;
+        }
+
+        // Check if the flight starts
+        if (!rotorsOn)
+        {
+            rotorsOn = true;
+            prevControlTime = t;
+        }
+
+        if (kinematic)
+        {
+            KinematicStep(lags, state, cmd, dt);
+            return event;
+        }
+
+        double interval = t - prevControlTime;
+        prevControlTime = t;
+
+        controller.Update(measured, cmd, interval);
+    }
+
+    // Landed with the rotors off: nothing moves
+    if (!rotorsOn && state.pos.z() <= ground)
+        return event;
+
+    navsim::Step(params, state, controller.RotorSpeeds(), dt, integrator, wind);
+
+    // Contact with the ground: the UAV stops, levelled with its heading
+    if (state.pos.z() < ground)
+    {
+        state.pos.z() = ground;
+        state.vel.setZero();
+        state.angVel.setZero();
+        state.rot = Eigen::Quaterniond(Eigen::AngleAxisd(state.Euler().z(), Eigen::Vector3d::UnitZ()));
+    }
+
+    return event;
+}
+
+} // namespace navsim
@@ -0,0 +1,272 @@
+#include "navsim/core/WindField.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+
+namespace navsim
+{
+
+void WindLattice::Resize(const Eigen::Vector3d &lo, const Eigen::Vector3d &hi, double cellSize)
+{
+    cell   = cellSize;
+    origin = lo;
+    nx = std::max(2, int(std::ceil((hi.x() - lo.x()) / cell)) + 1);
+    ny = std::max(2, int(std::ceil((hi.y() - lo.y()) / cell)) + 1);
+    nz = std::max(2, int(std::ceil((hi.z() - lo.z()) / cell)) + 1);
+    nodes.assign(size_t(nx) * ny * nz, Eigen::Array4f::Zero());
+}
+
+
+
+
+Eigen::Array4f WindLattice::Interpolate(double x, double y, double z) const
+{
+    double fx = std::min(std::max((x - origin.x()) / cell, 0.0), double(nx - 1));
+    double fy = std::min(std::max((y - origin.y()) / cell, 0.0), double(ny - 1));
+    double fz = std::min(std::max((z - origin.z()) / cell, 0.0), double(nz - 1));
+    int ix = std::min(int(fx), nx - 2);
+    int iy = std::min(int(fy), ny - 2);
+    int iz = std::min(int(fz), nz - 2);
+    float tx = fx - ix, ty = fy - iy, tz = fz - iz;
+
+    const size_t sy = nx, sz = size_t(nx) * ny;
+    const Eigen::Array4f *n = &nodes[Index(ix, iy, iz)];
+
+    Eigen::Array4f c00 = n[0]       + tx * (n[1]       - n[0]);
+    Eigen::Array4f c10 = n[sy]      + tx * (n[sy+1]    - n[sy]);
+    Eigen::Array4f c01 = n[sz]      + tx * (n[sz+1]    - n[sz]);
+    Eigen::Array4f c11 = n[sy+sz]   + tx * (n[sy+sz+1] - n[sy+sz]);
+    Eigen::Array4f c0  = c00 + ty * (c10 - c00);
+    Eigen::Array4f c1  = c01 + ty * (c11 - c01);
+    return c0 + tz * (c1 - c0);
+}
+
+
+
+
+void WindGrid::Generate(const Eigen::Vector3d &lo, const Eigen::Vector3d &hi, double cellSize,
+                        const WindProfile &profile, const std::vector<Obstacle> &obstacles)
+{
+    Resize(lo, hi, cellSize);
+
+    const Eigen::Vector3d d(std::cos(profile.direction), std::sin(profile.direction), 0);   // along the wind
+    const Eigen::Vector3d p(-d.y(), d.x(), 0);                                              // across the wind
+
+    // Speed factor and turbulence scale of every node
+    std::vector<float>   slow(nodes.size(), 1.0f);
+    std::vector<float>   gust(nodes.size(), 1.0f);
+    std::vector<uint8_t> inside(nodes.size(), 0);
+
+    for (const Obstacle &o : obstacles)
+    {
+        double height = o.hi.z() - std::max(o.lo.z(), 0.0);
+        if (height <= 0) continue;
+        double wake = profile.wakeLength * height;
+
+        Eigen::Vector3d c = (o.lo + o.hi) / 2;
+        Eigen::Vector3d e = (o.hi - o.lo) / 2;
+        double alongHalf  = std::abs(e.x() * d.x()) + std::abs(e.y() * d.y());
+        double acrossHalf = std::abs(e.x() * p.x()) + std::abs(e.y() * p.y());
+
+        // The obstacle and its wake downstream
+        Eigen::Vector3d rlo = o.lo.cwiseMin(o.lo + wake * d);
+        Eigen::Vector3d rhi = o.hi.cwiseMax(o.hi + wake * d);
+        Eigen::Vector3i c1 = ((rlo - origin) / cell).array().ceil().cast<int>().max(0);
+        Eigen::Vector3i c2 = ((rhi - origin) / cell).array().floor().cast<int>()
+                             .min(Eigen::Array3i(nx - 1, ny - 1, nz - 1));
+
+        for (int iz = c1.z(); iz <= c2.z(); iz++)
+        for (int iy = c1.y(); iy <= c2.y(); iy++)
+        for (int ix = c1.x(); ix <= c2.x(); ix++)
+        {
+            size_t i = Index(ix, iy, iz);
+            Eigen::Vector3d q = Position(ix, iy, iz);
+            if ((q.array() >= o.lo.array()).all() && (q.array() <= o.hi.array()).all())
+            {
+                inside[i] = 1;
+                continue;
+            }
+
+            double along  = (q - c).dot(d) - alongHalf;
+            double across = std::abs((q - c).dot(p));
+            if (along <= 0 || along >= wake || across > acrossHalf || wake <= 0) continue;
+
+            double s = 1 - along / wake;   // 1 right behind the obstacle, 0 at the end of the wake
+            slow[i] = std::min<float>(slow[i], 1 - profile.wakeDeficit * s);
+            gust[i] = std::max<float>(gust[i], 1 + profile.wakeTurbulence * s);
+        }
+    }
+
+    for (int iz = 0; iz < nz; iz++)
+    for (int iy = 0; iy < ny; iy++)
+    for (int ix = 0; ix < nx; ix++)
+    {
+        size_t i = Index(ix, iy, iz);
+        double z = Position(ix, iy, iz).z();
+        if (inside[i] || z <= 0) continue;   // no wind inside the obstacles and under the ground
+
+        double speed = profile.speed * std::pow(z / profile.refHeight, profile.shear) * slow[i];
+        nodes[i] = Eigen::Array4f(speed * d.x(), speed * d.y(), 0, gust[i]);
+    }
+}
+
+
+
+
+bool WindGrid::Load(const std::string &path, std::string &error)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        error = "cannot open " + path;
+        return false;
+    }
+
+    // Numbers of the file without the comments
+    std::stringstream values;
+    std::string line;
+    while (std::getline(file, line))
+        values << line.substr(0, line.find('#')) << '\n';
+
+    Eigen::Vector3d o;
+    double cellSize;
+    int sx, sy, sz;
+    if (!(values >> o.x() >> o.y() >> o.z() >> cellSize >> sx >> sy >> sz) ||
+        cellSize <= 0 || sx < 2 || sy < 2 || sz < 2)
+    {
+        error = path + ": invalid header";
+        return false;
+    }
+    Resize(o, o + cellSize * Eigen::Vector3d(sx - 1, sy - 1, sz - 1), cellSize);
+
+    // Rows of 3 or 4 values
+    for (size_t i = 0; i < nodes.size(); i++)
+    {
+        if (!std::getline(values >> std::ws, line))
+        {
+            error = path + ": " + std::to_string(nodes.size()) + " nodes expected";
+            nodes.clear();
+            return false;
+        }
+        std::istringstream row(line);
+        float u, v, w, k = 1;
+        if (!(row >> u >> v >> w))
+        {
+            error = path + ": invalid node " + std::to_string(i);
+            nodes.clear();
+            return false;
+        }
+        row >> k;
+        nodes[i] = Eigen::Array4f(u, v, w, k);
+    }
+
+    return true;
+}
+
+
+
+
+WindField::WindField(std::shared_ptr<const WindGrid> m, const TurbulenceParams &t, uint64_t seed)
+    : mean(std::move(m)), turbulence(t), rng(seed), normal(0.0f, 1.0f)
+{
+    if (Calm() || turbulence.intensity <= 0) return;
+
+    // Lattice of the length scale over the mean grid
+    Resize(mean->Lo(), mean->Hi(), std::max(turbulence.lengthScale, mean->CellSize()));
+    prev = next = nodes;
+
+    sigma = Eigen::Array4f(turbulence.intensity, turbulence.intensity,
+                           turbulence.intensity * turbulence.verticalRatio, 0);
+
+    // Frozen turbulence carried by the mean wind: correlation time L / U
+    double speed = 0;
+    for (const Eigen::Array4f &node : mean->nodes)
+        speed += node.head<3>().matrix().norm();
+    speed = std::max(1.0, speed / mean->nodes.size());
+    decay = std::exp(-turbulence.period * speed / turbulence.lengthScale);
+}
+
+
+
+
+void WindField::Draw(Nodes &values, const Nodes *from)
+{
+    float keep = from ? decay : 0;
+    float add  = std::sqrt(1 - keep * keep);
+    for (size_t i = 0; i < values.size(); i++)
+    {
+        Eigen::Array4f noise(normal(rng), normal(rng), normal(rng), 0);
+        values[i] = add * sigma * noise;
+        if (from) values[i] += keep * (*from)[i];
+    }
+}
+
+
+
+
+void WindField::Advance(double t)
+{
+    if (nodes.empty() || t == now) return;
+
+    // Start (or restart after a reset or a long jump) in the stationary distribution
+    if (now < 0 || t < tPrev || t > tNext + 10 * turbulence.period)
+    {
+        tPrev = t;
+        tNext = t + turbulence.period;
+        Draw(prev, nullptr);
+        Draw(next, &prev);
+    }
+    while (t >= tNext)
+    {
+        prev.swap(next);
+        Draw(next, &prev);
+        tPrev  = tNext;
+        tNext += turbulence.period;
+    }
+    now = t;
+
+    float s = (t - tPrev) / (tNext - tPrev);
+    for (size_t i = 0; i < nodes.size(); i++)
+        nodes[i] = prev[i] + s * (next[i] - prev[i]);
+}
+
+
+
+
+void WindField::Sample(size_t n, const double *x, const double *y, const double *z,
+                       double *u, double *v, double *w) const
+{
+    if (Calm())
+    {
+        std::fill(u, u + n, 0.0);
+        std::fill(v, v + n, 0.0);
+        std::fill(w, w + n, 0.0);
+        return;
+    }
+
+    const bool turbulent = !nodes.empty();
+    for (size_t i = 0; i < n; i++)
+    {
+        Eigen::Array4f wind = mean->Interpolate(x[i], y[i], z[i]);
+        if (turbulent)
+            wind += wind[3] * Interpolate(x[i], y[i], z[i]);
+        u[i] = wind[0];
+        v[i] = wind[1];
+        w[i] = wind[2];
+    }
+}
+
+
+
+
+Eigen::Vector3d WindField::At(const Eigen::Vector3d &p) const
+{
+    Eigen::Vector3d wind;
+    Sample(1, &p.x(), &p.y(), &p.z(), &wind.x(), &wind.y(), &wind.z());
+    return wind;
+}
+
+} // namespace navsim
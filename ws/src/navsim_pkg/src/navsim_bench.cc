@@ -0,0 +1,283 @@
+// Micro-benchmarks of the hot kernels of UAM_minidrone_FP1, on navsim_core
+// with synthetic states and routes (no Gazebo, no ROS).
+//
+//   navigation  WaypointAtTime, PositionAtTime, YawAtTime and the follower
+//               Update, on routes of 2 to 10k waypoints
+//   control     the ServoControl law (hover gains and a gain schedule)
+//   dynamics    the PlatformDynamics wrench (RotorWrench, ImplicitDrag) and
+//               the headless integrators
+//
+// Usage: navsim_bench [--benchmark_filter=regex] [--benchmark_repetitions=N]
+//                     [--benchmark_out=file.json --benchmark_out_format=json]
+//
+// The build target 'bench' runs them all into navsim_bench.json of the build
+// directory, to compare before and after a change (Google Benchmark's
+// tools/compare.py reads it).
+
+#include "navsim/core/Controller.h"
+#include "navsim/core/GainSchedule.h"
+#include "navsim/core/Kinematic.h"
+#include "navsim/core/PlanFollower.h"
+#include "navsim/core/Quadrotor.h"
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <random>
+#include <vector>
+
+
+namespace
+{
+
+// Zigzag at 5 m/s with a waypoint every 10 s
+navsim::Route SyntheticRoute(int waypoints)
+{
+    navsim::Route route;
+    route.id = 1;
+    route.radius = 1;
+    for (int i = 0; i < waypoints; i++)
+        route.waypoints.push_back({10.0 * i, Eigen::Vector3d(40.0 * i, 30.0 * (i % 2), 20 + 5.0 * (i % 3))});
+    return route;
+}
+
+
+
+// Times spread over the route (and a little before and after it), in random order
+std::vector<double> QueryTimes(const navsim::Route &route, size_t count = 1024)
+{
+    double end = route.waypoints.back().t;
+    std::mt19937 random(1);
+    std::uniform_real_distribution<double> time(-5, end + 5);
+
+    std::vector<double> times(count);
+    for (double &t : times) t = time(random);
+    return times;
+}
+
+
+
+// Flying at 'speed' m/s with some attitude and rotation, as in a cruise
+navsim::QuadrotorState CruiseState(double speed)
+{
+    navsim::QuadrotorState state;
+    state.pos = Eigen::Vector3d(100, 50, 20);
+    state.rot = Eigen::AngleAxisd(0.3, Eigen::Vector3d::UnitZ()) * Eigen::AngleAxisd(-0.1, Eigen::Vector3d::UnitY());
+    state.vel = Eigen::Vector3d(speed, 0.2, -0.1);
+    state.angVel = Eigen::Vector3d(0.05, -0.02, 0.1);
+    return state;
+}
+
+
+
+// 5 x 3 operating points around the hover gains
+std::shared_ptr<navsim::GainSchedule> SyntheticSchedule()
+{
+    navsim::GainSchedule hover = navsim::GainSchedule::Hover();
+    auto schedule = std::make_shared<navsim::GainSchedule>();
+    schedule->speeds = {0, 2, 4, 6, 8};
+    schedule->climbs = {-2, 0, 2};
+    for (double w : schedule->climbs)
+        for (double u : schedule->speeds)
+        {
+            navsim::GainPoint p = hover.points.front();
+            p.x0[5] = u;
+            p.x0[7] = w;
+            p.Kx *= 1 + 0.02 * u;
+            schedule->points.push_back(p);
+        }
+    return schedule;
+}
+
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Navigation
+
+void WaypointAtTime(benchmark::State &bench)
+{
+    navsim::PlanFollower follower;
+    follower.SetRoute(SyntheticRoute(bench.range(0)));
+    std::vector<double> times = QueryTimes(follower.GetRoute());
+
+    size_t k = 0;
+    for (auto _ : bench)
+    {
+        benchmark::DoNotOptimize(follower.WaypointAtTime(times[k]));
+        k = (k + 1) % times.size();
+    }
+    bench.SetItemsProcessed(bench.iterations());
+}
+BENCHMARK(WaypointAtTime)->RangeMultiplier(10)->Range(2, 10000);
+
+
+
+void PositionAtTime(benchmark::State &bench)
+{
+    navsim::PlanFollower follower;
+    follower.SetRoute(SyntheticRoute(bench.range(0)));
+    std::vector<double> times = QueryTimes(follower.GetRoute());
+
+    size_t k = 0;
+    for (auto _ : bench)
+    {
+        benchmark::DoNotOptimize(follower.PositionAtTime(times[k]));
+        k = (k + 1) % times.size();
+    }
+    bench.SetItemsProcessed(bench.iterations());
+}
+BENCHMARK(PositionAtTime)->RangeMultiplier(10)->Range(2, 10000);
+
+
+
+void YawAtTime(benchmark::State &bench)
+{
+    navsim::PlanFollower follower;
+    follower.SetRoute(SyntheticRoute(bench.range(0)));
+    std::vector<double> times = QueryTimes(follower.GetRoute());
+
+    size_t k = 0;
+    for (auto _ : bench)
+    {
+        benchmark::DoNotOptimize(follower.YawAtTime(times[k], 0.3));
+        k = (k + 1) % times.size();
+    }
+    bench.SetItemsProcessed(bench.iterations());
+}
+BENCHMARK(YawAtTime)->RangeMultiplier(10)->Range(2, 10000);
+
+
+
+// A whole navigation step, in the middle of the route
+void FollowerUpdate(benchmark::State &bench)
+{
+    navsim::Route route = SyntheticRoute(bench.range(0));
+    double t = route.waypoints.back().t / 2;
+    navsim::PlanFollower follower;
+    navsim::QuadrotorState state;
+    navsim::VelocityCommand cmd;
+    double cmdExpTime;
+
+    // Waiting at the start, then flying
+    follower.SetRoute(route);
+    state.pos = route.waypoints[0].pos;
+    follower.Update(-1, state, cmd, cmdExpTime);
+    state = CruiseState(4);
+    state.pos = follower.PositionAtTime(t);
+
+    for (auto _ : bench)
+    {
+        follower.Update(t, state, cmd, cmdExpTime);
+        benchmark::DoNotOptimize(cmd);
+    }
+    bench.SetItemsProcessed(bench.iterations());
+}
+BENCHMARK(FollowerUpdate)->RangeMultiplier(10)->Range(2, 10000);
+
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Control
+
+void ServoControl(benchmark::State &bench)
+{
+    navsim::QuadrotorController controller;
+    if (bench.range(0))
+        controller.SetSchedule(SyntheticSchedule());
+    navsim::QuadrotorState state = CruiseState(4);
+
+    navsim::VelocityCommand cmd;
+    cmd.on = true;
+    cmd.vel = Eigen::Vector3d(5, 0, 0.5);
+    cmd.yawRate = 0.1;
+    for (auto _ : bench)
+        benchmark::DoNotOptimize(controller.Update(state, cmd, 0.001));
+    bench.SetItemsProcessed(bench.iterations());
+}
+BENCHMARK(ServoControl)->ArgName("scheduled")->Arg(0)->Arg(1);
+
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Dynamics
+
+void RotorWrench(benchmark::State &bench)
+{
+    navsim::QuadrotorParams params;
+    navsim::QuadrotorState state = CruiseState(8);
+    Eigen::Vector4d w = Eigen::Vector4d::Constant(params.HoverSpeed()) + Eigen::Vector4d(5, -5, 3, -3);
+    Eigen::Vector3d wind(2, -1, 0);
+
+    for (auto _ : bench)
+        benchmark::DoNotOptimize(navsim::RotorWrench(params, state, w, wind));
+    bench.SetItemsProcessed(bench.iterations());
+}
+BENCHMARK(RotorWrench);
+
+
+
+// The wrench of PlatformDynamics, made linearly implicit for the step
+void PlatformWrench(benchmark::State &bench)
+{
+    navsim::QuadrotorParams params;
+    navsim::QuadrotorState state = CruiseState(8);
+    Eigen::Vector4d w = Eigen::Vector4d::Constant(params.HoverSpeed()) + Eigen::Vector4d(5, -5, 3, -3);
+    Eigen::Vector3d wind(2, -1, 0);
+
+    for (auto _ : bench)
+    {
+        navsim::Wrench wrench = navsim::RotorWrench(params, state, w, wind);
+        benchmark::DoNotOptimize(navsim::ImplicitDrag(params, state, wrench, 0.001, wind));
+    }
+    bench.SetItemsProcessed(bench.iterations());
+}
+BENCHMARK(PlatformWrench);
+
+
+
+void Step(benchmark::State &bench)
+{
+    navsim::QuadrotorParams params;
+    navsim::Integrator integrator = bench.range(0) ? navsim::Integrator::RK4 : navsim::Integrator::SemiImplicitEuler;
+    navsim::QuadrotorState start = CruiseState(4);
+    Eigen::Vector4d w = Eigen::Vector4d::Constant(params.HoverSpeed());
+
+    navsim::QuadrotorState state = start;
+    for (auto _ : bench)
+    {
+        navsim::Step(params, state, w, 0.001, integrator);
+        benchmark::DoNotOptimize(state);
+        state.pos = start.pos;
+    }
+    bench.SetItemsProcessed(bench.iterations());
+}
+BENCHMARK(Step)->ArgName("rk4")->Arg(0)->Arg(1);
+
+
+
+void KinematicStep(benchmark::State &bench)
+{
+    navsim::KinematicParams params = navsim::FitKinematicParams();
+    navsim::QuadrotorState state = CruiseState(4);
+
+    navsim::VelocityCommand cmd;
+    cmd.on = true;
+    cmd.vel = Eigen::Vector3d(5, 0, 0.5);
+    cmd.yawRate = 0.1;
+    for (auto _ : bench)
+    {
+        navsim::KinematicStep(params, state, cmd, 0.001);
+        benchmark::DoNotOptimize(state);
+    }
+    bench.SetItemsProcessed(bench.iterations());
+}
+BENCHMARK(KinematicStep);
+
+} // namespace
+
+
+
+BENCHMARK_MAIN();
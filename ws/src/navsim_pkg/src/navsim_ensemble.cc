@@ -0,0 +1,463 @@
+// Monte Carlo ensemble of headless NAVSIM simulations.
+//
+// Flies the same scenario many times with the navsim_core dynamics, each run
+// with its own perturbations drawn from a seed derived from the base seed and
+// the run number (so any run can be reproduced alone), and spreads the runs
+// over all the cores. Every run adds a row to the results file as soon as it
+// finishes, and the aggregate statistics are printed at the end.
+//
+// Usage: navsim_ensemble <scenario> [options]
+//   --runs N            number of simulations                 (100)
+//   --threads N         worker threads                        (all the cores)
+//   --seed S            base seed                             (1)
+//   --results file      results file, one CSV row per run     (ensemble.csv)
+//   --dt s              integration step                      (0.001)
+//   --integrator name   euler | rk4                           (euler)
+//   --delay s           start delay of every plan, uniform in [0, s]
+//   --mass-sd r         relative standard deviation of the mass
+//   --kft-sd r          relative standard deviation of the rotor thrust constant
+//   --wind m/s          mean wind at 10 m (power-law profile), random direction per run
+//   --wind-file file    mean wind grid instead of the profile (see navsim/core/WindField.h)
+//   --gust m/s          intensity of the turbulence (Dryden-like, 50 m length scale)
+//   --pos-noise m       standard deviation of the position measured (10 Hz)
+//   --vel-noise m/s     standard deviation of the velocity measured (10 Hz)
+//   --separation m      minimum separation between airborne UAVs (5)
+//   --gains file        gain schedule of the controller (hover gains; see navsim/core/GainSchedule.h)
+//
+// The scenario file is described in navsim/core/Scenario.h
+
+#include "navsim/core/GainSchedule.h"
+#include "navsim/core/Scenario.h"
+#include "navsim/core/SimDrone.h"
+#include "navsim/core/WindField.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+struct Perturbations
+{
+    double delay     = 0;
+    double massSd    = 0;
+    double kftSd     = 0;
+    double wind      = 0;
+    double gust      = 0;
+    double posNoise  = 0;
+    double velNoise  = 0;
+    double sensorPeriod = 0.1;
+};
+
+struct EnsembleConfig
+{
+    double dt = 0.001;
+    navsim::Integrator integrator = navsim::Integrator::SemiImplicitEuler;
+    double separation   = 5;
+    double samplePeriod = 0.1; // separation check [s]
+    double windPeriod   = 0.01;
+    Perturbations perturbations;
+    std::shared_ptr<const navsim::WindGrid> windGrid;   // from a file (null: profile)
+    std::shared_ptr<const navsim::GainSchedule> gains;  // from a file (null: hover gains)
+};
+
+struct RunResult
+{
+    long     run = 0;
+    uint64_t seed = 0;
+    double   meanError = 0;    // path following error of all the UAVs while flying [m]
+    double   maxError  = 0;
+    double   minSeparation = std::numeric_limits<double>::infinity();   // between airborne UAVs [m]
+    int      losPairs  = 0;    // pairs of UAVs that lost separation at least once
+    int      completed = 0;
+    int      aborted   = 0;
+    double   wall      = 0;    // [s]
+};
+
+
+
+
+static uint64_t RunSeed(uint64_t seed, long run)
+{
+    std::seed_seq seq{uint32_t(seed), uint32_t(seed >> 32), uint32_t(run), uint32_t(uint64_t(run) >> 32)};
+    uint32_t words[2];
+    seq.generate(words, words + 2);
+    return (uint64_t(words[0]) << 32) | words[1];
+}
+
+
+
+
+static RunResult Simulate(const navsim::Scenario &scenario, const EnsembleConfig &config, long run, uint64_t seed)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    const Perturbations &p = config.perturbations;
+    std::mt19937_64 rng(seed);
+    std::normal_distribution<double>       normal(0, 1);
+    std::uniform_real_distribution<double> uniform(0, 1);
+
+    RunResult result;
+    result.run  = run;
+    result.seed = seed;
+
+    // Wind of the run: the profile blows from a random direction
+    std::shared_ptr<const navsim::WindGrid> windGrid = config.windGrid;
+    if (!windGrid && (p.wind > 0 || p.gust > 0))
+    {
+        navsim::WindProfile profile;
+        profile.speed     = p.wind;
+        profile.direction = 2 * M_PI * uniform(rng);
+
+        Eigen::Vector3d lo, hi;
+        scenario.Bounds(lo, hi);
+        lo = (lo - Eigen::Vector3d(100, 100, 0)).cwiseMin(Eigen::Vector3d(lo.x(), lo.y(), 0));
+        hi += Eigen::Vector3d(100, 100, 50);
+        auto grid = std::make_shared<navsim::WindGrid>();
+        grid->Generate(lo, hi, 10, profile);
+        windGrid = grid;
+    }
+    navsim::TurbulenceParams turbulence;
+    turbulence.intensity = p.gust;
+    navsim::WindField wind(windGrid, turbulence, rng());
+
+    // Perturbed fleet. The controller stays tuned for the nominal airframe.
+    size_t N = scenario.uavs.size();
+    std::vector<navsim::SimDrone> drones;
+    drones.reserve(N);
+    double endTime = 0;
+    for (const navsim::ScenarioUAV &uav : scenario.uavs)
+    {
+        drones.emplace_back(uav.name);
+        navsim::SimDrone &drone = drones.back();
+        drone.integrator = config.integrator;
+        drone.SetGains(config.gains);
+        drone.state.pos  = uav.pos;
+        drone.state.rot  = Eigen::AngleAxisd(uav.yaw, Eigen::Vector3d::UnitZ());
+        drone.ground     = std::min(0.0, uav.pos.z());
+        drone.params.mass *= std::max(0.1, 1 + p.massSd * normal(rng));
+        drone.params.kFT  *= std::max(0.1, 1 + p.kftSd  * normal(rng));
+
+        if (uav.route.waypoints.empty()) continue;
+        navsim::Route route = uav.route;
+        double delay = p.delay * uniform(rng);
+        for (navsim::TimedWaypoint &wp : route.waypoints)
+            wp.t += delay;
+        drone.follower.SetRoute(route);
+        endTime = std::max(endTime, route.waypoints.back().t);
+    }
+
+    std::vector<double> wx(N), wy(N), wz(N), wu(N), wv(N), ww(N);
+    std::vector<Eigen::Vector3d> posError(N, Eigen::Vector3d::Zero());
+    std::vector<Eigen::Vector3d> velError(N, Eigen::Vector3d::Zero());
+    std::vector<uint8_t> lostSeparation;                 // per pair, only with a threshold
+    std::vector<size_t> airborne;
+
+    double sumError = 0;
+    long   samples  = 0;
+
+    long steps        = std::lround((endTime + 1) / config.dt);
+    long sampleSteps  = std::max(1L, std::lround(config.samplePeriod / config.dt));
+    long sensorSteps  = std::max(1L, std::lround(p.sensorPeriod / config.dt));
+    long windSteps    = std::max(1L, std::lround(config.windPeriod / config.dt));
+
+    for (long k = 0; k < steps; k++)
+    {
+        double t = k * config.dt;
+
+        // Wind at the UAVs
+        if (!wind.Calm() && k % windSteps == 0)
+        {
+            wind.Advance(t);
+            for (size_t i = 0; i < N; i++)
+            {
+                wx[i] = drones[i].state.pos.x();
+                wy[i] = drones[i].state.pos.y();
+                wz[i] = drones[i].state.pos.z();
+            }
+            wind.Sample(N, wx.data(), wy.data(), wz.data(), wu.data(), wv.data(), ww.data());
+            for (size_t i = 0; i < N; i++)
+                drones[i].wind = Eigen::Vector3d(wu[i], wv[i], ww[i]);
+        }
+
+        // Sensor errors, held between updates
+        if (k % sensorSteps == 0)
+            for (size_t i = 0; i < N; i++)
+            {
+                if (p.posNoise > 0) posError[i] = p.posNoise * Eigen::Vector3d(normal(rng), normal(rng), normal(rng));
+                if (p.velNoise > 0) velError[i] = p.velNoise * Eigen::Vector3d(normal(rng), normal(rng), normal(rng));
+            }
+
+        for (size_t i = 0; i < N; i++)
+        {
+            navsim::SimDrone &drone = drones[i];
+
+            navsim::NavEvent event;
+            if (p.posNoise > 0 || p.velNoise > 0)
+            {
+                navsim::QuadrotorState measured = drone.state;
+                measured.pos += posError[i];
+                measured.vel += velError[i];
+                event = drone.Step(t, config.dt, measured);
+            }
+            else
+                event = drone.Step(t, config.dt);
+
+            if (event == navsim::NavEvent::COMPLETED) result.completed++;
+            if (event == navsim::NavEvent::OBSOLETE || event == navsim::NavEvent::WRONG_START) result.aborted++;
+
+            if (drone.follower.Active() && drone.follower.CurrentWaypoint() > 0)
+            {
+                double error = (drone.follower.PositionAtTime(t + config.dt) - drone.state.pos).norm();
+                sumError += error;
+                result.maxError = std::max(result.maxError, error);
+                samples++;
+            }
+        }
+
+        // Separation between the UAVs in the air (sweep along x)
+        if (k % sampleSteps != 0) continue;
+
+        airborne.clear();
+        for (size_t i = 0; i < N; i++)
+            if (drones[i].RotorsOn() && drones[i].state.pos.z() > drones[i].ground + 1)
+                airborne.push_back(i);
+        std::sort(airborne.begin(), airborne.end(),
+            [&](size_t a, size_t b) { return drones[a].state.pos.x() < drones[b].state.pos.x(); });
+
+        for (size_t a = 0; a < airborne.size(); a++)
+        {
+            const Eigen::Vector3d &pa = drones[airborne[a]].state.pos;
+            for (size_t b = a + 1; b < airborne.size(); b++)
+            {
+                const Eigen::Vector3d &pb = drones[airborne[b]].state.pos;
+                double window = std::max(result.minSeparation, config.separation);
+                if (pb.x() - pa.x() > window) break;
+
+                double d = (pb - pa).norm();
+                result.minSeparation = std::min(result.minSeparation, d);
+                if (d < config.separation)
+                {
+                    size_t i = std::min(airborne[a], airborne[b]), j = std::max(airborne[a], airborne[b]);
+                    if (lostSeparation.empty()) lostSeparation.assign(N * N, 0);
+                    if (!lostSeparation[i * N + j])
+                    {
+                        lostSeparation[i * N + j] = 1;
+                        result.losPairs++;
+                    }
+                }
+            }
+        }
+    }
+
+    result.meanError = samples ? sumError / samples : 0;
+    result.wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+
+
+
+// Mean, percentiles and maximum of a metric over the runs
+static void Summary(const char *name, std::vector<double> values)
+{
+    values.erase(std::remove_if(values.begin(), values.end(), [](double v) { return !std::isfinite(v); }),
+                 values.end());
+    if (values.empty())
+    {
+        printf("%-18s %10s\n", name, "-");
+        return;
+    }
+    std::sort(values.begin(), values.end());
+    double mean = 0;
+    for (double v : values) mean += v;
+    mean /= values.size();
+    auto pct = [&](double q) { return values[std::min(values.size() - 1, size_t(q * values.size()))]; };
+    printf("%-18s %10.3f %10.3f %10.3f %10.3f %10.3f %10.3f\n", name,
+           mean, values.front(), pct(0.05), pct(0.5), pct(0.95), values.back());
+}
+
+
+
+
+static void Usage(const char *program)
+{
+    printf("Usage: %s <scenario> [--runs N] [--threads N] [--seed S] [--results file] [--dt s]\n"
+           "       [--integrator euler|rk4] [--delay s] [--mass-sd r] [--kft-sd r] [--wind m/s]\n"
+           "       [--wind-file file] [--gust m/s] [--pos-noise m] [--vel-noise m/s] [--separation m]\n"
+           "       [--gains file]\n", program);
+}
+
+
+
+
+int main(int argc, char **argv)
+{
+    std::string scenarioPath, resultsPath = "ensemble.csv", windFile, gainsFile;
+    long     runs = 100;
+    int      threads = std::max(1u, std::thread::hardware_concurrency());
+    uint64_t seed = 1;
+    EnsembleConfig config;
+    Perturbations &p = config.perturbations;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if      (arg == "--runs"       && hasValue) runs         = atol(argv[++i]);
+        else if (arg == "--threads"    && hasValue) threads      = atoi(argv[++i]);
+        else if (arg == "--seed"       && hasValue) seed         = strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--results"    && hasValue) resultsPath  = argv[++i];
+        else if (arg == "--dt"         && hasValue) config.dt    = atof(argv[++i]);
+        else if (arg == "--separation" && hasValue) config.separation = atof(argv[++i]);
+        else if (arg == "--delay"      && hasValue) p.delay      = atof(argv[++i]);
+        else if (arg == "--mass-sd"    && hasValue) p.massSd     = atof(argv[++i]);
+        else if (arg == "--kft-sd"     && hasValue) p.kftSd      = atof(argv[++i]);
+        else if (arg == "--wind"       && hasValue) p.wind       = atof(argv[++i]);
+        else if (arg == "--gust"       && hasValue) p.gust       = atof(argv[++i]);
+        else if (arg == "--wind-file"  && hasValue) windFile     = argv[++i];
+        else if (arg == "--gains"      && hasValue) gainsFile    = argv[++i];
+        else if (arg == "--pos-noise"  && hasValue) p.posNoise   = atof(argv[++i]);
+        else if (arg == "--vel-noise"  && hasValue) p.velNoise   = atof(argv[++i]);
+        else if (arg == "--integrator" && hasValue)
+        {
+            std::string name = argv[++i];
+            if (name == "rk4")
+                config.integrator = navsim::Integrator::RK4;
+            else if (name != "euler")
+            {
+                Usage(argv[0]);
+                return 1;
+            }
+        }
+        else if (scenarioPath.empty() && arg[0] != '-')
+            scenarioPath = arg;
+        else
+        {
+            Usage(argv[0]);
+            return 1;
+        }
+    }
+    if (scenarioPath.empty() || runs < 1 || threads < 1 || config.dt <= 0)
+    {
+        Usage(argv[0]);
+        return 1;
+    }
+
+    navsim::Scenario scenario;
+    std::string error;
+    if (!navsim::LoadScenario(scenarioPath, scenario, error))
+    {
+        printf("ERROR: scenario %s\n", error.c_str());
+        return 1;
+    }
+
+    if (!windFile.empty())
+    {
+        auto grid = std::make_shared<navsim::WindGrid>();
+        if (!grid->Load(windFile, error))
+        {
+            printf("ERROR: wind %s\n", error.c_str());
+            return 1;
+        }
+        config.windGrid = grid;
+    }
+
+    if (!gainsFile.empty())
+    {
+        auto gains = std::make_shared<navsim::GainSchedule>();
+        if (!gains->Load(gainsFile, error))
+        {
+            printf("ERROR: gains %s\n", error.c_str());
+            return 1;
+        }
+        config.gains = gains;
+    }
+
+    FILE *results = fopen(resultsPath.c_str(), "w");
+    if (!results)
+    {
+        printf("ERROR: cannot open %s\n", resultsPath.c_str());
+        return 1;
+    }
+    fprintf(results, "run,seed,mean_error,max_error,min_separation,los_pairs,completed,aborted,wall\n");
+    fflush(results);
+
+    threads = std::min<long>(threads, runs);
+    printf("%zu UAVs, %ld runs on %d threads\n", scenario.uavs.size(), runs, threads);
+
+
+    // Runs are handed out one at a time; results are streamed as they finish
+    std::vector<RunResult> all(runs);
+    std::atomic<long> next(0);
+    std::mutex mutex;
+    long done = 0;
+    double sumMeanError = 0, maxError = 0, minSeparation = std::numeric_limits<double>::infinity();
+
+    auto worker = [&]()
+    {
+        for (long run = next++; run < runs; run = next++)
+        {
+            RunResult r = Simulate(scenario, config, run, RunSeed(seed, run));
+
+            std::lock_guard<std::mutex> lock(mutex);
+            all[run] = r;
+            fprintf(results, "%ld,%llu,%.4f,%.4f,%.4f,%d,%d,%d,%.3f\n", r.run, (unsigned long long)r.seed,
+                    r.meanError, r.maxError, std::isfinite(r.minSeparation) ? r.minSeparation : -1.0,
+                    r.losPairs, r.completed, r.aborted, r.wall);
+            fflush(results);
+
+            done++;
+            sumMeanError += r.meanError;
+            maxError      = std::max(maxError, r.maxError);
+            minSeparation = std::min(minSeparation, r.minSeparation);
+            if (done % std::max(1L, runs / 10) == 0 || done == runs)
+                printf("%6ld/%ld runs   mean error %.3f m   max error %.3f m   min separation %.2f m\n",
+                       done, runs, sumMeanError / done, maxError, minSeparation);
+        }
+    };
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> pool;
+    for (int i = 1; i < threads; i++)
+        pool.emplace_back(worker);
+    worker();
+    for (std::thread &t : pool)
+        t.join();
+
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    fclose(results);
+
+
+    std::vector<double> meanErrors, maxErrors, separations;
+    long losRuns = 0, completed = 0, aborted = 0;
+    for (const RunResult &r : all)
+    {
+        meanErrors.push_back(r.meanError);
+        maxErrors.push_back(r.maxError);
+        separations.push_back(r.minSeparation);
+        losRuns   += r.losPairs > 0;
+        completed += r.completed;
+        aborted   += r.aborted;
+    }
+
+    printf("\n%-18s %10s %10s %10s %10s %10s %10s\n", "per run", "mean", "min", "p5", "p50", "p95", "max");
+    Summary("mean error [m]",     meanErrors);
+    Summary("max error [m]",      maxErrors);
+    Summary("min separation [m]", separations);
+    printf("\nloss of separation (< %.1f m) in %ld of %ld runs (%.1f%%)\n",
+           config.separation, losRuns, runs, 100.0 * losRuns / runs);
+    printf("plans completed %ld, aborted %ld\n", completed, aborted);
+    printf("%ld runs in %.2f s of wall time, results in %s\n", runs, wall, resultsPath.c_str());
+
+    return 0;
+}
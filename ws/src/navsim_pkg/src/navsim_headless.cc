@@ -0,0 +1,361 @@
+// Headless NAVSIM: flies flight plans with the navsim_core dynamics, without
+// Gazebo or ROS, as fast as the CPU allows.
+//
+// Usage: navsim_headless <scenario> [--dt s] [--integrator euler|rk4]
+//                        [--duration s] [--log file.csv] [--log-period s]
+//                        [--wind m/s] [--wind-dir rad] [--wind-file file]
+//                        [--turbulence m/s] [--turbulence-length m]
+//                        [--gains file] [--zoh] [--kinematic from to]
+//                        [--validate] [--max-deviation m]
+//
+// The wind (a power-law profile over the scenario, or a grid file, plus
+// turbulence) is sampled at all the UAVs every 10 ms. The controller uses the
+// hover gains, or the gain schedule of a file (see navsim/core/GainSchedule.h);
+// --zoh discretizes them for the step. --kinematic flies the UAVs with the
+// kinematic model (navsim/core/Kinematic.h) between two times, as the FP1
+// plugin does during cruise, and with the full model before and after.
+//
+// --validate flies the scenario again as the reference (1 ms steps, RK4 and
+// the continuous gains, the step of the Gazebo worlds) and reports how far
+// every UAV is from its reference trajectory, sampled every 0.1 s, to check
+// coarser steps (or the switches of --kinematic). With --max-deviation the
+// exit status is 1 when the fleet deviates more than that, for ctest.
+//
+// The scenario file is described in navsim/core/Scenario.h
+
+#include "navsim/core/GainSchedule.h"
+#include "navsim/core/Scenario.h"
+#include "navsim/core/SimDrone.h"
+#include "navsim/core/WindField.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+
+struct DroneRun
+{
+    navsim::SimDrone drone;
+    std::string      status = "idle";
+    double   sumError = 0;             // path following error while flying
+    double   maxError = 0;
+    long     samples  = 0;
+};
+
+struct Track                           // positions of every UAV every 'period' seconds
+{
+    double period = 0.1;
+    std::vector<Eigen::Vector3d> positions;
+};
+
+
+
+
+static void Usage(const char *program)
+{
+    printf("Usage: %s <scenario> [--dt s] [--integrator euler|rk4] [--duration s]\n"
+           "       [--log file.csv] [--log-period s] [--wind m/s] [--wind-dir rad] [--wind-file file]\n"
+           "       [--turbulence m/s] [--turbulence-length m] [--gains file] [--zoh]\n"
+           "       [--kinematic from to] [--validate] [--max-deviation m]\n", program);
+}
+
+
+
+
+static std::vector<DroneRun> Fleet(const navsim::Scenario &fleet, navsim::Integrator integrator,
+                                   const std::shared_ptr<const navsim::GainSchedule> &gains)
+{
+    std::vector<DroneRun> runs(fleet.uavs.size());
+    for (size_t i = 0; i < runs.size(); i++)
+    {
+        const navsim::ScenarioUAV &uav = fleet.uavs[i];
+        DroneRun &run = runs[i];
+        run.drone.name = uav.name;
+        run.drone.state.pos = uav.pos;
+        run.drone.state.rot = Eigen::AngleAxisd(uav.yaw, Eigen::Vector3d::UnitZ());
+        run.drone.integrator = integrator;
+        run.drone.SetGains(gains);
+        run.drone.ground = std::min(0.0, uav.pos.z());
+        if (!uav.route.waypoints.empty())
+        {
+            run.drone.follower.SetRoute(uav.route);
+            run.status = "assigned";
+        }
+    }
+    return runs;
+}
+
+
+
+
+// Flies the fleet 'steps' steps of 'dt' seconds, with the kinematic model
+// from 'kinematicFrom' to 'kinematicTo'
+static void Fly(std::vector<DroneRun> &runs, navsim::WindField &wind, double windPeriod, double dt, long steps,
+                double kinematicFrom, double kinematicTo, FILE *log, double logPeriod, Track *track)
+{
+    std::vector<double> wx(runs.size()), wy(runs.size()), wz(runs.size());
+    std::vector<double> wu(runs.size()), wv(runs.size()), ww(runs.size());
+    long windSteps  = std::max(1L, std::lround(windPeriod / dt));
+    long logSteps   = std::max(1L, std::lround(logPeriod / dt));
+    long trackSample = 1;   // next multiple of the track period
+
+    for (long k = 0; k < steps; k++)
+    {
+        double t = k * dt;
+
+        // The track is sampled at the step ending nearest to every multiple of
+        // its period, so the skew to the reference stays within dt/2 (dt up to the period)
+        int trackSamples = 0;
+        while (track && t + dt + dt / 2 > trackSample * track->period)
+        {
+            trackSamples++;
+            trackSample++;
+        }
+
+        if (!wind.Calm() && k % windSteps == 0)
+        {
+            wind.Advance(t);
+            for (size_t i = 0; i < runs.size(); i++)
+            {
+                wx[i] = runs[i].drone.state.pos.x();
+                wy[i] = runs[i].drone.state.pos.y();
+                wz[i] = runs[i].drone.state.pos.z();
+            }
+            wind.Sample(runs.size(), wx.data(), wy.data(), wz.data(), wu.data(), wv.data(), ww.data());
+            for (size_t i = 0; i < runs.size(); i++)
+                runs[i].drone.wind = Eigen::Vector3d(wu[i], wv[i], ww[i]);
+        }
+
+        bool kinematic = kinematicFrom <= t && t < kinematicTo;
+        for (DroneRun &run : runs)
+        {
+            run.drone.SetKinematic(kinematic, t);
+            navsim::NavEvent event = run.drone.Step(t, dt);
+
+            switch (event)
+            {
+                case navsim::NavEvent::STARTED:   run.status = "flying";    break;
+                case navsim::NavEvent::COMPLETED: run.status = "completed"; break;
+                case navsim::NavEvent::OBSOLETE:
+                case navsim::NavEvent::WRONG_START: run.status = "aborted"; break;
+                default: break;
+            }
+
+            const navsim::PlanFollower &follower = run.drone.follower;
+            if (follower.Active() && follower.CurrentWaypoint() > 0)
+            {
+                double error = (follower.PositionAtTime(t + dt) - run.drone.state.pos).norm();
+                run.sumError += error;
+                run.maxError  = std::max(run.maxError, error);
+                run.samples++;
+            }
+
+            if (log && k % logSteps == 0)
+            {
+                const navsim::QuadrotorState &s = run.drone.state;
+                Eigen::Vector3d rpy = s.Euler();
+                fprintf(log, "%.3f,%s,%.3f,%.3f,%.3f,%.4f,%.4f,%.4f,%.3f,%.3f,%.3f\n",
+                        t + dt, run.drone.name.c_str(), s.pos.x(), s.pos.y(), s.pos.z(),
+                        rpy.x(), rpy.y(), rpy.z(), s.vel.x(), s.vel.y(), s.vel.z());
+            }
+
+            for (int s = 0; s < trackSamples; s++)
+                track->positions.push_back(run.drone.state.pos);
+        }
+    }
+}
+
+
+
+
+int main(int argc, char **argv)
+{
+    std::string scenario, logPath, windFile, gainsFile;
+    double dt = 0.001;                 // as the max_step_size of the NAVSIM worlds
+    double duration = -1;              // until every plan finishes
+    double logPeriod = 0.1;
+    double windPeriod = 0.01;
+    double kinematicFrom = 0, kinematicTo = 0;
+    double maxDeviation = -1;
+    bool   zoh = false, validate = false;
+    navsim::Integrator integrator = navsim::Integrator::SemiImplicitEuler;
+    navsim::WindProfile      windProfile;
+    navsim::TurbulenceParams turbulence;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if      (arg == "--dt"         && hasValue) dt        = atof(argv[++i]);
+        else if (arg == "--duration"   && hasValue) duration  = atof(argv[++i]);
+        else if (arg == "--log"        && hasValue) logPath   = argv[++i];
+        else if (arg == "--log-period" && hasValue) logPeriod = atof(argv[++i]);
+        else if (arg == "--wind"       && hasValue) windProfile.speed     = atof(argv[++i]);
+        else if (arg == "--wind-dir"   && hasValue) windProfile.direction = atof(argv[++i]);
+        else if (arg == "--wind-file"  && hasValue) windFile  = argv[++i];
+        else if (arg == "--turbulence" && hasValue) turbulence.intensity  = atof(argv[++i]);
+        else if (arg == "--turbulence-length" && hasValue) turbulence.lengthScale = atof(argv[++i]);
+        else if (arg == "--gains"      && hasValue) gainsFile = argv[++i];
+        else if (arg == "--zoh")                    zoh       = true;
+        else if (arg == "--validate")               validate  = true;
+        else if (arg == "--max-deviation" && hasValue) maxDeviation = atof(argv[++i]);
+        else if (arg == "--kinematic"  && i + 2 < argc)
+        {
+            kinematicFrom = atof(argv[++i]);
+            kinematicTo   = atof(argv[++i]);
+        }
+        else if (arg == "--integrator" && hasValue)
+        {
+            std::string name = argv[++i];
+            if (name == "rk4")
+                integrator = navsim::Integrator::RK4;
+            else if (name != "euler")
+            {
+                printf("ERROR: unknown integrator %s\n", name.c_str());
+                return 1;
+            }
+        }
+        else if (scenario.empty() && arg[0] != '-')
+            scenario = arg;
+        else
+        {
+            Usage(argv[0]);
+            return 1;
+        }
+    }
+    if (scenario.empty() || dt <= 0)
+    {
+        Usage(argv[0]);
+        return 1;
+    }
+
+    navsim::Scenario fleet;
+    std::string error;
+    if (!navsim::LoadScenario(scenario, fleet, error))
+    {
+        printf("ERROR: scenario %s\n", error.c_str());
+        return 1;
+    }
+
+    auto gains = std::make_shared<navsim::GainSchedule>(navsim::GainSchedule::Hover());
+    if (!gainsFile.empty() && !gains->Load(gainsFile, error))
+    {
+        printf("ERROR: gains %s\n", error.c_str());
+        return 1;
+    }
+    auto stepGains = zoh ? std::make_shared<navsim::GainSchedule>(gains->Discretize(navsim::QuadrotorParams::Minidrone(), dt))
+                         : gains;
+
+    std::vector<DroneRun> runs = Fleet(fleet, integrator, stepGains);
+    if (duration < 0) duration = fleet.EndTime() + 1;
+
+    if (kinematicFrom < kinematicTo)
+    {
+        navsim::KinematicParams lags = navsim::FitKinematicParams(navsim::QuadrotorParams::Minidrone());
+        for (DroneRun &run : runs)
+            run.drone.lags = lags;
+    }
+
+    // Wind over the scenario
+    auto windGrid = std::make_shared<navsim::WindGrid>();
+    if (!windFile.empty())
+    {
+        if (!windGrid->Load(windFile, error))
+        {
+            printf("ERROR: wind %s\n", error.c_str());
+            return 1;
+        }
+    }
+    else if (windProfile.speed > 0 || turbulence.intensity > 0)
+    {
+        Eigen::Vector3d lo, hi;
+        fleet.Bounds(lo, hi);
+        lo = (lo - Eigen::Vector3d(100, 100, 0)).cwiseMin(Eigen::Vector3d(lo.x(), lo.y(), 0));
+        hi += Eigen::Vector3d(100, 100, 50);
+        windGrid->Generate(lo, hi, 10, windProfile);
+    }
+    navsim::WindField wind(windGrid, turbulence);
+
+    FILE *log = nullptr;
+    if (!logPath.empty())
+    {
+        log = fopen(logPath.c_str(), "w");
+        if (!log)
+        {
+            printf("ERROR: cannot open log %s\n", logPath.c_str());
+            return 1;
+        }
+        fprintf(log, "time,uav,x,y,z,roll,pitch,yaw,vx,vy,vz\n");
+    }
+
+    printf("%zu UAVs, %.1f s at dt %.4f s (%s)\n", runs.size(), duration, dt,
+           integrator == navsim::Integrator::RK4 ? "rk4" : "euler");
+    if (!gainsFile.empty() || zoh)
+        printf("gain schedule %s: %zu x %zu operating points%s\n", gainsFile.empty() ? "hover" : gainsFile.c_str(),
+               gains->speeds.size(), gains->climbs.size(), zoh ? ", discretized for the step" : "");
+    if (kinematicFrom < kinematicTo)
+        printf("kinematic model from %.1f s to %.1f s\n", kinematicFrom, kinematicTo);
+
+
+    auto start = std::chrono::steady_clock::now();
+
+    long steps = std::lround(duration / dt);
+    Track track;
+    Fly(runs, wind, windPeriod, dt, steps, kinematicFrom, kinematicTo, log, logPeriod, validate ? &track : nullptr);
+
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (log) fclose(log);
+
+
+    printf("\n%-16s %-10s %10s %10s   %s\n", "UAV", "status", "mean err", "max err", "final position");
+    for (const DroneRun &run : runs)
+    {
+        const Eigen::Vector3d &p = run.drone.state.pos;
+        printf("%-16s %-10s %10.3f %10.3f   %.2f %.2f %.2f\n", run.drone.name.c_str(), run.status.c_str(),
+               run.samples ? run.sumError / run.samples : 0.0, run.maxError, p.x(), p.y(), p.z());
+    }
+    printf("\nsimulated %.1f s in %.3f s of wall time: real time factor %.1f\n",
+           steps * dt, wall, wall > 0 ? steps * dt / wall : 0.0);
+
+    if (!validate) return 0;
+
+
+    // Reference trajectories, in the same wind
+    const double refDt = 0.001;
+    std::vector<DroneRun> reference = Fleet(fleet, navsim::Integrator::RK4, gains);
+    navsim::WindField refWind(windGrid, turbulence);
+    Track refTrack;
+    Fly(reference, refWind, windPeriod, refDt, std::lround(duration / refDt), 0, 0, nullptr, logPeriod, &refTrack);
+
+    size_t n = runs.size();
+    size_t samples = std::min(track.positions.size(), refTrack.positions.size()) / std::max<size_t>(n, 1);
+    double fleetSum = 0, fleetMax = 0;
+    printf("\nDeviation from the reference (dt %.4f s, rk4, continuous gains), every %.1f s:\n", refDt, track.period);
+    printf("%-16s %10s %10s\n", "UAV", "rms", "max");
+    for (size_t i = 0; i < n; i++)
+    {
+        double sum = 0, max = 0;
+        for (size_t k = 0; k < samples; k++)
+        {
+            double d = (track.positions[k * n + i] - refTrack.positions[k * n + i]).norm();
+            sum += d * d;
+            max  = std::max(max, d);
+        }
+        fleetSum += sum;
+        fleetMax  = std::max(fleetMax, max);
+        printf("%-16s %10.3f %10.3f\n", runs[i].drone.name.c_str(), samples ? std::sqrt(sum / samples) : 0.0, max);
+    }
+    printf("%-16s %10.3f %10.3f\n", "fleet", samples ? std::sqrt(fleetSum / (samples * n)) : 0.0, fleetMax);
+
+    if (maxDeviation >= 0 && fleetMax > maxDeviation)
+    {
+        printf("\nFAILED: deviation %.3f m over %.3f m\n", fleetMax, maxDeviation);
+        return 1;
+    }
+    return 0;
+}